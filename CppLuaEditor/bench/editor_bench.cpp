@@ -0,0 +1,174 @@
+// Drives TextEditor headlessly through its hot paths on synthetic Lua documents of 1k to 200k lines and prints the
+// timings as JSON, so runs of different builds can be compared. ImGui runs on a null backend: a context with a built
+// font atlas whose frames are laid out into draw lists and then dropped. No D3D, no Windows.h, no UEVR.
+//
+// $IMGUI is a Dear ImGui checkout of the version the plugin is built with.
+//
+//   SRC="editor_bench.cpp ../renderlib/rendering/text_editor.cpp $IMGUI/imgui.cpp $IMGUI/imgui_draw.cpp $IMGUI/imgui_tables.cpp $IMGUI/imgui_widgets.cpp"
+//   g++ -O2 -std=c++17 -I../renderlib -I$IMGUI $SRC -lpthread -o editor_bench && ./editor_bench [max lines] > editor_bench.json
+
+#include "headless.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static std::string MakeDocument(int aLines) {
+    static const char* kLines[] = {
+        "-- wave %d: spawns the actors listed in wave_definitions.lua",
+        "local function spawn_wave_%d(world, wave, options)",
+        "\tlocal spawned = {}",
+        "\tfor index, entry in ipairs(wave.entries) do",
+        "\t\tlocal actor = world:spawn(entry.class, entry.position + vec3(0.0, %d.5, 1.25e-2))",
+        "\t\tif actor ~= nil and options.tag ~= \"\" then",
+        "\t\t\tactor:add_tag(options.tag .. \"_\" .. tostring(index)) -- \xc3\xa9tiquette %d",
+        "\t\tend",
+        "\t\tspawned[#spawned + 1] = actor",
+        "\tend",
+        "\t--[[ disabled for now:",
+        "\tworld:broadcast(\"wave_%d\", #spawned)",
+        "\t]]",
+        "\treturn spawned, [[raw %d]], 0x%X",
+        "end",
+        "",
+    };
+    const int count = (int)(sizeof(kLines) / sizeof(kLines[0]));
+
+    std::string text;
+    char buf[256];
+    for (int i = 0; i < aLines; ++i) {
+        snprintf(buf, sizeof(buf), kLines[i % count], i / count, i / count);
+        text += buf;
+        if (i + 1 < aLines)
+            text += '\n';
+    }
+    return text;
+}
+
+struct Result {
+    std::string mName;
+    int mLines;
+    int mIterations;
+    double mMilliseconds;
+    long long mCheck; // something derived from the work, printed so it can't be optimized away
+};
+
+static std::vector<Result> gResults;
+
+template <typename F> static double Time(F aWork) {
+    auto start = std::chrono::steady_clock::now();
+    aWork();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void Report(const char* aName, int aLines, int aIterations, double aMilliseconds, long long aCheck) {
+    gResults.push_back(Result{aName, aLines, aIterations, aMilliseconds, aCheck});
+    fprintf(stderr, "%-16s %7d lines %7d x %10.3f ms  %10.2f us/op\n", aName, aLines, aIterations, aMilliseconds,
+        aMilliseconds * 1000.0 / aIterations);
+}
+
+static void RunDocument(NullBackend& aBackend, int aLines) {
+    const auto text = MakeDocument(aLines);
+    TextEditor editor;
+
+    const int loads = aLines >= 50000 ? 3 : 10;
+    double ms = Time([&] {
+        for (int i = 0; i < loads; ++i)
+            editor.SetText(text);
+    });
+    Report("set_text", aLines, loads, ms, editor.GetTotalLines());
+
+    ms = Time([&] { TextEditorBench::FinishColorizing(editor); });
+    Report("colorize_cold", aLines, 1, ms, editor.GetTotalLines());
+
+    ms = Time([&] {
+        TextEditorBench::ColorizeAll(editor);
+        TextEditorBench::FinishColorizing(editor);
+    });
+    Report("colorize_warm", aLines, 1, ms, editor.GetTotalLines());
+
+    // Scroll through the whole document, a frame per screen
+    const int frames = 120;
+    long long vertices = aBackend.Frame(editor);
+    ms = Time([&] {
+        for (int i = 0; i < frames; ++i) {
+            editor.SetCursorPosition(TextEditor::Coordinates((int)((long long)aLines * i / frames), 0));
+            vertices += aBackend.Frame(editor);
+        }
+    });
+    Report("render", aLines, frames, ms, vertices);
+
+    // Typing in the middle of the document, recolored after every keystroke like a frame would
+    static const char kTyped[] = "local speed = velocity:length() * 0.5 -- per frame\n";
+    const int keystrokes = 2000;
+    editor.SetCursorPosition(TextEditor::Coordinates(aLines / 2, 0));
+    ms = Time([&] {
+        for (int i = 0; i < keystrokes; ++i) {
+            TextEditorBench::Type(editor, kTyped[i % (sizeof(kTyped) - 1)]);
+            TextEditorBench::FinishColorizing(editor);
+        }
+    });
+    Report("type", aLines, keystrokes, ms, editor.GetTotalLines());
+
+    ms = Time([&] {
+        for (int i = 0; i < keystrokes / 4; ++i) {
+            TextEditorBench::Backspace(editor);
+            TextEditorBench::FinishColorizing(editor);
+        }
+    });
+    Report("backspace", aLines, keystrokes / 4, ms, editor.GetTotalLines());
+
+    const int records = TextEditorBench::GetUndoRecords(editor);
+    ms = Time([&] {
+        editor.Undo(records);
+        TextEditorBench::FinishColorizing(editor);
+    });
+    Report("undo", aLines, records, ms, editor.GetTotalLines());
+    ms = Time([&] {
+        editor.Redo(records);
+        TextEditorBench::FinishColorizing(editor);
+    });
+    Report("redo", aLines, records, ms, editor.GetTotalLines());
+
+    // Comment out a block of up to 10k lines and back
+    const int block = aLines < 10000 ? aLines : 10000;
+    editor.SetSelection(TextEditor::Coordinates(0, 0), TextEditor::Coordinates(block - 1, 0));
+    ms = Time([&] {
+        editor.ToggleComment(false);
+        editor.ToggleComment(false);
+        TextEditorBench::FinishColorizing(editor);
+    });
+    Report("toggle_comment", block, 2, ms, editor.GetTotalLines());
+
+    // Paste a 5k line dump into the middle of the document
+    const auto dump = MakeDocument(5000);
+    editor.SetCursorPosition(TextEditor::Coordinates(aLines / 2, 0));
+    ms = Time([&] {
+        editor.InsertText(dump);
+        TextEditorBench::FinishColorizing(editor);
+    });
+    Report("insert_text", 5000, 1, ms, editor.GetTotalLines());
+}
+
+int main(int argc, char** argv) {
+    const int maxLines = argc > 1 ? atoi(argv[1]) : 200000;
+    NullBackend backend;
+
+    static const int kSizes[] = {1000, 10000, 50000, 200000};
+    for (int lines : kSizes) {
+        if (lines <= maxLines)
+            RunDocument(backend, lines);
+    }
+
+    printf("{\n  \"benchmark\": \"editor_bench\",\n  \"imgui\": \"%s\",\n  \"results\": [\n", IMGUI_VERSION);
+    for (size_t i = 0; i < gResults.size(); ++i) {
+        auto& r = gResults[i];
+        printf("    {\"name\": \"%s\", \"lines\": %d, \"iterations\": %d, \"ms\": %.3f, \"us_per_op\": %.3f, \"check\": %lld}%s\n",
+            r.mName.c_str(), r.mLines, r.mIterations, r.mMilliseconds, r.mMilliseconds * 1000.0 / r.mIterations, r.mCheck,
+            i + 1 < gResults.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,98 @@
+// Editing cases that went wrong once, each checked against what the editor should do. Prints the ones that fail and
+// returns 1 if any did.
+//
+// $IMGUI is a Dear ImGui checkout of the version the plugin is built with.
+//
+//   SRC="editor_checks.cpp ../renderlib/rendering/text_editor.cpp $IMGUI/imgui.cpp $IMGUI/imgui_draw.cpp $IMGUI/imgui_tables.cpp $IMGUI/imgui_widgets.cpp"
+//   g++ -O2 -std=c++17 -I../renderlib -I$IMGUI $SRC -lpthread -o editor_checks && ./editor_checks
+
+#include "headless.hpp"
+
+#include <cstdio>
+#include <string>
+
+static int sFailures = 0;
+
+static void Check(bool aOk, const char* aWhat) {
+    if (!aOk) {
+        printf("FAILED: %s\n", aWhat);
+        ++sFailures;
+    }
+}
+
+// A Latin-1 byte is kept as it is and takes one column
+static void CheckInvalidUtf8(TextEditor& aEditor) {
+    const std::string text = "-- caf\xe9 in Latin-1\nlocal s = \"\xff\xfe\"";
+    aEditor.SetText(text);
+    // GetText ends the last line with a line break too
+    Check(aEditor.GetText() == text + "\n", "bytes that aren't UTF-8 round-trip through SetText/GetText");
+    Check(!aEditor.IsTextUtf8(), "IsTextUtf8 is false for a Latin-1 byte");
+    aEditor.SetCursorPosition(TextEditor::Coordinates(0, 0));
+    aEditor.MoveEnd();
+    Check(aEditor.GetCursorPosition().mColumn == 18, "a byte that isn't UTF-8 is one column");
+
+    aEditor.SetText("-- caf\xc3\xa9");
+    Check(aEditor.IsTextUtf8(), "IsTextUtf8 is true for UTF-8");
+}
+
+// The cursor can be set past the last line; moving up or down from there starts at the last line
+static void CheckMoveFromPastTheEnd(TextEditor& aEditor) {
+    for (bool wrap : {false, true}) {
+        aEditor.SetWordWrap(wrap);
+        aEditor.SetText("local a");
+        aEditor.SetCursorPosition(TextEditor::Coordinates(1, 6));
+        aEditor.MoveDown(1, false);
+        Check(aEditor.GetCursorPosition().mLine == 0, "MoveDown from past the end stays on the last line");
+
+        aEditor.SetText("local a\nlocal b");
+        aEditor.SetCursorPosition(TextEditor::Coordinates(5, 3));
+        aEditor.MoveUp(1, false);
+        Check(aEditor.GetCursorPosition().mLine == 0, "MoveUp from past the end goes up from the last line");
+    }
+    aEditor.SetWordWrap(false);
+}
+
+// ReplaceAll is one undo record of an edit per match, which keeps the matches and not the text between them
+static void CheckReplaceAll(TextEditor& aEditor) {
+    std::string text = "local count = 0\n";
+    for (int i = 0; i < 200; ++i)
+        text += "print(\"filler line between the matches\")\n";
+    text += "count = count + 1";
+    aEditor.SetText(text);
+    const std::string before = aEditor.GetText();
+
+    aEditor.SetFindPattern("count");
+    Check(aEditor.ReplaceAll("total") == 3, "ReplaceAll replaces every match");
+    Check(aEditor.GetText().find("count") == std::string::npos, "ReplaceAll leaves no match behind");
+    Check(aEditor.GetCursorCount() == 1 && aEditor.GetCursorPosition() == TextEditor::Coordinates(201, 13),
+        "ReplaceAll leaves one cursor after the last replacement");
+    int edits;
+    const size_t bytes = TextEditorBench::GetLastUndoBytes(aEditor, edits);
+    Check(edits == 3 && bytes == 3 * 10, "the ReplaceAll undo record keeps only the matches");
+    const std::string after = aEditor.GetText();
+
+    aEditor.Undo();
+    Check(aEditor.GetText() == before, "undoing ReplaceAll brings every match back");
+    aEditor.Redo();
+    Check(aEditor.GetText() == after, "redoing ReplaceAll replaces them again");
+
+    aEditor.SetFindPattern("total");
+    Check(aEditor.ReplaceAll("sum\nof") == 3, "ReplaceAll with a line break");
+    Check(aEditor.GetTotalLines() == 205, "every replacement adds its line");
+    aEditor.Undo();
+    Check(aEditor.GetText() == after, "undoing the replacement with a line break");
+}
+
+int main() {
+    NullBackend backend;
+    TextEditor editor;
+    editor.SetLanguageDefinition(TextEditor::LanguageDefinition::Lua());
+    backend.Frame(editor);
+
+    CheckInvalidUtf8(editor);
+    CheckMoveFromPastTheEnd(editor);
+    CheckReplaceAll(editor);
+
+    printf("%s\n", sFailures == 0 ? "all checks passed" : "some checks failed");
+    return sFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+// What editor_bench.cpp, editor_checks.cpp and trace_replay.cpp share: direct access to the TextEditor internals
+// they time, and an ImGui context to lay frames out in.
+
+#include "rendering/shared.hpp"
+
+// The parts of TextEditor a frame would reach through input handling, called directly
+class TextEditorBench {
+public:
+    static void Type(TextEditor& aEditor, char aChar) { aEditor.EnterCharacter((ImWchar)(unsigned char)aChar, false); }
+    static void Backspace(TextEditor& aEditor) { aEditor.Backspace(); }
+    static void ColorizeAll(TextEditor& aEditor) { aEditor.Colorize(); }
+
+    // What Render would spread over several frames, all at once
+    static void FinishColorizing(TextEditor& aEditor) {
+        while (aEditor.mColorRangeMin < aEditor.mColorRangeMax)
+            aEditor.ColorizeInternal();
+    }
+
+    static int GetUndoRecords(const TextEditor& aEditor) { return (int)aEditor.mUndoBuffer.size(); }
+
+    // The text the last undo record keeps, removed and added, and how many edits it is made of
+    static size_t GetLastUndoBytes(const TextEditor& aEditor, int& aEdits) {
+        const auto& u = aEditor.mUndoBuffer.back();
+        size_t bytes = u.mRemoved.size() + u.mAdded.size();
+        for (const auto& edit : u.mBatch)
+            bytes += edit.mRemoved.size() + edit.mAdded.size();
+        aEdits = (int)u.mBatch.size();
+        return bytes;
+    }
+};
+
+// ImGui with nothing behind it: fonts are built for the layout code but never uploaded, draw data is never drawn
+class NullBackend {
+public:
+    NullBackend() {
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        auto& io = ImGui::GetIO();
+        io.IniFilename = nullptr;
+        io.DisplaySize = ImVec2(1920.0f, 1080.0f);
+        unsigned char* pixels;
+        int width, height;
+        io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+    }
+
+    ~NullBackend() { ImGui::DestroyContext(); }
+
+    // One frame with aEditor filling the display. Returns the vertices it produced, so the work can't be skipped.
+    int Frame(TextEditor& aEditor) {
+        auto& io = ImGui::GetIO();
+        io.DeltaTime = 1.0f / 60.0f;
+        ImGui::NewFrame();
+        ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
+        ImGui::SetNextWindowSize(io.DisplaySize);
+        ImGui::Begin("bench", nullptr, ImGuiWindowFlags_NoDecoration);
+        aEditor.Render("editor");
+        ImGui::End();
+        ImGui::Render();
+        return ImGui::GetDrawData()->TotalVtxCount;
+    }
+};
@@ -0,0 +1,125 @@
+// Tokenizes a synthetic GLSL document with the token regexes of TextEditor::LanguageDefinition::GLSL(), once the
+// way TextEditor did with a list of std::regex tried in order, once with RegexDfa, checks that both agree and prints
+// the timings.
+//
+//   g++ -O2 -std=c++17 -I../renderlib regex_dfa_bench.cpp -o regex_dfa_bench && ./regex_dfa_bench [lines]
+
+#include "rendering/regex_dfa.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <regex>
+#include <string>
+#include <vector>
+
+static const std::vector<std::string> kPatterns = {
+    "[ \\t]*#[ \\t]*[a-zA-Z_]+",
+    "L?\\\"(\\\\.|[^\\\"])*\\\"",
+    "\\'\\\\?[^\\']\\'",
+    "[+-]?([0-9]+([.][0-9]*)?|[.][0-9]+)([eE][+-]?[0-9]+)?[fF]?",
+    "[+-]?[0-9]+[Uu]?[lL]?[lL]?",
+    "0[0-7]+[Uu]?[lL]?[lL]?",
+    "0[xX][0-9a-fA-F]+[uU]?[lL]?[lL]?",
+    "[a-zA-Z_][a-zA-Z0-9_]*",
+    "[\\[\\]\\{\\}\\!\\%\\^\\&\\*\\(\\)\\-\\+\\=\\~\\|\\<\\>\\?\\/\\;\\,\\.]",
+};
+
+static std::vector<std::string> MakeDocument(int aLines) {
+    static const char* kLines[] = {
+        "#version 330 core",
+        "uniform mat4 u_model_view_projection;",
+        "in vec3 a_position; // object space",
+        "out vec4 v_color;",
+        "void main() {",
+        "    float t = 0.5f * (a_position.x + 1.0e-3) - 0x1Fu;",
+        "    v_color = vec4(a_position * 2.0, 1.0);",
+        "    if (t >= 0.25 && t != 017) { v_color.rgb += vec3(t); }",
+        "    gl_Position = u_model_view_projection * vec4(a_position, 1.0);",
+        "    const char* name = \"vertex \\\"main\\\"\"; char c = '\\n';",
+        "}",
+        "",
+    };
+
+    std::vector<std::string> lines;
+    for (int i = 0; i < aLines; ++i)
+        lines.push_back(kLines[i % (sizeof(kLines) / sizeof(kLines[0]))]);
+    return lines;
+}
+
+// One entry per token: pattern index and length. Characters no pattern matches are skipped, like the editor does.
+typedef std::vector<std::pair<int, int>> Tokens;
+
+static void TokenizeRegexList(const std::vector<std::regex>& aRegexes, const std::string& aLine, Tokens& aTokens) {
+    std::cmatch results;
+    const char* last = aLine.data() + aLine.size();
+    for (const char* first = aLine.data(); first != last;) {
+        bool matched = false;
+        for (size_t i = 0; i < aRegexes.size(); ++i) {
+            if (std::regex_search(first, last, results, aRegexes[i], std::regex_constants::match_continuous) && results[0].second != first) {
+                aTokens.emplace_back((int)i, (int)(results[0].second - first));
+                first = results[0].second;
+                matched = true;
+                break;
+            }
+        }
+        if (!matched)
+            ++first;
+    }
+}
+
+static void TokenizeDfa(const RegexDfa& aDfa, const std::string& aLine, Tokens& aTokens) {
+    const char* last = aLine.data() + aLine.size();
+    for (const char* first = aLine.data(); first != last;) {
+        const char* end = first;
+        int rule = aDfa.Match(first, last, end);
+        if (rule >= 0) {
+            aTokens.emplace_back(rule, (int)(end - first));
+            first = end;
+        } else {
+            ++first;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const int lineCount = argc > 1 ? atoi(argv[1]) : 20000;
+    auto lines = MakeDocument(lineCount);
+    size_t bytes = 0;
+    for (auto& line : lines)
+        bytes += line.size();
+
+    auto now = [] { return std::chrono::steady_clock::now(); };
+    auto ms = [](auto a, auto b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+
+    auto t0 = now();
+    std::vector<std::regex> regexes;
+    for (auto& p : kPatterns)
+        regexes.emplace_back(p, std::regex_constants::optimize);
+    auto t1 = now();
+    RegexDfa dfa;
+    if (!dfa.Compile(kPatterns)) {
+        printf("RegexDfa failed to compile the GLSL patterns\n");
+        return 1;
+    }
+    auto t2 = now();
+
+    Tokens expected, actual;
+    auto t3 = now();
+    for (auto& line : lines)
+        TokenizeRegexList(regexes, line, expected);
+    auto t4 = now();
+    for (auto& line : lines)
+        TokenizeDfa(dfa, line, actual);
+    auto t5 = now();
+
+    printf("%d lines, %zu bytes, %zu tokens\n", lineCount, bytes, expected.size());
+    printf("compile:  regex list %8.2f ms   dfa %8.2f ms\n", ms(t0, t1), ms(t1, t2));
+    printf("tokenize: regex list %8.2f ms   dfa %8.2f ms   (%.1fx)\n", ms(t3, t4), ms(t4, t5), ms(t3, t4) / ms(t4, t5));
+
+    if (expected != actual) {
+        printf("MISMATCH: the DFA tokenized the document differently\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Splits a synthetic Lua document into lines, once the way TextEditor::SetText did with one push_back per byte into
+// lines that grow as they go, once with the bulk scans of text_scan.hpp (validate, count the lines, reserve exactly,
+// jump from line break to line break), checks that both agree and prints the timings.
+//
+//   g++ -O2 -std=c++17 -I../renderlib settext_bench.cpp -o settext_bench && ./settext_bench [lines] [crlf]
+
+#include "rendering/text_scan.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static std::string MakeDocument(int aLines, bool aCrLf) {
+    static const char* kLines[] = {
+        "-- spawns the actors of a wave, see wave_definitions.lua",
+        "local function spawn_wave(world, wave, options)",
+        "    local spawned = {}",
+        "    for index, entry in ipairs(wave.entries) do",
+        "        local actor = world:spawn(entry.class, entry.position + vec3(0.0, 0.0, 12.5))",
+        "        if actor ~= nil and options.tag ~= \"\" then",
+        "            actor:add_tag(options.tag .. \"_\" .. tostring(index)) -- \xc3\xa9tiquette",
+        "        end",
+        "        spawned[#spawned + 1] = actor",
+        "    end",
+        "    return spawned",
+        "end",
+        "",
+    };
+
+    std::string text;
+    for (int i = 0; i < aLines; ++i) {
+        text += kLines[i % (sizeof(kLines) / sizeof(kLines[0]))];
+        if (i + 1 < aLines)
+            text += aCrLf ? "\r\n" : "\n";
+    }
+    return text;
+}
+
+static std::vector<std::string> SplitPerByte(const std::string& aText) {
+    std::vector<std::string> lines(1);
+    for (auto chr : aText) {
+        if (chr == '\r') {
+            // ignore the carriage return character
+        } else if (chr == '\n') {
+            lines.emplace_back();
+        } else {
+            lines.back().push_back(chr);
+        }
+    }
+    return lines;
+}
+
+static std::vector<std::string> SplitBulk(const std::string& aText) {
+    const char* p = aText.data();
+    const char* end = p + aText.size();
+    if (TextScan::ValidUtf8Length(p, end) != aText.size())
+        return {};
+
+    std::vector<std::string> lines;
+    lines.reserve(TextScan::CountNewlines(p, end) + 1);
+    for (;;) {
+        const char* lineEnd = TextScan::FindLineBreak(p, end);
+        std::string line(p, lineEnd);
+        // A lone '\r' is dropped rather than ending the line
+        while (lineEnd < end && *lineEnd == '\r' && !(lineEnd + 1 < end && lineEnd[1] == '\n')) {
+            p = lineEnd + 1;
+            lineEnd = TextScan::FindLineBreak(p, end);
+            line.append(p, lineEnd);
+        }
+        lines.emplace_back(std::move(line));
+        if (lineEnd == end)
+            break;
+        p = lineEnd + (*lineEnd == '\r' ? 2 : 1);
+    }
+    return lines;
+}
+
+int main(int argc, char** argv) {
+    const int lineCount = argc > 1 ? atoi(argv[1]) : 200000;
+    const bool crlf = argc > 2 && atoi(argv[2]) != 0;
+    auto text = MakeDocument(lineCount, crlf);
+
+    auto now = [] { return std::chrono::steady_clock::now(); };
+    auto ms = [](auto a, auto b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+
+    auto t0 = now();
+    auto expected = SplitPerByte(text);
+    auto t1 = now();
+    auto actual = SplitBulk(text);
+    auto t2 = now();
+    const size_t newlines = TextScan::CountNewlines(text.data(), text.data() + text.size());
+    auto t3 = now();
+    const bool valid = TextScan::ValidUtf8Length(text.data(), text.data() + text.size()) == text.size();
+    auto t4 = now();
+
+    printf("%d lines, %zu bytes, %s line endings\n", lineCount, text.size(), crlf ? "CRLF" : "LF");
+    printf("split:    per byte %8.2f ms   bulk %8.2f ms   (%.1fx)\n", ms(t0, t1), ms(t1, t2), ms(t0, t1) / ms(t1, t2));
+    printf("scans:    count newlines %6.2f ms   validate utf-8 %6.2f ms\n", ms(t2, t3), ms(t3, t4));
+
+    if (!valid || newlines + 1 != expected.size() || expected != actual) {
+        printf("MISMATCH: the bulk scan split the document differently\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Replays an edit trace recorded with TextEditor::StartTrace (the "Record Trace" button of the full editor writes
+// editor_trace.bin to the plugin's persistent dir) and prints how long every operation took as JSON: count, p50,
+// p90, p99 and max per operation, in microseconds. An operation is timed with the recoloring it causes and, with
+// --frames, the frame that follows it.
+//
+// $IMGUI is a Dear ImGui checkout of the version the plugin is built with.
+//
+//   SRC="trace_replay.cpp ../renderlib/rendering/text_editor.cpp $IMGUI/imgui.cpp $IMGUI/imgui_draw.cpp $IMGUI/imgui_tables.cpp $IMGUI/imgui_widgets.cpp"
+//   g++ -O2 -std=c++17 -I../renderlib -I$IMGUI $SRC -lpthread -o trace_replay && ./trace_replay editor_trace.bin [--frames] > replay.json
+
+#include "headless.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+static double Percentile(const std::vector<double>& aSorted, double aFraction) {
+    if (aSorted.empty())
+        return 0.0;
+    // Nearest rank
+    size_t rank = (size_t)(aFraction * aSorted.size() + 0.999999);
+    return aSorted[std::min(std::max(rank, (size_t)1), aSorted.size()) - 1];
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s editor_trace.bin [--frames]\n", argv[0]);
+        return 2;
+    }
+    const bool frames = argc > 2 && strcmp(argv[2], "--frames") == 0;
+
+    std::ifstream file(argv[1], std::ios::binary);
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EditTrace::Reader reader(bytes.data(), bytes.size());
+    if (!reader.IsValid()) {
+        fprintf(stderr, "%s is not an edit trace of version %d\n", argv[1], EditTrace::Version);
+        return 1;
+    }
+
+    NullBackend backend;
+    TextEditor editor;
+    editor.SetLanguageDefinition(TextEditor::LanguageDefinition::Lua());
+
+    std::vector<double> times[(int)EditTrace::Op::Count];
+    std::vector<double> all;
+    EditTrace::Event event;
+    uint64_t recorded = 0;
+    long long vertices = 0;
+    while (reader.Next(event)) {
+        auto start = std::chrono::steady_clock::now();
+        editor.ReplayTraceEvent(event);
+        TextEditorBench::FinishColorizing(editor);
+        if (frames)
+            vertices += backend.Frame(editor);
+        const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        times[(int)event.mOp].push_back(us);
+        all.push_back(us);
+        recorded = event.mTime;
+    }
+    if (!reader.IsAtEnd())
+        fprintf(stderr, "the trace is cut short, replayed the first %zu events\n", all.size());
+
+    double total = 0.0;
+    for (double us : all)
+        total += us;
+    fprintf(stderr, "%zu events, recorded over %.1f s, replayed in %.1f ms, %d lines at the end\n", all.size(),
+        recorded / 1e6, total / 1000.0, editor.GetTotalLines());
+
+    printf("{\n  \"benchmark\": \"trace_replay\",\n  \"imgui\": \"%s\",\n  \"frames\": %s,\n  \"events\": %zu,\n"
+           "  \"lines\": %d,\n  \"vertices\": %lld,\n  \"results\": [\n",
+        IMGUI_VERSION, frames ? "true" : "false", all.size(), editor.GetTotalLines(), vertices);
+    bool first = true;
+    for (int op = -1; op < (int)EditTrace::Op::Count; ++op) {
+        auto& sorted = op < 0 ? all : times[op];
+        if (sorted.empty())
+            continue;
+        std::sort(sorted.begin(), sorted.end());
+        const char* name = op < 0 ? "all" : EditTrace::GetName((EditTrace::Op)op);
+        const double p50 = Percentile(sorted, 0.5), p90 = Percentile(sorted, 0.9), p99 = Percentile(sorted, 0.99);
+        printf("%s    {\"op\": \"%s\", \"count\": %zu, \"p50_us\": %.2f, \"p90_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f}",
+            first ? "" : ",\n", name, sorted.size(), p50, p90, p99, sorted.back());
+        fprintf(stderr, "%-22s %7zu x  p50 %9.2f  p90 %9.2f  p99 %9.2f  max %10.2f us\n", name, sorted.size(), p50, p90,
+            p99, sorted.back());
+        first = false;
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "heap_bytes.hpp"
+
+// The words TextEditor offers to complete an identifier with: the language's keywords and known identifiers, plus
+// the identifiers found in the document.
+//
+// The builtins are the language's, built once and shared by the indexes of all the editors on it; their numbers have
+// BuiltinBit set. Every word from the document is interned once and counted: it goes when the last line using it stops
+// doing so, and its number is handed out again. Lines keep the numbers of their words, so a line that is colorized
+// again only adds its new words and releases its old ones.
+//
+// Find ranks the words that start with the pattern's first letter and contain the rest of it in order, ignoring ASCII
+// case. They are a range of the builtins and one of an array of the document's words, both sorted that way, the latter
+// again only after words came or went, so looking words up while typing allocates nothing once the buffers have grown.
+class CompletionIndex {
+public:
+    static constexpr uint32_t BuiltinBit = 0x80000000u;
+
+    // A language's builtin words, sorted the way Find walks them. None may be empty.
+    class Builtins {
+    public:
+        explicit Builtins(std::vector<std::string> aWords)
+            : mWords(std::move(aWords)) {
+            std::sort(mWords.begin(), mWords.end(), Less);
+            mWords.erase(std::unique(mWords.begin(), mWords.end()), mWords.end());
+            for (uint32_t i = 0; i < (uint32_t)mWords.size(); ++i)
+                mIds.emplace(std::string_view(mWords[i]), i);
+        }
+        Builtins(const Builtins&) = delete; // mIds points into mWords
+        Builtins& operator=(const Builtins&) = delete;
+
+        size_t GetMemoryUsage() const {
+            size_t bytes = sizeof(*this) + mWords.capacity() * sizeof(std::string) + HeapBytes::Hash(mIds);
+            for (auto& word : mWords)
+                bytes += HeapBytes::String(word);
+            return bytes;
+        }
+
+    private:
+        friend class CompletionIndex;
+
+        std::vector<std::string> mWords;
+        std::unordered_map<std::string_view, uint32_t> mIds;
+    };
+
+    CompletionIndex() = default;
+    CompletionIndex(const CompletionIndex&) = delete; // mIds points into mWords
+    CompletionIndex& operator=(const CompletionIndex&) = delete;
+
+    // The builtins to offer from now on. Lines still holding numbers of the old ones release them as a no-op.
+    void SetBuiltins(std::shared_ptr<const Builtins> aBuiltins) { mBuiltins = std::move(aBuiltins); }
+
+    // Interns a word and counts one more use of it; a builtin is only looked up
+    uint32_t Add(std::string_view aWord) {
+        if (mBuiltins != nullptr) {
+            auto builtin = mBuiltins->mIds.find(aWord);
+            if (builtin != mBuiltins->mIds.end())
+                return BuiltinBit | builtin->second;
+        }
+
+        auto it = mIds.find(aWord);
+        if (it != mIds.end()) {
+            ++mWords[it->second].mUses;
+            return it->second;
+        }
+
+        uint32_t id;
+        if (!mFree.empty()) {
+            id = mFree.back();
+            mFree.pop_back();
+            mWords[id].mWord.assign(aWord.data(), aWord.size());
+        } else {
+            id = (uint32_t)mWords.size();
+            mWords.emplace_back();
+            mWords[id].mWord.assign(aWord.data(), aWord.size());
+        }
+        mWords[id].mUses = 1;
+        mIds.emplace(std::string_view(mWords[id].mWord), id);
+        mSorted = false;
+        return id;
+    }
+
+    // One use less of a word Add returned
+    void Release(uint32_t aId) {
+        if ((aId & BuiltinBit) != 0)
+            return;
+        auto& word = mWords[aId];
+        if (--word.mUses != 0)
+            return;
+        mIds.erase(std::string_view(word.mWord));
+        word.mWord.clear();
+        mFree.push_back(aId);
+        mSorted = false;
+    }
+
+    // Forgets every use by lines, for when they are all replaced
+    void ReleaseLines() {
+        for (uint32_t id = 0; id < (uint32_t)mWords.size(); ++id) {
+            auto& word = mWords[id];
+            if (word.mUses != 0) {
+                word.mUses = 1;
+                Release(id);
+            }
+        }
+    }
+
+    const std::string& GetWord(uint32_t aId) const {
+        return IsBuiltin(aId) ? mBuiltins->mWords[aId & ~BuiltinBit] : mWords[aId].mWord;
+    }
+    static bool IsBuiltin(uint32_t aId) { return (aId & BuiltinBit) != 0; }
+    size_t GetWordCount() const { return mIds.size() + (mBuiltins != nullptr ? mBuiltins->mIds.size() : 0); }
+
+    // Of the document's words; the builtins are the language's
+    size_t GetMemoryUsage() const {
+        size_t bytes = mWords.size() * sizeof(Word) + HeapBytes::Hash(mIds) +
+                       (mFree.capacity() + mOrder.capacity()) * sizeof(uint32_t) + mScores.capacity() * sizeof(int);
+        for (auto& word : mWords)
+            bytes += HeapBytes::String(word.mWord);
+        return bytes;
+    }
+
+    // The best aMax words for aPattern into aResults, best first. The pattern itself is left out.
+    void Find(std::string_view aPattern, size_t aMax, std::vector<uint32_t>& aResults) {
+        aResults.clear();
+        mScores.clear();
+        if (aPattern.empty() || aMax == 0)
+            return;
+        Sort();
+
+        const char first = Fold(aPattern[0]);
+        auto begin = std::partition_point(mOrder.begin(), mOrder.end(), [&](uint32_t aId) { return Fold(mWords[aId].mWord[0]) < first; });
+        auto end = std::partition_point(begin, mOrder.end(), [&](uint32_t aId) { return Fold(mWords[aId].mWord[0]) <= first; });
+        static const std::vector<std::string> none;
+        const auto& builtins = mBuiltins != nullptr ? mBuiltins->mWords : none;
+        auto builtin = std::partition_point(builtins.begin(), builtins.end(), [&](const std::string& aWord) { return Fold(aWord[0]) < first; });
+        auto builtinEnd = std::partition_point(builtin, builtins.end(), [&](const std::string& aWord) { return Fold(aWord[0]) <= first; });
+
+        // Both ranges merged, so words come in alphabetical order as before
+        for (auto it = begin; it != end || builtin != builtinEnd;) {
+            uint32_t id;
+            const std::string* word;
+            uint32_t uses;
+            if (it == end || (builtin != builtinEnd && Less(*builtin, mWords[*it].mWord))) {
+                id = BuiltinBit | (uint32_t)(builtin - builtins.begin());
+                word = &*builtin++;
+                uses = 1;
+            } else {
+                id = *it++;
+                word = &mWords[id].mWord;
+                uses = mWords[id].mUses;
+            }
+            if (*word == aPattern)
+                continue;
+            const int score = Score(aPattern, *word, uses);
+            if (score <= 0 || (mScores.size() == aMax && score <= mScores.back()))
+                continue;
+
+            // Kept sorted by score; equal scores stay in alphabetical order
+            size_t at = mScores.size();
+            while (at > 0 && mScores[at - 1] < score)
+                --at;
+            if (mScores.size() == aMax) {
+                mScores.pop_back();
+                aResults.pop_back();
+            }
+            mScores.insert(mScores.begin() + at, score);
+            aResults.insert(aResults.begin() + at, id);
+        }
+    }
+
+private:
+    struct Word {
+        std::string mWord;
+        uint32_t mUses = 0; // by lines
+    };
+
+    static char Fold(char aChar) { return aChar >= 'A' && aChar <= 'Z' ? (char)(aChar | 0x20) : aChar; }
+    static bool IsLower(char aChar) { return aChar >= 'a' && aChar <= 'z'; }
+    static bool IsUpper(char aChar) { return aChar >= 'A' && aChar <= 'Z'; }
+
+    void Sort() {
+        if (mSorted)
+            return;
+        mOrder.clear();
+        for (auto& entry : mIds)
+            mOrder.push_back(entry.second);
+        std::sort(mOrder.begin(), mOrder.end(), [this](uint32_t aLeft, uint32_t aRight) { return Less(mWords[aLeft].mWord, mWords[aRight].mWord); });
+        mSorted = true;
+    }
+
+    // By ASCII folded text, then by length, then exactly
+    static bool Less(const std::string& aLeft, const std::string& aRight) {
+        const size_t length = std::min(aLeft.size(), aRight.size());
+        for (size_t i = 0; i < length; ++i) {
+            if (Fold(aLeft[i]) != Fold(aRight[i]))
+                return Fold(aLeft[i]) < Fold(aRight[i]);
+        }
+        return aLeft.size() != aRight.size() ? aLeft.size() < aRight.size() : aLeft < aRight;
+    }
+
+    // 0 unless the pattern's characters are all in the word, in order. More for characters that follow each other,
+    // that start a word part (after a '_', or an uppercase letter after a lowercase one) or that match in case, and
+    // for words used often; less for long words.
+    static int Score(std::string_view aPattern, const std::string& aWord, uint32_t aUses) {
+        int score = 0;
+        size_t at = 0;
+        size_t previous = 0;
+        bool run = true; // a prefix so far
+        for (size_t i = 0; i < aPattern.size(); ++i) {
+            const char c = Fold(aPattern[i]);
+            while (at < aWord.size() && Fold(aWord[at]) != c)
+                ++at;
+            if (at == aWord.size())
+                return 0;
+            if (i > 0 && at == previous + 1)
+                score += 5;
+            else if (i > 0)
+                run = false;
+            if (at == 0 || aWord[at - 1] == '_' || (IsUpper(aWord[at]) && IsLower(aWord[at - 1])))
+                score += 8;
+            if (aWord[at] == aPattern[i])
+                score += 1;
+            previous = at++;
+        }
+        if (run)
+            score += 20;
+        score += (int)std::min<uint32_t>(aUses, 4);
+        return std::max(1, score + 8 - (int)aWord.size() / 4);
+    }
+
+    std::shared_ptr<const Builtins> mBuiltins;
+    std::deque<Word> mWords; // a deque, which doesn't move the words
+    std::unordered_map<std::string_view, uint32_t> mIds;
+    std::vector<uint32_t> mFree;
+    std::vector<uint32_t> mOrder; // the words sorted by their ASCII folded text
+    bool mSorted = true;
+    std::vector<int> mScores; // of the words Find keeps
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// A compact binary log of the operations done on a TextEditor, for replaying an editing session exactly, e.g. to
+// profile it with bench/trace_replay.cpp. The replay is exact when it finishes colorizing after every event, see
+// TextEditor::ReplayTraceEvent.
+//
+// The trace is the 4 byte magic "TETR" and a version byte, then one event after the other: the microseconds since
+// the previous event and the argument count as LEB128, the operation byte, the arguments as zigzag LEB128 and, for
+// the operations that carry text, its length as LEB128 and its bytes. A typed character takes 5 or 6 bytes.
+namespace EditTrace {
+
+static constexpr uint8_t Version = 1;
+
+enum class Op : uint8_t {
+    Start, // tab size, overwrite, cursor, selection start and end, interactive start and end; text: the document
+    SetText, // text
+    EnterCharacter, // character, shift
+    Backspace,
+    Delete,
+    Copy,
+    Cut,
+    Paste, // text: the clipboard
+    InsertText, // text
+    MoveUp, // amount, select
+    MoveDown, // amount, select
+    MoveLeft, // amount, select, word mode
+    MoveRight, // amount, select, word mode
+    MoveTop, // select
+    MoveBottom, // select
+    MoveHome, // select
+    MoveEnd, // select
+    SetSelection, // start, end, mode, then the cursor and interactive start and end it was called with
+    SetCursorPosition, // position
+    SelectWordUnderCursor,
+    SelectAll,
+    Undo, // steps
+    Redo, // steps
+    ToggleComment, // shift
+    ToggleOverwrite,
+    SetFindPattern, // case sensitive, whole word, regex; text: the pattern
+    FindNext,
+    FindPrevious,
+    ReplaceAll, // text: the replacement
+    Fold, // line, how many lines it hides
+    Unfold, // line
+    Complete, // text: the word the identifier before the cursor is completed to
+    AddCursor, // selection start and end, cursor
+    RemoveCursor, // position
+    AddCursorAtNextMatch,
+    SetColumnSelection, // start, end
+    ClearCursors,
+    Count
+};
+
+static constexpr int MaxArgs = 12; // coordinates take two: line, column
+
+inline bool HasText(Op aOp) {
+    return aOp == Op::Start || aOp == Op::SetText || aOp == Op::Paste || aOp == Op::InsertText || aOp == Op::SetFindPattern ||
+           aOp == Op::ReplaceAll || aOp == Op::Complete;
+}
+
+inline const char* GetName(Op aOp) {
+    static const char* kNames[] = {"Start", "SetText", "EnterCharacter", "Backspace", "Delete", "Copy", "Cut", "Paste",
+        "InsertText", "MoveUp", "MoveDown", "MoveLeft", "MoveRight", "MoveTop", "MoveBottom", "MoveHome", "MoveEnd",
+        "SetSelection", "SetCursorPosition", "SelectWordUnderCursor", "SelectAll", "Undo", "Redo", "ToggleComment",
+        "ToggleOverwrite", "SetFindPattern", "FindNext", "FindPrevious", "ReplaceAll", "Fold", "Unfold", "Complete", "AddCursor",
+        "RemoveCursor", "AddCursorAtNextMatch", "SetColumnSelection", "ClearCursors"};
+    static_assert(sizeof(kNames) / sizeof(kNames[0]) == (size_t)Op::Count, "a name for every operation");
+    return aOp < Op::Count ? kNames[(int)aOp] : "?";
+}
+
+struct Event {
+    Op mOp = Op::Start;
+    uint64_t mTime = 0; // microseconds since the trace started
+    int mArgCount = 0;
+    int mArgs[MaxArgs] = {};
+    std::string mText;
+};
+
+class Writer {
+public:
+    Writer()
+        : mStart(std::chrono::steady_clock::now()) {
+        mBytes.insert(mBytes.end(), {'T', 'E', 'T', 'R', Version});
+    }
+
+    void Write(Op aOp, std::initializer_list<int> aArgs = {}, const char* aText = nullptr, size_t aLength = 0) {
+        const uint64_t time = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - mStart).count();
+        WriteUnsigned(time - mLastTime);
+        mLastTime = time;
+
+        WriteUnsigned(aArgs.size());
+        mBytes.push_back((uint8_t)aOp);
+        for (int arg : aArgs)
+            WriteUnsigned(((uint32_t)arg << 1) ^ (uint32_t)(arg >> 31));
+        if (HasText(aOp)) {
+            WriteUnsigned(aLength);
+            mBytes.insert(mBytes.end(), aText, aText + aLength);
+        }
+    }
+
+    const std::vector<uint8_t>& GetBytes() const { return mBytes; }
+    std::vector<uint8_t> TakeBytes() { return std::move(mBytes); }
+
+private:
+    void WriteUnsigned(uint64_t aValue) {
+        for (; aValue >= 0x80; aValue >>= 7)
+            mBytes.push_back((uint8_t)(aValue | 0x80));
+        mBytes.push_back((uint8_t)aValue);
+    }
+
+    std::vector<uint8_t> mBytes;
+    std::chrono::steady_clock::time_point mStart;
+    uint64_t mLastTime = 0;
+};
+
+class Reader {
+public:
+    Reader(const uint8_t* aData, size_t aSize)
+        : mPos(aData)
+        , mEnd(aData + aSize) {
+        mValid = aSize >= 5 && memcmp(aData, "TETR", 4) == 0 && aData[4] == Version;
+        if (mValid)
+            mPos += 5;
+    }
+
+    // False for a trace that isn't one, of another version or cut short; Next stops at the first bad event
+    bool IsValid() const { return mValid; }
+    bool IsAtEnd() const { return mPos == mEnd; }
+
+    bool Next(Event& aEvent) {
+        if (!mValid || mPos == mEnd)
+            return false;
+
+        uint64_t delta, count, op;
+        if (!ReadUnsigned(delta) || !ReadUnsigned(count) || count > MaxArgs || mPos == mEnd || (op = *mPos++) >= (uint64_t)Op::Count)
+            return mValid = false;
+        mTime += delta;
+        aEvent.mOp = (Op)op;
+        aEvent.mTime = mTime;
+        aEvent.mArgCount = (int)count;
+        for (int i = 0; i < MaxArgs; ++i) {
+            uint64_t value = 0;
+            if (i < (int)count && !ReadUnsigned(value))
+                return mValid = false;
+            aEvent.mArgs[i] = (int)((uint32_t)value >> 1) ^ -(int)(value & 1);
+        }
+        aEvent.mText.clear();
+        if (HasText(aEvent.mOp)) {
+            uint64_t length;
+            if (!ReadUnsigned(length) || length > (uint64_t)(mEnd - mPos))
+                return mValid = false;
+            aEvent.mText.assign((const char*)mPos, (size_t)length);
+            mPos += length;
+        }
+        return true;
+    }
+
+private:
+    bool ReadUnsigned(uint64_t& aValue) {
+        aValue = 0;
+        for (int shift = 0; mPos < mEnd && shift < 64; shift += 7) {
+            const uint8_t byte = *mPos++;
+            aValue |= (uint64_t)(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    const uint8_t* mPos;
+    const uint8_t* mEnd;
+    uint64_t mTime = 0;
+    bool mValid;
+};
+
+} // namespace EditTrace
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// What containers hold on the heap, for the memory usage the editor reports. Estimates where the standard library
+// doesn't tell: a string's capacity is exact, a hash container's nodes are not.
+namespace HeapBytes {
+
+// What a string holds outside itself, none while it is short enough to be kept inside
+inline size_t String(const std::string& aString) {
+    const char* data = aString.data();
+    const char* self = (const char*)&aString;
+    return data >= self && data < self + sizeof(aString) ? 0 : aString.capacity() + 1;
+}
+
+// Roughly what a hash container holds besides its elements' own heap: its buckets, and a node per element with a link
+// and the cached hash
+template <class T> size_t Hash(const T& aContainer) {
+    return aContainer.bucket_count() * sizeof(void*) + aContainer.size() * (sizeof(typename T::value_type) + sizeof(void*) + sizeof(size_t));
+}
+
+} // namespace HeapBytes
@@ -0,0 +1,626 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Compiles a prioritized list of token regexes into a single table-driven DFA over bytes.
+//
+// Match() answers the question TextEditor used to ask by trying each regex in turn with std::regex_search and
+// match_continuous: the first pattern in the list that matches at the position wins. Its match is the longest one,
+// which is what ECMAScript's greedy quantifiers give for token patterns; only contrived patterns where a greedy
+// quantifier starves a later optional part (".{1,2}(?:ba)?" on "xba") stop shorter under std::regex. Empty
+// matches are not reported, where std::regex would have stalled the colorizer on them.
+//
+// Only the part of ECMAScript that is regular is supported: literals and escapes, '.', character classes (with
+// \d \w \s and [:name:]), groups, alternation and the greedy quantifiers * + ? {n} {n,} {n,m}. Compile() fails on
+// anything else (anchors, \b, backreferences, lookaround, lazy quantifiers), and callers fall back to std::regex.
+class RegexDfa {
+public:
+    bool Compile(const std::vector<std::string>& aPatterns);
+    void Clear();
+    bool IsEmpty() const { return mTransitions.empty(); }
+    size_t GetMemoryUsage() const {
+        return sizeof(*this) + (mTransitions.capacity() + mAccept.capacity() + mLowestLive.capacity()) * sizeof(int32_t);
+    }
+
+    // Returns the index of the winning pattern and sets aOutEnd past its match, or -1 when no pattern matches.
+    int Match(const char* aBegin, const char* aEnd, const char*& aOutEnd) const;
+
+private:
+    typedef std::bitset<256> ByteSet;
+
+    struct Node {
+        enum class Type { Empty, Set, Concat, Alternate, Repeat };
+
+        Type mType = Type::Empty;
+        ByteSet mSet;
+        std::vector<std::unique_ptr<Node>> mChildren;
+        int mMin = 0;
+        int mMax = -1; // -1 for no upper bound
+    };
+
+    class Parser {
+    public:
+        Parser(const std::string& aPattern)
+            : mPos(aPattern.data())
+            , mEnd(aPattern.data() + aPattern.size()) {}
+
+        std::unique_ptr<Node> Parse();
+
+    private:
+        std::unique_ptr<Node> ParseAlternate();
+        std::unique_ptr<Node> ParseConcat();
+        std::unique_ptr<Node> ParseRepeat();
+        std::unique_ptr<Node> ParseAtom();
+        bool ParseClass(ByteSet& aSet);
+        bool ParseEscape(ByteSet& aSet, bool aInClass);
+        bool ParseNumber(int& aValue);
+
+        const char* mPos;
+        const char* mEnd;
+        bool mOk = true;
+    };
+
+    struct NfaState {
+        int mSet = -1; // index into the byte sets, -1 for a state with only epsilon moves
+        int mNext = -1;
+        std::vector<int> mEpsilon;
+        int mRule = 0;
+        bool mAccepting = false;
+    };
+
+    struct Nfa {
+        std::vector<NfaState> mStates;
+        std::vector<ByteSet> mSets;
+        int mRule = 0;
+    };
+
+    static std::pair<int, int> Build(Nfa& aNfa, const Node& aNode);
+    static int AddState(Nfa& aNfa);
+    static void Closure(const Nfa& aNfa, std::vector<int>& aStates);
+
+    enum { Dead = 0, Start = 1, MaxNfaStates = 1 << 16, MaxDfaStates = 1 << 12 };
+
+    std::array<uint8_t, 256> mByteClass{};
+    int mClassCount = 0;
+    std::vector<int32_t> mTransitions; // mClassCount entries per state
+    std::vector<int> mAccept;          // lowest pattern accepted in a state, -1 for none
+    std::vector<int> mLowestLive;      // lowest pattern that can still be matching in a state
+};
+
+inline void RegexDfa::Clear() {
+    mClassCount = 0;
+    mTransitions.clear();
+    mAccept.clear();
+    mLowestLive.clear();
+}
+
+inline int RegexDfa::Match(const char* aBegin, const char* aEnd, const char*& aOutEnd) const {
+    if (IsEmpty())
+        return -1;
+
+    int best = -1;
+    int state = Start;
+    for (const char* p = aBegin;;) {
+        // A lower pattern accepting here beats whatever was found before, even if that was longer
+        int accept = mAccept[state];
+        if (accept >= 0 && p != aBegin && (best < 0 || accept <= best)) {
+            best = accept;
+            aOutEnd = p;
+        }
+
+        if (p == aEnd || (best >= 0 && mLowestLive[state] > best))
+            break;
+
+        state = mTransitions[state * mClassCount + mByteClass[(uint8_t)*p++]];
+        if (state == Dead)
+            break;
+    }
+    return best;
+}
+
+inline std::unique_ptr<RegexDfa::Node> RegexDfa::Parser::Parse() {
+    auto node = ParseAlternate();
+    if (!mOk || mPos != mEnd)
+        return nullptr;
+    return node;
+}
+
+inline std::unique_ptr<RegexDfa::Node> RegexDfa::Parser::ParseAlternate() {
+    auto first = ParseConcat();
+    if (!mOk || mPos == mEnd || *mPos != '|')
+        return first;
+
+    auto node = std::make_unique<Node>();
+    node->mType = Node::Type::Alternate;
+    node->mChildren.push_back(std::move(first));
+    while (mOk && mPos < mEnd && *mPos == '|') {
+        ++mPos;
+        node->mChildren.push_back(ParseConcat());
+    }
+    return node;
+}
+
+inline std::unique_ptr<RegexDfa::Node> RegexDfa::Parser::ParseConcat() {
+    auto node = std::make_unique<Node>();
+    node->mType = Node::Type::Concat;
+    while (mOk && mPos < mEnd && *mPos != '|' && *mPos != ')')
+        node->mChildren.push_back(ParseRepeat());
+    return node;
+}
+
+inline std::unique_ptr<RegexDfa::Node> RegexDfa::Parser::ParseRepeat() {
+    auto atom = ParseAtom();
+    if (!mOk || mPos == mEnd)
+        return atom;
+
+    int min = 0, max = -1;
+    switch (*mPos) {
+    case '*':
+        ++mPos;
+        break;
+    case '+':
+        ++mPos;
+        min = 1;
+        break;
+    case '?':
+        ++mPos;
+        max = 1;
+        break;
+    case '{':
+        ++mPos;
+        if (!ParseNumber(min)) {
+            mOk = false;
+            return nullptr;
+        }
+        max = min;
+        if (mPos < mEnd && *mPos == ',') {
+            ++mPos;
+            max = -1;
+            if (mPos < mEnd && *mPos != '}' && (!ParseNumber(max) || max < min)) {
+                mOk = false;
+                return nullptr;
+            }
+        }
+        if (mPos == mEnd || *mPos != '}') {
+            mOk = false;
+            return nullptr;
+        }
+        ++mPos;
+        break;
+    default:
+        return atom;
+    }
+
+    // Lazy quantifiers want the shortest match, which a longest-match DFA can't give; a second quantifier is an error
+    if (mPos < mEnd && (*mPos == '?' || *mPos == '*' || *mPos == '+' || *mPos == '{')) {
+        mOk = false;
+        return nullptr;
+    }
+
+    auto node = std::make_unique<Node>();
+    node->mType = Node::Type::Repeat;
+    node->mMin = min;
+    node->mMax = max;
+    node->mChildren.push_back(std::move(atom));
+    return node;
+}
+
+inline std::unique_ptr<RegexDfa::Node> RegexDfa::Parser::ParseAtom() {
+    auto node = std::make_unique<Node>();
+    node->mType = Node::Type::Set;
+
+    switch (*mPos) {
+    case '(':
+        ++mPos;
+        if (mPos < mEnd && *mPos == '?') {
+            if (mPos + 1 < mEnd && mPos[1] == ':') {
+                mPos += 2;
+            } else {
+                mOk = false; // lookahead
+                return nullptr;
+            }
+        }
+        node = ParseAlternate();
+        if (!mOk || mPos == mEnd || *mPos != ')') {
+            mOk = false;
+            return nullptr;
+        }
+        ++mPos;
+        return node;
+    case '[':
+        ++mPos;
+        mOk = ParseClass(node->mSet);
+        return node;
+    case '.':
+        ++mPos;
+        node->mSet.set();
+        node->mSet.reset('\n');
+        node->mSet.reset('\r');
+        return node;
+    case '\\':
+        ++mPos;
+        mOk = ParseEscape(node->mSet, false);
+        return node;
+    case '^':
+    case '$':
+    case '*':
+    case '+':
+    case '?':
+    case '{':
+        mOk = false;
+        return nullptr;
+    default:
+        node->mSet.set((uint8_t)*mPos++);
+        return node;
+    }
+}
+
+inline bool RegexDfa::Parser::ParseClass(ByteSet& aSet) {
+    bool negate = false;
+    if (mPos < mEnd && *mPos == '^') {
+        negate = true;
+        ++mPos;
+    }
+
+    while (mPos < mEnd && *mPos != ']') {
+        ByteSet item;
+        int from = -1;
+        if (*mPos == '\\') {
+            ++mPos;
+            if (!ParseEscape(item, true))
+                return false;
+            if (item.count() == 1)
+                for (int c = 0; c < 256; ++c)
+                    if (item[c])
+                        from = c;
+        } else if (*mPos == '[' && mPos + 1 < mEnd && mPos[1] == ':') {
+            auto close = std::search(mPos + 2, mEnd, ":]", ":]" + 2);
+            if (close == mEnd)
+                return false;
+            std::string name(mPos + 2, close);
+            mPos = close + 2;
+
+            int (*test)(int) = nullptr;
+            if (name == "alpha")
+                test = [](int c) { return (int)((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')); };
+            else if (name == "digit")
+                test = [](int c) { return (int)(c >= '0' && c <= '9'); };
+            else if (name == "alnum")
+                test = [](int c) { return (int)((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')); };
+            else if (name == "xdigit")
+                test = [](int c) { return (int)((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F') || (c >= '0' && c <= '9')); };
+            else if (name == "upper")
+                test = [](int c) { return (int)(c >= 'A' && c <= 'Z'); };
+            else if (name == "lower")
+                test = [](int c) { return (int)(c >= 'a' && c <= 'z'); };
+            else if (name == "space")
+                test = [](int c) { return (int)(c == ' ' || (c >= '\t' && c <= '\r')); };
+            else if (name == "punct")
+                test = [](int c) { return (int)(c > ' ' && c < 0x7f && !((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))); };
+            else
+                return false;
+
+            for (int c = 0; c < 256; ++c)
+                if (test(c))
+                    item.set(c);
+        } else {
+            from = (uint8_t)*mPos++;
+            item.set(from);
+        }
+
+        // A range needs single characters at both ends; a trailing '-' is a literal
+        if (from >= 0 && mPos + 1 < mEnd && *mPos == '-' && mPos[1] != ']') {
+            ++mPos;
+            int to = -1;
+            if (*mPos == '\\') {
+                ++mPos;
+                ByteSet end;
+                if (!ParseEscape(end, true) || end.count() != 1)
+                    return false;
+                for (int c = 0; c < 256; ++c)
+                    if (end[c])
+                        to = c;
+            } else {
+                to = (uint8_t)*mPos++;
+            }
+            if (to < from)
+                return false;
+            for (int c = from; c <= to; ++c)
+                item.set(c);
+        }
+
+        aSet |= item;
+    }
+
+    if (mPos == mEnd)
+        return false;
+    ++mPos;
+
+    if (negate)
+        aSet.flip();
+    return true;
+}
+
+inline bool RegexDfa::Parser::ParseEscape(ByteSet& aSet, bool aInClass) {
+    if (mPos == mEnd)
+        return false;
+
+    auto hex = [&](int aDigits, int& aValue) {
+        aValue = 0;
+        for (int i = 0; i < aDigits; ++i, ++mPos) {
+            if (mPos == mEnd)
+                return false;
+            char c = *mPos;
+            int digit = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (digit < 0)
+                return false;
+            aValue = aValue * 16 + digit;
+        }
+        return true;
+    };
+
+    char c = *mPos++;
+    switch (c) {
+    case 'd':
+    case 'D':
+        for (int i = '0'; i <= '9'; ++i)
+            aSet.set(i);
+        break;
+    case 'w':
+    case 'W':
+        for (int i = 0; i < 256; ++i)
+            if ((i >= 'a' && i <= 'z') || (i >= 'A' && i <= 'Z') || (i >= '0' && i <= '9') || i == '_')
+                aSet.set(i);
+        break;
+    case 's':
+    case 'S':
+        for (auto i : {' ', '\t', '\n', '\v', '\f', '\r'})
+            aSet.set((uint8_t)i);
+        break;
+    case 't':
+        aSet.set('\t');
+        return true;
+    case 'n':
+        aSet.set('\n');
+        return true;
+    case 'r':
+        aSet.set('\r');
+        return true;
+    case 'f':
+        aSet.set('\f');
+        return true;
+    case 'v':
+        aSet.set('\v');
+        return true;
+    case '0':
+        aSet.set(0);
+        return true;
+    case 'b':
+        if (!aInClass)
+            return false; // word boundary
+        aSet.set('\b');
+        return true;
+    case 'x': {
+        int value;
+        if (!hex(2, value))
+            return false;
+        aSet.set(value);
+        return true;
+    }
+    case 'u': {
+        int value;
+        if (!hex(4, value) || value >= 0x80)
+            return false; // a single byte can't stand for the code point
+        aSet.set(value);
+        return true;
+    }
+    default:
+        if ((c >= '1' && c <= '9') || c == 'B' || c == 'c' || c == 'k')
+            return false; // backreferences, \B, control escapes
+        aSet.set((uint8_t)c);
+        return true;
+    }
+
+    if (c == 'D' || c == 'W' || c == 'S')
+        aSet.flip();
+    return true;
+}
+
+inline bool RegexDfa::Parser::ParseNumber(int& aValue) {
+    if (mPos == mEnd || *mPos < '0' || *mPos > '9')
+        return false;
+    aValue = 0;
+    while (mPos < mEnd && *mPos >= '0' && *mPos <= '9' && aValue < 1000)
+        aValue = aValue * 10 + (*mPos++ - '0');
+    return aValue < 1000;
+}
+
+inline int RegexDfa::AddState(Nfa& aNfa) {
+    aNfa.mStates.emplace_back();
+    aNfa.mStates.back().mRule = aNfa.mRule;
+    return (int)aNfa.mStates.size() - 1;
+}
+
+// Thompson construction: returns the fragment's start state and its end state, which has no moves yet.
+inline std::pair<int, int> RegexDfa::Build(Nfa& aNfa, const Node& aNode) {
+    if (aNfa.mStates.size() > MaxNfaStates)
+        return {0, 0};
+
+    switch (aNode.mType) {
+    case Node::Type::Set: {
+        int start = AddState(aNfa);
+        int end = AddState(aNfa);
+        aNfa.mSets.push_back(aNode.mSet);
+        aNfa.mStates[start].mSet = (int)aNfa.mSets.size() - 1;
+        aNfa.mStates[start].mNext = end;
+        return {start, end};
+    }
+    case Node::Type::Concat: {
+        int start = AddState(aNfa);
+        int end = start;
+        for (auto& child : aNode.mChildren) {
+            auto fragment = Build(aNfa, *child);
+            aNfa.mStates[end].mEpsilon.push_back(fragment.first);
+            end = fragment.second;
+        }
+        return {start, end};
+    }
+    case Node::Type::Alternate: {
+        int start = AddState(aNfa);
+        int end = AddState(aNfa);
+        for (auto& child : aNode.mChildren) {
+            auto fragment = Build(aNfa, *child);
+            aNfa.mStates[start].mEpsilon.push_back(fragment.first);
+            aNfa.mStates[fragment.second].mEpsilon.push_back(end);
+        }
+        return {start, end};
+    }
+    case Node::Type::Repeat: {
+        auto& child = *aNode.mChildren.front();
+        int start = AddState(aNfa);
+        int end = start;
+        for (int i = 0; i < aNode.mMin; ++i) {
+            auto fragment = Build(aNfa, child);
+            aNfa.mStates[end].mEpsilon.push_back(fragment.first);
+            end = fragment.second;
+        }
+
+        if (aNode.mMax < 0) {
+            auto fragment = Build(aNfa, child);
+            int loop = AddState(aNfa);
+            aNfa.mStates[end].mEpsilon.push_back(loop);
+            aNfa.mStates[loop].mEpsilon.push_back(fragment.first);
+            aNfa.mStates[fragment.second].mEpsilon.push_back(loop);
+            end = AddState(aNfa);
+            aNfa.mStates[loop].mEpsilon.push_back(end);
+        } else {
+            int optionalEnd = AddState(aNfa);
+            for (int i = aNode.mMin; i < aNode.mMax; ++i) {
+                auto fragment = Build(aNfa, child);
+                aNfa.mStates[end].mEpsilon.push_back(fragment.first);
+                aNfa.mStates[end].mEpsilon.push_back(optionalEnd);
+                end = fragment.second;
+            }
+            aNfa.mStates[end].mEpsilon.push_back(optionalEnd);
+            end = optionalEnd;
+        }
+        return {start, end};
+    }
+    default: {
+        int state = AddState(aNfa);
+        return {state, state};
+    }
+    }
+}
+
+inline void RegexDfa::Closure(const Nfa& aNfa, std::vector<int>& aStates) {
+    std::vector<bool> seen(aNfa.mStates.size());
+    std::vector<int> stack(aStates);
+    aStates.clear();
+    while (!stack.empty()) {
+        int state = stack.back();
+        stack.pop_back();
+        if (seen[state])
+            continue;
+        seen[state] = true;
+        aStates.push_back(state);
+        for (int next : aNfa.mStates[state].mEpsilon)
+            if (!seen[next])
+                stack.push_back(next);
+    }
+    std::sort(aStates.begin(), aStates.end());
+}
+
+inline bool RegexDfa::Compile(const std::vector<std::string>& aPatterns) {
+    Clear();
+    if (aPatterns.empty())
+        return false;
+
+    Nfa nfa;
+    std::vector<int> starts;
+    for (size_t i = 0; i < aPatterns.size(); ++i) {
+        auto node = Parser(aPatterns[i]).Parse();
+        if (node == nullptr)
+            return false;
+
+        nfa.mRule = (int)i;
+        auto fragment = Build(nfa, *node);
+        if (nfa.mStates.size() > MaxNfaStates)
+            return false;
+        nfa.mStates[fragment.second].mAccepting = true;
+        starts.push_back(fragment.first);
+    }
+
+    // Bytes that every set treats alike share a column in the transition table
+    std::map<std::vector<bool>, int> classes;
+    std::vector<int> representative;
+    for (int c = 0; c < 256; ++c) {
+        std::vector<bool> signature(nfa.mSets.size());
+        for (size_t i = 0; i < nfa.mSets.size(); ++i)
+            signature[i] = nfa.mSets[i][c];
+        auto it = classes.emplace(std::move(signature), (int)classes.size()).first;
+        mByteClass[c] = (uint8_t)it->second;
+        if (it->second == (int)representative.size())
+            representative.push_back(c);
+    }
+    mClassCount = (int)classes.size();
+
+    // Subset construction, with state 0 as the dead state and state 1 as the start
+    std::map<std::vector<int>, int> ids;
+    std::vector<std::vector<int>> sets;
+    auto add = [&](std::vector<int>&& aSet) {
+        auto it = ids.find(aSet);
+        if (it != ids.end())
+            return it->second;
+
+        int id = (int)sets.size();
+        int accept = -1, lowestLive = (int)aPatterns.size();
+        for (int state : aSet) {
+            auto& s = nfa.mStates[state];
+            if (s.mRule < lowestLive)
+                lowestLive = s.mRule;
+            if (s.mAccepting && (accept < 0 || s.mRule < accept))
+                accept = s.mRule;
+        }
+        mAccept.push_back(accept);
+        mLowestLive.push_back(lowestLive);
+        ids.emplace(aSet, id);
+        sets.push_back(std::move(aSet));
+        return id;
+    };
+
+    add(std::vector<int>());
+    Closure(nfa, starts);
+    add(std::move(starts));
+
+    for (size_t id = 0; id < sets.size(); ++id) {
+        if (sets.size() > MaxDfaStates) {
+            Clear();
+            return false;
+        }
+
+        mTransitions.resize((id + 1) * mClassCount);
+        for (int cls = 0; cls < mClassCount; ++cls) {
+            std::vector<int> next;
+            for (int state : sets[id]) {
+                auto& s = nfa.mStates[state];
+                if (s.mSet >= 0 && nfa.mSets[s.mSet][representative[cls]])
+                    next.push_back(s.mNext);
+            }
+            int target = Dead;
+            if (!next.empty()) {
+                Closure(nfa, next);
+                target = add(std::move(next));
+            }
+            mTransitions[id * mClassCount + cls] = target;
+        }
+    }
+    return true;
+}
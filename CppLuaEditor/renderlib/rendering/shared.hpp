@@ -1,22 +1,34 @@
 #pragma once
 
 #include <cstdint>
+#ifdef _WIN32
 #include <wrl/client.h>
 
 template<typename T> using ComPtr = Microsoft::WRL::ComPtr<T>;
+#endif
 #pragma once
 
 #include <imgui.h>
 #include <array>
+#include <condition_variable>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <regex>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include <cassert>
 
+#include "completion_index.hpp"
+#include "edit_trace.hpp"
+#include "regex_dfa.hpp"
+#include "text_search.hpp"
+
 /*
 MIT License
 
@@ -43,7 +55,7 @@ SOFTWARE.
 
 class TextEditor {
 public:
-    enum class PaletteIndex {
+    enum class PaletteIndex : uint8_t {
         Default,
         Keyword,
         Number,
@@ -65,6 +77,8 @@ public:
         CurrentLineFill,
         CurrentLineFillInactive,
         CurrentLineEdge,
+        FindMatch,
+        MatchingBlock,
         Max
     };
 
@@ -145,23 +159,297 @@ public:
     typedef std::array<ImU32, (unsigned)PaletteIndex::Max> Palette;
     typedef uint8_t Char;
 
-    struct Glyph {
-        Char mChar;
-        PaletteIndex mColorIndex = PaletteIndex::Default;
+    // How the colorizer classified a character: its token kind, and whether it is inside a comment (which overrides the
+    // kind) or a preprocessor directive (which tints it).
+    struct Style {
+        PaletteIndex mKind;
         bool mComment : 1;
         bool mMultiLineComment : 1;
         bool mPreprocessor : 1;
 
-        Glyph(Char aChar, PaletteIndex aColorIndex)
-            : mChar(aChar)
-            , mColorIndex(aColorIndex)
+        Style()
+            : mKind(PaletteIndex::Default)
             , mComment(false)
             , mMultiLineComment(false)
             , mPreprocessor(false) {}
+
+        bool operator==(const Style& o) const {
+            return mKind == o.mKind && mComment == o.mComment && mMultiLineComment == o.mMultiLineComment && mPreprocessor == o.mPreprocessor;
+        }
+
+        bool operator!=(const Style& o) const { return !(*this == o); }
+    };
+
+    // mLength bytes of a line from mOffset on, all with the same style.
+    struct TokenRun {
+        static constexpr uint32_t MaxLength = 0xffff;
+
+        uint32_t mOffset;
+        uint16_t mLength;
+        Style mStyle;
+    };
+
+    // Comment/string/preprocessor state of the colorizer at the start of a line.
+    // Everything but mMultiLineComment only carries over a line that ends with a '\'.
+    struct LineState {
+        bool mMultiLineComment : 1;
+        bool mString : 1;
+        bool mConcatenate : 1;
+        bool mSingleLineComment : 1;
+        bool mPreprocessor : 1;
+        bool mFirstChar : 1;
+
+        LineState()
+            : mMultiLineComment(false)
+            , mString(false)
+            , mConcatenate(false)
+            , mSingleLineComment(false)
+            , mPreprocessor(false)
+            , mFirstChar(true) {}
+
+        bool operator==(const LineState& o) const {
+            return mMultiLineComment == o.mMultiLineComment && mString == o.mString && mConcatenate == o.mConcatenate &&
+                   mSingleLineComment == o.mSingleLineComment && mPreprocessor == o.mPreprocessor && mFirstChar == o.mFirstChar;
+        }
+
+        bool operator!=(const LineState& o) const { return !(*this == o); }
+    };
+
+    // What a line does to the nesting of blocks once the blocks it opens and closes itself are paired up: it closes
+    // mCloses blocks opened before it, then leaves mOpens blocks open after it. Blocks are brackets, multi-line
+    // comments and the language's block keywords. Joining those of a range of lines gives the same for the range.
+    struct Blocks {
+        uint32_t mCloses = 0;
+        uint32_t mOpens = 0;
+
+        static Blocks Join(const Blocks& aFirst, const Blocks& aThen) {
+            Blocks joined;
+            joined.mCloses = aFirst.mCloses + (aThen.mCloses > aFirst.mOpens ? aThen.mCloses - aFirst.mOpens : 0);
+            joined.mOpens = aThen.mOpens + (aFirst.mOpens > aThen.mCloses ? aFirst.mOpens - aThen.mCloses : 0);
+            return joined;
+        }
+
+        bool operator==(const Blocks& o) const { return mCloses == o.mCloses && mOpens == o.mOpens; }
+        bool operator!=(const Blocks& o) const { return !(*this == o); }
+    };
+
+    // What a definition on a line is, for the outline. A Method is a function stored in a table, like "M.new" or
+    // "Class:method", or a function field of a table constructor.
+    enum class SymbolKind : uint8_t { Function, LocalFunction, Method, Local };
+
+    // A definition on a line: its name is mLength bytes from mOffset, dotted path included
+    struct OutlineSymbol {
+        uint32_t mOffset;
+        uint16_t mLength;
+        SymbolKind mKind;
+
+        bool operator==(const OutlineSymbol& o) const { return mOffset == o.mOffset && mLength == o.mLength && mKind == o.mKind; }
+        bool operator!=(const OutlineSymbol& o) const { return !(*this == o); }
     };
 
-    typedef std::vector<Glyph> Line;
-    typedef std::vector<Line> Lines;
+    // A line's text and the runs it is colored with, plus the state the colorizer had reached at its start.
+    // Bytes no run covers are uncolored. Edits should go through InsertText/EraseText/AppendText, which keep the runs
+    // on the same characters until the colorizer gets to the line again, and drop the column index.
+    struct Line : public std::string {
+        using std::string::basic_string;
+
+        Style GetStyle(size_t aIndex) const;
+        void InsertText(size_t aIndex, const char* aText, size_t aLength, PaletteIndex aKind = PaletteIndex::Default);
+        void EraseText(size_t aStart, size_t aEnd);
+        void AppendText(const Line& aFrom, size_t aStart, size_t aEnd);
+
+        // Where every ColumnIndex::Stride-th character of a long line starts: byte offset, column and pixel x.
+        // Column and pixel lookups binary search it and walk at most Stride characters from there.
+        struct ColumnStop {
+            uint32_t mIndex;
+            int mColumn;
+            float mX;
+        };
+
+        struct ColumnIndex {
+            static constexpr size_t MinLineLength = 64; // shorter lines are cheap enough to walk from the start
+            static constexpr int Stride = 16;
+
+            std::vector<ColumnStop> mStops; // mStops[k] is character k * Stride
+            int mCharacterCount = 0;
+            int mMaxColumn = 0;
+            int mTabSize = 0; // the columns were laid out for this tab size
+            const ImFont* mFont = nullptr; // mX and mWidth were measured with this font, not at all while null
+            float mFontSize = 0.0f;
+            float mWidth = 0.0f;
+        };
+
+        // Where the rows of a soft-wrapped line start, after the first one, and what it was wrapped for
+        struct WrapIndex {
+            std::vector<uint32_t> mRowStarts; // byte offsets, the first row starts at 0
+            std::vector<float> mRowWidths; // one per row
+            float mWidth = 0.0f;
+            int mTabSize = 0;
+            const ImFont* mFont = nullptr;
+            float mFontSize = 0.0f;
+
+            int GetRows() const { return (int)mRowStarts.size() + 1; }
+        };
+
+        std::vector<TokenRun> mRuns; // ordered by offset, not overlapping
+        LineState mEntryState;
+        uint64_t mRevision = 0; // editor version of the last edit to this line
+        mutable std::shared_ptr<ColumnIndex> mColumns; // built on the first lookup, dropped by the edit helpers
+        mutable std::shared_ptr<WrapIndex> mWrap; // likewise, while word wrap is on
+        uint64_t mDrawId = 0; // names what Render cached of the line, 0 until it is drawn and again after an edit
+        Blocks mBlocks; // found by the colorizer along with the runs
+        uint32_t mFolded = 0; // while the line is folded, how many lines after it are hidden under it
+        std::vector<uint32_t> mSymbols; // its identifiers' words in mCompletions, as the colorizer last found them
+        std::vector<OutlineSymbol> mOutline; // the functions and locals it defines, likewise
+        bool mBreakpoint = false;
+        uint32_t mError = 0; // its error marker's message in mErrorMessages, plus one; 0 for none
+    };
+
+    // The document's lines, kept in an implicit treap (a rope of lines) ordered by line index.
+    // Inserting or removing a line anywhere costs O(log n) instead of shifting every line after it.
+    // Random access is O(log n), with a cached "finger" that makes stepping to a neighbouring line O(1);
+    // code that walks many lines in order should use the iterators.
+    // Each line also takes up a number of rows on screen, one unless word wrap breaks it up, none while it is hidden
+    // under a folded line. The subtrees count their rows too, so going between a line and its first row is O(log n) as
+    // well. They also join up their lines' Blocks, which finds where a block ends or starts in O(log n).
+    class Lines {
+        struct Node;
+
+    public:
+        template <typename T> class Iterator {
+        public:
+            Iterator()
+                : mNode(nullptr) {}
+
+            T& operator*() const { return mNode->mLine; }
+            T* operator->() const { return &mNode->mLine; }
+
+            Iterator& operator++() {
+                mNode = Next(mNode);
+                return *this;
+            }
+
+            bool operator==(const Iterator& o) const { return mNode == o.mNode; }
+            bool operator!=(const Iterator& o) const { return mNode != o.mNode; }
+
+        private:
+            friend class Lines;
+            explicit Iterator(Node* aNode)
+                : mNode(aNode) {}
+
+            Node* mNode;
+        };
+
+        typedef Iterator<Line> iterator;
+        typedef Iterator<const Line> const_iterator;
+
+        Lines();
+        Lines(const Lines& aOther);
+        Lines(Lines&& aOther) noexcept;
+        ~Lines();
+
+        Lines& operator=(const Lines& aOther);
+        Lines& operator=(Lines&& aOther) noexcept;
+
+        size_t size() const { return mRoot != nullptr ? mRoot->mCount : 0; }
+        bool empty() const { return mRoot == nullptr; }
+        size_t GetNodeBytes() const { return size() * sizeof(Node); }
+
+        Line& operator[](size_t aIndex) { return Find(aIndex)->mLine; }
+        const Line& operator[](size_t aIndex) const { return Find(aIndex)->mLine; }
+        Line& at(size_t aIndex) { return (*this)[aIndex]; }
+        const Line& at(size_t aIndex) const { return (*this)[aIndex]; }
+        Line& front() { return (*this)[0]; }
+        Line& back() { return (*this)[size() - 1]; }
+
+        iterator begin() { return iterator(First(mRoot)); }
+        iterator end() { return iterator(); }
+        const_iterator begin() const { return const_iterator(First(mRoot)); }
+        const_iterator end() const { return const_iterator(); }
+
+        // Iterator positioned on line aIndex (end() if out of range), found in O(log n).
+        iterator iterator_at(size_t aIndex) { return aIndex < size() ? iterator(Find(aIndex)) : end(); }
+        const_iterator iterator_at(size_t aIndex) const { return aIndex < size() ? const_iterator(Find(aIndex)) : end(); }
+
+        void clear();
+        void assign(std::vector<Line>&& aLines);
+        Line& insert(size_t aIndex) { return insert(aIndex, Line()); }
+        Line& insert(size_t aIndex, Line&& aLine);
+        // aLines before line aIndex, in O(log n) plus O(aLines.size()) to put them in a treap of their own
+        void insert(size_t aIndex, std::vector<Line>&& aLines);
+        void erase(size_t aIndex) { erase(aIndex, aIndex + 1); }
+        void erase(size_t aStart, size_t aEnd);
+        Line& push_back(Line&& aLine) { return insert(size(), std::move(aLine)); }
+        Line& emplace_back() { return insert(size()); }
+        Line& emplace_back(Line&& aLine) { return insert(size(), std::move(aLine)); }
+
+        // Rows are layout, kept up to date by whoever wraps the lines, so they can be set on const Lines too
+        size_t rows() const { return RowCount(mRoot); }
+        int GetRows(size_t aIndex) const { return (int)Find(aIndex)->mRows; }
+        void SetRows(size_t aIndex, int aRows) const;
+        void ResetRows();
+        size_t GetFirstRow(size_t aIndex) const;
+        // Line that row aRow is on (size() past the last row), and which of its rows it is
+        size_t FindRow(size_t aRow, int& aRowInLine) const;
+        bool IsHidden(size_t aIndex) const { return Find(aIndex)->mRows == 0; }
+
+        // To be called after a line's mBlocks changed
+        void UpdateBlocks(size_t aIndex);
+        // The first line after aIndex by which aDepth of the blocks open after aIndex are closed, size() if there is none.
+        // aBetween gets the lines in between joined up.
+        size_t FindBlockEnd(size_t aIndex, uint32_t aDepth, Blocks* aBetween = nullptr) const;
+        // The last line before aIndex from which aDepth blocks are still open at aIndex, size() if there is none
+        size_t FindBlockStart(size_t aIndex, uint32_t aDepth, Blocks* aBetween = nullptr) const;
+        // The lines before aIndex joined up; mOpens is how many blocks are open where aIndex starts
+        Blocks GetBlocksBefore(size_t aIndex) const;
+
+        // To be called after the number of a line's mOutline symbols changed
+        void UpdateOutline(size_t aIndex);
+        size_t GetOutlineSize() const { return OutlineCount(mRoot); }
+        // Line that outline symbol aSymbol is on, and which of its symbols it is
+        size_t FindOutline(size_t aSymbol, int& aInLine) const;
+        // Outline symbols on the lines before aIndex
+        size_t CountOutlineBefore(size_t aIndex) const;
+
+    private:
+        struct Node {
+            Line mLine;
+            Node* mLeft;
+            Node* mRight;
+            Node* mParent;
+            uint32_t mPriority;
+            uint32_t mCount; // lines in this subtree
+            uint32_t mRows; // rows of this line
+            uint32_t mRowCount; // rows of the lines in this subtree
+            Blocks mBlockSum; // of the lines in this subtree, joined in order
+            uint32_t mOutlineCount; // outline symbols of the lines in this subtree
+        };
+
+        static uint32_t Count(const Node* aNode) { return aNode != nullptr ? aNode->mCount : 0; }
+        static uint32_t RowCount(const Node* aNode) { return aNode != nullptr ? aNode->mRowCount : 0; }
+        static Blocks BlockSum(const Node* aNode) { return aNode != nullptr ? aNode->mBlockSum : Blocks(); }
+        static uint32_t OutlineCount(const Node* aNode) { return aNode != nullptr ? aNode->mOutlineCount : 0; }
+        static void Update(Node* aNode);
+        static void UpdateSubtree(Node* aNode);
+        static Node* First(Node* aNode);
+        static Node* Next(Node* aNode);
+        static Node* Prev(Node* aNode);
+        static void Split(Node* aNode, size_t aCount, Node*& aLeft, Node*& aRight);
+        static Node* Merge(Node* aLeft, Node* aRight);
+        static Node* Clone(const Node* aNode, Node* aParent);
+        static void Destroy(Node* aNode);
+
+        Node* Find(size_t aIndex) const;
+        Node* Build(std::vector<Line>&& aLines);
+        void SetRoot(Node* aRoot);
+        uint32_t NextPriority();
+
+        Node* mRoot;
+        uint32_t mSeed;
+
+        mutable Node* mFinger;
+        mutable size_t mFingerIndex;
+    };
 
     struct LanguageDefinition {
         typedef std::pair<std::string, PaletteIndex> TokenRegexString;
@@ -176,6 +464,7 @@ public:
         std::string mCommentStart, mCommentEnd, mSingleLineComment;
         char mPreprocChar;
         bool mAutoIndentation;
+        Keywords mBlockStarts, mBlockEnds; // keywords that open or close a block, besides brackets; "else" can do both
 
         TokenizeCallback mTokenize;
 
@@ -199,17 +488,29 @@ public:
     TextEditor();
     ~TextEditor();
 
+    // The definitions CPlusPlus() and the like return are shared by all the editors on them, along with what is built
+    // from them; any other is copied.
     void SetLanguageDefinition(const LanguageDefinition& aLanguageDef);
-    const LanguageDefinition& GetLanguageDefinition() const { return mLanguageDefinition; }
+    // Shared by all the editors given the same one, along with what is built from it
+    void SetLanguageDefinition(std::shared_ptr<const LanguageDefinition> aLanguageDef);
+    const LanguageDefinition& GetLanguageDefinition() const { return *mLanguage->mDefinition; }
 
     const Palette& GetPalette() const { return mPaletteBase; }
     void SetPalette(const Palette& aValue);
 
-    void SetErrorMarkers(const ErrorMarkers& aMarkers) { mErrorMarkers = aMarkers; }
-    void SetBreakpoints(const Breakpoints& aMarkers) { mBreakpoints = aMarkers; }
+    // Markers are keyed by line number from 1. They are kept on their lines, so they move along as lines are inserted
+    // or removed above them, and go with a removed line. Markers past the last line are dropped.
+    void SetErrorMarkers(const ErrorMarkers& aMarkers);
+    void SetBreakpoints(const Breakpoints& aMarkers);
+    ErrorMarkers GetErrorMarkers() const;
+    Breakpoints GetBreakpoints() const;
 
     void Render(const char* aTitle, const ImVec2& aSize = ImVec2(), bool aBorder = false);
     void SetText(const std::string& aText);
+    void SetText(const char* aText, size_t aLength); // for text that isn't in a std::string, e.g. a mapped file
+    // Whether SetText was last given well-formed UTF-8. The text is kept byte for byte either way; a byte that isn't
+    // part of a UTF-8 sequence is a character of its own.
+    bool IsTextUtf8() const { return mTextUtf8; }
     std::string GetText() const;
 
     void SetTextLines(const std::vector<std::string>& aLines);
@@ -224,11 +525,49 @@ public:
     void SetReadOnly(bool aValue);
     bool IsReadOnly() const { return mReadOnly; }
     bool IsTextChanged() const { return mTextChanged; }
+
+    // One change to the text: the bytes from (mStartLine, mStartIndex) up to (mEndLine, mEndIndex) were replaced by
+    // mText. Lines and byte offsets refer to the text just before the change, so applying changes in order to a copy
+    // of the text keeps the copy in sync. mVersion is the text version the change produced.
+    struct TextChange {
+        int mStartLine, mStartIndex;
+        int mEndLine, mEndIndex;
+        std::string mText;
+        uint64_t mVersion;
+    };
+
+    // Bumped by every change to the text, SetText and SetTextLines included
+    uint64_t GetTextVersion() const { return mTextVersion; }
+    // Appends the changes that led from text version aVersion to the current one. Returns false when the journal no
+    // longer reaches back that far (it only keeps the most recent changes and SetText starts it over); GetText() is
+    // the way to catch up then.
+    bool GetTextChanges(uint64_t aVersion, std::vector<TextChange>& aChanges) const;
+
+    // What the editor holds in memory, in bytes. mShared is held together with the other editors on the same language
+    // and counted in each of them, so GetTotal leaves it out.
+    struct MemoryUsage {
+        size_t mText = 0; // the lines
+        size_t mColors = 0; // their token runs, symbols and outline
+        size_t mCaches = 0; // column and wrap indexes and what Render kept of the lines
+        size_t mUndo = 0; // undo records and the text change journal
+        size_t mShared = 0; // the language: its definition, compiled token regexes and builtin words
+
+        size_t GetTotal() const { return mText + mColors + mCaches + mUndo; }
+    };
+    // Walks every line, so it is for now and then rather than every frame
+    MemoryUsage GetMemoryUsage() const;
+    // Drops the caches that make drawing and moving around quick, for an editor that is out of sight for a while. The
+    // text, its colors and the undo records stay; the caches are built again as they are needed.
+    void Compact();
     bool IsCursorPositionChanged() const { return mCursorPositionChanged; }
     void ToggleComment(bool shift);
     bool IsColorizerEnabled() const { return mColorizerEnabled; }
     void SetColorizerEnable(bool aValue);
 
+    // Colorize on a worker thread; Render only copies lines out and merges finished results back in.
+    bool IsBackgroundColorizerEnabled() const { return mBackgroundColorizer; }
+    void SetBackgroundColorizer(bool aValue);
+
     Coordinates GetCursorPosition() const { return GetActualCursorCoordinates(); }
     void SetCursorPosition(const Coordinates& aPosition);
 
@@ -244,6 +583,19 @@ public:
     inline void SetShowWhitespaces(bool aValue) { mShowWhitespaces = aValue; }
     inline bool IsShowingWhitespaces() const { return mShowWhitespaces; }
 
+    void SetWordWrap(bool aValue);
+    inline bool IsWordWrapEnabled() const { return mWordWrap; }
+
+    // Completes the identifier before the cursor with the language's keywords and known identifiers and the document's
+    // identifiers. The popup opens while typing one, unless auto-complete is off, and with Ctrl+Space; Up and Down pick
+    // a word, Tab or Enter takes it and Escape closes the popup.
+    inline void SetAutoComplete(bool aValue) { mAutoComplete = aValue; }
+    inline bool IsAutoCompleteEnabled() const { return mAutoComplete; }
+    void OpenCompletion();
+    inline void CloseCompletion() { mCompletion.mOpen = false; }
+    inline bool IsCompletionOpen() const { return mCompletion.mOpen; }
+    void Complete(const std::string& aWord); // replaces the identifier before the cursor, as one undo record
+
     void SetTabSize(int aValue);
     inline int GetTabSize() const { return mTabSize; }
 
@@ -271,26 +623,166 @@ public:
     void Paste();
     void Delete();
 
+    // Find and replace, a line at a time: matches don't span line breaks. The matches in view are highlighted.
+    // SetFindPattern returns false, and nothing is found, for an empty pattern or a regex that doesn't compile.
+    bool SetFindPattern(const std::string& aPattern, const TextSearch::Options& aOptions = TextSearch::Options());
+    bool FindNext(); // selects the next match after the selection or cursor, from the top again past the last one
+    bool FindPrevious();
+    int ReplaceAll(const std::string& aReplacement); // one undo record, an edit per match; returns the match count
+
+    // Folding a line that opens a block hides the lines after it up to the one that closes the block. The cursor steps
+    // over the folded block like over one line; it unfolds again when the cursor lands in it or lines come or go in
+    // it. Ctrl+Shift+[ folds the block at the cursor and Ctrl+Shift+] unfolds it, or click the marker by the line number.
+    bool IsFoldable(int aLine) const { return GetFoldEnd(aLine) >= 0; }
+    bool IsFolded(int aLine) const { return mLines[aLine].mFolded != 0; }
+    bool Fold(int aLine);
+    void Unfold(int aLine);
+
+    // The bracket or block keyword at the cursor, or right before it, and the one that closes or opens the same block,
+    // such as the function an end closes. Both are highlighted; Ctrl+] moves the cursor to the partner.
+    bool GetMatchingBlock(Coordinates& aStart, Coordinates& aEnd, Coordinates& aPartnerStart, Coordinates& aPartnerEnd);
+    bool JumpToMatchingBlock();
+
+    // More cursors besides the main one, each with its own selection. Typing, Backspace, Delete, Cut, Paste and the
+    // cursor movements act at all of them, and each keystroke changes the text in one batch: one undo record and one
+    // colorize for every cursor's edit. Alt+click adds a cursor or removes one, Ctrl+Alt+Up/Down adds one on the line
+    // above or below, Ctrl+D selects the next match of the selection with one more, and Escape or a click goes back to
+    // the main cursor alone. Shift+Alt with a drag or the arrow keys selects a column: a cursor per line, each with the
+    // columns between the two corners selected.
+    void AddCursor(const Coordinates& aPosition);
+    void AddCursor(const Coordinates& aSelectionStart, const Coordinates& aSelectionEnd); // the cursor goes at the end
+    bool RemoveCursor(const Coordinates& aPosition); // not the main one
+    bool AddCursorAtNextMatch();
+    void SetColumnSelection(const Coordinates& aStart, const Coordinates& aEnd); // aEnd is where the main cursor goes
+    void ClearCursors();
+    int GetCursorCount() const { return 1 + (int)mState.mCursors.size(); }
+
+    // The Lua functions, local functions, table methods and locals the document defines, in order. They are found line
+    // by line as lines are colorized and counted in the line tree, so an edit costs only its own lines and an item is
+    // found in O(log n). RenderOutline lists them in a child window; clicking one selects its name.
+    struct OutlineItem {
+        Coordinates mStart; // of the name
+        Coordinates mEnd;
+        SymbolKind mKind;
+        int mDepth; // blocks open at the start of its line
+        std::string_view mName; // valid until the text changes
+    };
+    int GetOutlineSize() const { return (int)mLines.GetOutlineSize(); }
+    bool GetOutlineItem(int aIndex, OutlineItem& aItem) const;
+    void RenderOutline(const char* aTitle, const ImVec2& aSize = ImVec2(), bool aBorder = false);
+
     bool CanUndo() const;
     bool CanRedo() const;
     void Undo(int aSteps = 1);
     void Redo(int aSteps = 1);
 
+    // The undo history is kept under this many bytes by dropping its oldest records, but never the latest one
+    static constexpr size_t DefaultUndoBudget = 8 << 20;
+    void SetUndoBudget(size_t aBytes);
+    inline size_t GetUndoBudget() const { return mUndoBudget; }
+    inline size_t GetUndoBytes() const { return mUndoBytes; }
+
+    // Records every operation done on the editor from here on into an EditTrace, starting with the current text and
+    // cursor, so that replaying the trace on any editor goes through the same session
+    void StartTrace();
+    std::vector<uint8_t> StopTrace();
+    bool IsTracing() const { return mTrace != nullptr; }
+    // Does the operation aEvent recorded. Paste goes through the clipboard, so this needs an ImGui context. The word moves
+    // and selections read the colors and completion reads the words colorizing collects, which the recording editor had
+    // finished between frames: the replay only matches the recording if colorizing is finished after every event, as
+    // bench/trace_replay.cpp does.
+    void ReplayTraceEvent(const EditTrace::Event& aEvent);
+
     static const Palette& GetDarkPalette();
     static const Palette& GetLightPalette();
     static const Palette& GetRetroBluePalette();
 
 private:
+    friend class TextEditorBench; // bench/headless.hpp, for timing the keystroke and colorizer paths directly
+
     typedef std::vector<std::pair<std::regex, PaletteIndex>> RegexList;
 
+    // Scratch space for colorizing a line, kept around between lines
+    struct ColorizeBuffers {
+        std::vector<Style> mStyles; // one per byte
+        std::vector<TokenRun> mRuns;
+    };
+
+    // What the editors on the same language definition share: the definition itself, its token regexes compiled into
+    // one DFA and its builtin words
+    struct Language {
+        Language(std::shared_ptr<const LanguageDefinition> aDefinition, std::vector<std::string> aBuiltins)
+            : mDefinition(std::move(aDefinition))
+            , mBuiltins(std::move(aBuiltins)) {}
+
+        size_t GetMemoryUsage() const;
+
+        std::shared_ptr<const LanguageDefinition> mDefinition;
+        RegexDfa mRegexDfa; // empty when it can't take the token regexes
+        CompletionIndex::Builtins mBuiltins;
+    };
+
+    static std::shared_ptr<const Language> GetLanguage(std::shared_ptr<const LanguageDefinition> aDefinition);
+
+    // What Render drew for a line: the vertices and indices of its number, then of its text, with positions relative
+    // to where the text starts. They are copied back into the draw list for as long as the line, what it is drawn
+    // with and where it falls against the clip rect stay the same.
+    struct LineDraw {
+        uint64_t mId = 0; // Line::mDrawId
+        int mLine = -1;
+        uint64_t mGeneration = 0; // of the DrawStyle
+        ImVec2 mFraction; // of the origin, which decides where glyphs snap to pixels
+        float mClipMinX = 0.0f; // relative to the origin like the vertices, glyphs outside are left out
+        float mClipMaxX = 0.0f;
+        int mNumberVertices = 0;
+        int mNumberIndices = 0;
+        float mWidth = -1.0f; // of the whole line, not measured yet while negative
+        std::vector<ImDrawVert> mVertices;
+        std::vector<ImDrawIdx> mIndices;
+    };
+
+    // Everything besides the line that decides what it looks like
+    struct DrawStyle {
+        const ImFont* mFont = nullptr;
+        float mFontSize = 0.0f;
+        int mTabSize = 0;
+        bool mShowWhitespaces = false;
+        float mWrapWidth = 0.0f; // 0 without word wrap
+        Palette mPalette = {};
+
+        bool operator==(const DrawStyle& o) const {
+            return mFont == o.mFont && mFontSize == o.mFontSize && mTabSize == o.mTabSize && mShowWhitespaces == o.mShowWhitespaces &&
+                   mWrapWidth == o.mWrapWidth && mPalette == o.mPalette;
+        }
+
+        bool operator!=(const DrawStyle& o) const { return !(*this == o); }
+    };
+
+    struct Cursor {
+        Coordinates mSelectionStart;
+        Coordinates mSelectionEnd;
+        Coordinates mCursorPosition;
+    };
+
     struct EditorState {
         Coordinates mSelectionStart;
         Coordinates mSelectionEnd;
         Coordinates mCursorPosition;
+        std::vector<Cursor> mCursors; // besides the one above, ordered by position and not overlapping it or each other
+    };
+
+    // An edit at the front of a line: mRemoved bytes at byte mIndex replaced by mAdded bytes
+    struct LinePrefix {
+        uint32_t mIndex;
+        uint8_t mRemoved;
+        uint8_t mAdded;
     };
 
     class UndoRecord {
     public:
+        // Runs of single character edits that AddUndo folds into one record
+        enum class Group : uint8_t { None, Typing, Backspace, Delete };
+
         UndoRecord() {}
         ~UndoRecord() {}
 
@@ -313,15 +805,121 @@ private:
 
         EditorState mBefore;
         EditorState mAfter;
+
+        Group mGroup = Group::None;
+
+        // An edit at several cursors keeps one record per cursor here, in order, instead of the text above. Each one's
+        // coordinates are the ones it had with the edits before it done, so Redo goes first to last and Undo back.
+        std::vector<UndoRecord> mBatch;
+
+        // An edit at the front of each line from mPrefixLine on, as commenting or indenting a block makes, kept a line
+        // at a time instead of as the text above. The bytes each one removes and then the ones it adds follow each
+        // other in mPrefixText.
+        int mPrefixLine = 0;
+        std::vector<LinePrefix> mPrefixes;
+        std::string mPrefixText;
+
+    private:
+        void UndoText(TextEditor* aEditor, bool aColorize) const;
+        void RedoText(TextEditor* aEditor, bool aColorize) const;
+    };
+
+    // What one cursor's part of a batched edit replaces, and with what
+    struct CursorEdit {
+        Coordinates mStart;
+        Coordinates mEnd;
+        std::string mText;
     };
 
-    typedef std::vector<UndoRecord> UndoBuffer;
+    typedef std::deque<UndoRecord> UndoBuffer;
+
+    // Lets an operation record itself in mTrace, unless another recorded operation is calling it
+    class TraceScope {
+    public:
+        TraceScope(TextEditor* aEditor)
+            : mEditor(aEditor)
+            , mRecording(aEditor->mTrace != nullptr && !aEditor->mTraceBusy) {
+            if (mRecording)
+                mEditor->mTraceBusy = true;
+        }
+        ~TraceScope() {
+            if (mRecording)
+                mEditor->mTraceBusy = false;
+        }
+        explicit operator bool() const { return mRecording; }
+
+    private:
+        TextEditor* mEditor;
+        bool mRecording;
+    };
 
     void ProcessInputs();
     void Colorize(int aFromLine = 0, int aCount = -1);
-    void ColorizeRange(int aFromLine = 0, int aToLine = 0);
+    void QueueColorize(int aFromLine, int aToLine);
+    LineState ColorizeLine(Line& aLine, LineState aState, ColorizeBuffers& aBuffers) const;
+    LineState ColorizeComments(const Line& aLine, LineState aState, Style* aStyles) const;
+    // A token that opens or closes a block, as ScanBlocks meets them: a bracket, a block keyword, or where a multi-line
+    // comment starts or ends (with no length)
+    struct BlockToken {
+        uint32_t mOffset;
+        uint32_t mLength;
+        bool mCloses;
+        bool mOpens; // both for a keyword like else
+        char mBracket; // the bracket, '-' for a comment and 0 for a keyword
+    };
+
+    // The block token at a cursor position and its partner, until the cursor moves, the text changes or the colorizer
+    // gets to the lines again
+    struct BlockMatch {
+        Coordinates mAt;
+        uint64_t mVersion = 0;
+        bool mValid = false;
+        bool mFound = false;
+        Coordinates mStart, mEnd;
+        Coordinates mPartnerStart, mPartnerEnd;
+    };
+
+    Blocks ScanBlocks(const Line& aLine, const LineState& aExitState, std::vector<BlockToken>* aTokens = nullptr) const;
+    void ScanBlockTokens(int aLine, std::vector<BlockToken>& aTokens) const;
+    const BlockMatch& FindMatchingBlock();
+
+    // The completion popup, for the identifier that starts at mStart and ends at the cursor
+    struct CompletionState {
+        bool mOpen = false;
+        Coordinates mStart;
+        Coordinates mAt; // the cursor and text version the words were found for; it closes when either changes
+        uint64_t mVersion = 0;
+        int mSelected = 0;
+        std::vector<uint32_t> mItems; // words in mCompletions, best first
+        ImVec2 mMin, mMax; // where Render drew it
+    };
+    static constexpr size_t CompletionItems = 8;
+
+    void HarvestSymbols(Line& aLine);
+    void IndexOutline(int aIndex, Line& aLine);
+    void UpdateCompletion();
+    void AcceptCompletion();
+    int CompletionItemAt(const ImVec2& aPosition) const;
+    void RenderCompletion(ImDrawList* aDrawList, const ImVec2& aTextScreenPos);
     void ColorizeInternal();
+    void ColorizeInBackground();
+    void MergeColorizeJob();
+    void CancelColorizeJob();
+    void ColorizeThread();
     float TextDistanceToLineStart(const Coordinates& aFrom) const;
+    float AdvanceX(const Line& aLine, size_t aIndex, float aX, float aSpaceSize) const;
+    float GetCharacterWidth(const Line& aLine, size_t aIndex) const;
+    Line::ColumnIndex* GetColumnIndex(const Line& aLine) const;
+    Line::ColumnIndex* GetColumnIndexX(const Line& aLine) const;
+    const Line::WrapIndex* GetWrap(int aLine) const;
+    float TextDistanceToRowStart(const Coordinates& aFrom, int& aRow) const;
+    Coordinates RowPosToCoordinates(int aLine, int aRow, float aX) const;
+    void SelectMatch(int aLine, size_t aStart, size_t aEnd);
+    int GetFoldEnd(int aLine) const;
+    void FoldLines(int aLine, int aCount);
+    int GetVisibleLine(int aLine) const;
+    void RevealLine(int aLine);
+    void UnfoldLines(int aStart, int aEnd);
     void EnsureCursorVisible();
     int GetPageSize() const;
     std::string GetText(const Coordinates& aStart, const Coordinates& aEnd) const;
@@ -331,7 +929,16 @@ private:
     void DeleteRange(const Coordinates& aStart, const Coordinates& aEnd);
     int InsertTextAt(Coordinates& aWhere, const char* aValue);
     void AddUndo(UndoRecord& aValue);
+    bool CoalesceUndo(UndoRecord& aInto, const UndoRecord& aValue);
+    void TrimUndoBuffer();
+    static size_t GetUndoRecordBytes(const UndoRecord& aValue);
+    void RecordTextChange(const Coordinates& aStart, const std::string& aRemoved, const std::string& aInserted);
+    void RecordTextChange(int aLine, int aIndex, const std::string& aRemoved, const std::string& aInserted);
+    void EditLinePrefixes(const UndoRecord& aEdit, bool aUndo);
+    void MakeLinePrefixes(const UndoRecord& aEdit);
+    void ResetTextChanges();
     Coordinates ScreenPosToCoordinates(const ImVec2& aPosition) const;
+    bool ToggleFoldAt(const ImVec2& aPosition);
     Coordinates FindWordStart(const Coordinates& aFrom) const;
     Coordinates FindWordEnd(const Coordinates& aFrom) const;
     Coordinates FindNextWord(const Coordinates& aFrom) const;
@@ -342,13 +949,24 @@ private:
     bool IsOnWordBoundary(const Coordinates& aAt) const;
     void RemoveLine(int aStart, int aEnd);
     void RemoveLine(int aIndex);
+    void KeepMarkers(std::vector<Line>& aLines) const;
     Line& InsertLine(int aIndex);
+    void InsertLines(int aIndex, std::vector<Line>&& aLines);
+    void ShiftColorizeRanges(int aIndex, int aDelta);
     void EnterCharacter(ImWchar aChar, bool aShift);
     void Backspace();
+    // Every cursor, the main one at aMain, ordered by position and with an empty selection where they have none
+    std::vector<Cursor> GetCursors(int& aMain) const;
+    void SetCursors(std::vector<Cursor>&& aCursors, int aMain);
+    void MergeCursors();
+    template <typename F> bool MoveCursors(F aMove);
+    void EditCursors(const std::vector<CursorEdit>& aEdits, int aMain, bool aKeepCursors = true);
+    void AddCursorOnRow(int aDelta);
+    Coordinates ScreenPosToColumn(const ImVec2& aPosition) const;
     void DeleteSelection();
     std::string GetWordUnderCursor() const;
     std::string GetWordAt(const Coordinates& aCoords) const;
-    ImU32 GetGlyphColor(const Glyph& aGlyph) const;
+    ImU32 GetStyleColor(const Style& aStyle) const;
 
     void HandleKeyboardInputs();
     void HandleMouseInputs();
@@ -359,6 +977,11 @@ private:
     EditorState mState;
     UndoBuffer mUndoBuffer;
     int mUndoIndex;
+    size_t mUndoBudget;
+    size_t mUndoBytes; // of the records in mUndoBuffer, see GetUndoRecordBytes
+    bool mUndoGroupOpen; // the latest record may still take in the next keystroke
+    std::unique_ptr<EditTrace::Writer> mTrace;
+    bool mTraceBusy; // inside a recorded operation
 
     int mTabSize;
     bool mOverwrite;
@@ -367,29 +990,74 @@ private:
     bool mScrollToCursor;
     bool mScrollToTop;
     bool mTextChanged;
+    bool mTextUtf8;
     bool mColorizerEnabled;
     float mTextStart; // position (in pixels) where a code line starts relative to the left of the TextEditor.
     int mLeftMargin;
     bool mCursorPositionChanged;
-    int mColorRangeMin, mColorRangeMax;
+    int mColorRangeMin, mColorRangeMax; // lines to colorize again, and after them any whose entry state changes
     SelectionMode mSelectionMode;
     bool mHandleKeyboardInputs;
     bool mHandleMouseInputs;
     bool mIgnoreImGuiChild;
     bool mShowWhitespaces;
+    bool mWordWrap;
+    float mWrapWidth; // the text area's width, set by Render while word wrap is on
+    bool mCursorsBusy; // inside MoveCursors
+    bool mColumnMode; // the cursors are a column selection from mInteractiveStart to mInteractiveEnd
 
     Palette mPaletteBase;
     Palette mPalette;
-    LanguageDefinition mLanguageDefinition;
-    RegexList mRegexList;
+    std::shared_ptr<const Language> mLanguage;
+    RegexList mRegexList; // only used when the language's DFA can't take the token regexes
+    TextSearch mSearch;
+    int mFoldCount; // folded lines; while there are none, edits don't look for folds to undo
+    BlockMatch mBlockMatch;
+    std::vector<BlockToken> mBlockTokens; // scratch space for FindMatchingBlock
+    CompletionIndex mCompletions;
+    CompletionState mCompletion;
+    std::vector<uint32_t> mSymbolScratch; // for HarvestSymbols
+    bool mAutoComplete;
+    std::vector<OutlineSymbol> mOutlineScratch; // for IndexOutline
+    std::vector<TokenRun> mOutlineTokens; // likewise
+
+    uint64_t mVersion; // bumped by every edit
+
+    static constexpr size_t MaxTextChanges = 1024;
+    static constexpr size_t MaxTextChangeBytes = 1 << 20;
+    uint64_t mTextVersion;
+    std::deque<TextChange> mTextChanges; // the latest changes, mVersion counting up by one
+    size_t mTextChangeBytes;
+    ColorizeBuffers mColorizeBuffers; // for the synchronous colorizer, the worker has its own
+
+    // A chunk of lines copied out for the background colorizer, which colorizes the copies in place
+    struct ColorizeJob {
+        uint64_t mVersion = 0;
+        std::vector<Line> mLines;
+        LineState mExitState; // state at the start of the line after the chunk
+        bool mDone = true;
+    };
 
-    bool mCheckComments;
-    Breakpoints mBreakpoints;
-    ErrorMarkers mErrorMarkers;
+    bool mBackgroundColorizer;
+    ColorizeJob mColorizeJob;
+    bool mColorizeJobBusy; // handed to the worker and not merged back yet
+    bool mColorizeJobTorn; // lines were inserted or removed inside the chunk meanwhile
+    int mColorizeJobMin, mColorizeJobMax;
+    bool mColorizeQuit;
+    std::mutex mColorizeMutex;
+    std::condition_variable mColorizeCondition;
+    std::thread mColorizeThread;
+    std::vector<std::string> mErrorMessages; // of the error markers, which Line::mError refers to
+    bool mHasMarkers; // a line may have a marker: some were set since the editor was made
     ImVec2 mCharAdvance;
     Coordinates mInteractiveStart, mInteractiveEnd;
-    std::string mLineBuffer;
     uint64_t mStartTime;
 
+    std::vector<LineDraw> mLineDraws; // by line index modulo their count, which covers the screen
+    DrawStyle mDrawStyle;
+    uint64_t mDrawGeneration; // bumped when mDrawStyle changes, which retires every LineDraw
+    uint64_t mLastDrawId;
+    float mMaxLineWidth; // of the lines drawn since the text or the DrawStyle last changed
+
     float mLastClick;
 };
@@ -0,0 +1,6760 @@
+// TextEditor, declared in shared.hpp (MIT, BalazsJako). Kept apart from the plugin so it builds without Windows,
+// D3D or UEVR, e.g. for bench/editor_bench.cpp.
+#include "shared.hpp"
+#include "heap_bytes.hpp"
+#include "text_scan.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <regex>
+#include <string>
+
+using std::max;
+using std::min;
+
+TextEditor::Style TextEditor::Line::GetStyle(size_t aIndex) const {
+    auto it = std::upper_bound(
+        mRuns.begin(), mRuns.end(), aIndex, [](size_t aOffset, const TokenRun& aRun) { return aOffset < aRun.mOffset; });
+    if (it == mRuns.begin())
+        return Style();
+    --it;
+    return aIndex < (size_t)it->mOffset + it->mLength ? it->mStyle : Style();
+}
+
+void TextEditor::Line::InsertText(size_t aIndex, const char* aText, size_t aLength, PaletteIndex aKind) {
+    insert(aIndex, aText, aLength);
+    mColumns.reset();
+    mWrap.reset();
+    mDrawId = 0;
+
+    // Runs after aIndex move along; one that straddles it is split in two around the new text
+    auto it = std::partition_point(
+        mRuns.begin(), mRuns.end(), [aIndex](const TokenRun& aRun) { return (size_t)aRun.mOffset + aRun.mLength <= aIndex; });
+    if (it != mRuns.end() && it->mOffset < aIndex) {
+        TokenRun tail = *it;
+        tail.mOffset = (uint32_t)aIndex;
+        tail.mLength = (uint16_t)(it->mOffset + it->mLength - aIndex);
+        it->mLength = (uint16_t)(aIndex - it->mOffset);
+        it = mRuns.insert(it + 1, tail);
+    }
+    for (auto run = it; run != mRuns.end(); ++run)
+        run->mOffset += (uint32_t)aLength;
+
+    if (aKind != PaletteIndex::Default) {
+        TokenRun run;
+        run.mStyle.mKind = aKind;
+        for (size_t offset = 0; offset < aLength; offset += run.mLength) {
+            run.mOffset = (uint32_t)(aIndex + offset);
+            run.mLength = (uint16_t)min(aLength - offset, (size_t)TokenRun::MaxLength);
+            it = mRuns.insert(it, run) + 1;
+        }
+    }
+}
+
+void TextEditor::Line::EraseText(size_t aStart, size_t aEnd) {
+    erase(aStart, aEnd - aStart);
+    mColumns.reset();
+    mWrap.reset();
+    mDrawId = 0;
+
+    // Clip the erased bytes out of the runs and drop the ones left empty
+    auto clip = [&](size_t aOffset) { return aOffset <= aStart ? aOffset : aOffset >= aEnd ? aOffset - (aEnd - aStart) : aStart; };
+    size_t count = 0;
+    for (auto& run : mRuns) {
+        const size_t start = clip(run.mOffset);
+        const size_t end = clip((size_t)run.mOffset + run.mLength);
+        if (start < end) {
+            run.mOffset = (uint32_t)start;
+            run.mLength = (uint16_t)(end - start);
+            mRuns[count++] = run;
+        }
+    }
+    mRuns.resize(count);
+}
+
+void TextEditor::Line::AppendText(const Line& aFrom, size_t aStart, size_t aEnd) {
+    const size_t base = size();
+    append(aFrom, aStart, aEnd - aStart);
+    mColumns.reset();
+    mWrap.reset();
+    mDrawId = 0;
+
+    for (auto& run : aFrom.mRuns) {
+        const size_t start = max((size_t)run.mOffset, aStart);
+        const size_t end = min((size_t)run.mOffset + run.mLength, aEnd);
+        if (start < end)
+            mRuns.push_back(TokenRun{(uint32_t)(base + start - aStart), (uint16_t)(end - start), run.mStyle});
+    }
+}
+
+TextEditor::Lines::Lines()
+    : mRoot(nullptr)
+    , mSeed(0x9E3779B9u)
+    , mFinger(nullptr)
+    , mFingerIndex(0) {
+}
+
+TextEditor::Lines::Lines(const Lines& aOther)
+    : mRoot(Clone(aOther.mRoot, nullptr))
+    , mSeed(aOther.mSeed)
+    , mFinger(nullptr)
+    , mFingerIndex(0) {
+}
+
+TextEditor::Lines::Lines(Lines&& aOther) noexcept
+    : mRoot(aOther.mRoot)
+    , mSeed(aOther.mSeed)
+    , mFinger(nullptr)
+    , mFingerIndex(0) {
+    aOther.mRoot = nullptr;
+    aOther.mFinger = nullptr;
+}
+
+TextEditor::Lines::~Lines() {
+    Destroy(mRoot);
+}
+
+TextEditor::Lines& TextEditor::Lines::operator=(const Lines& aOther) {
+    if (this != &aOther) {
+        Destroy(mRoot);
+        SetRoot(Clone(aOther.mRoot, nullptr));
+    }
+    return *this;
+}
+
+TextEditor::Lines& TextEditor::Lines::operator=(Lines&& aOther) noexcept {
+    if (this != &aOther) {
+        Destroy(mRoot);
+        SetRoot(aOther.mRoot);
+        aOther.mRoot = nullptr;
+        aOther.mFinger = nullptr;
+    }
+    return *this;
+}
+
+void TextEditor::Lines::Update(Node* aNode) {
+    aNode->mCount = 1 + Count(aNode->mLeft) + Count(aNode->mRight);
+    aNode->mRowCount = aNode->mRows + RowCount(aNode->mLeft) + RowCount(aNode->mRight);
+    aNode->mBlockSum = Blocks::Join(Blocks::Join(BlockSum(aNode->mLeft), aNode->mLine.mBlocks), BlockSum(aNode->mRight));
+    aNode->mOutlineCount = (uint32_t)aNode->mLine.mOutline.size() + OutlineCount(aNode->mLeft) + OutlineCount(aNode->mRight);
+    if (aNode->mLeft != nullptr)
+        aNode->mLeft->mParent = aNode;
+    if (aNode->mRight != nullptr)
+        aNode->mRight->mParent = aNode;
+}
+
+TextEditor::Lines::Node* TextEditor::Lines::First(Node* aNode) {
+    if (aNode != nullptr)
+        while (aNode->mLeft != nullptr)
+            aNode = aNode->mLeft;
+    return aNode;
+}
+
+TextEditor::Lines::Node* TextEditor::Lines::Next(Node* aNode) {
+    if (aNode->mRight != nullptr)
+        return First(aNode->mRight);
+    while (aNode->mParent != nullptr && aNode->mParent->mRight == aNode)
+        aNode = aNode->mParent;
+    return aNode->mParent;
+}
+
+TextEditor::Lines::Node* TextEditor::Lines::Prev(Node* aNode) {
+    if (aNode->mLeft != nullptr) {
+        aNode = aNode->mLeft;
+        while (aNode->mRight != nullptr)
+            aNode = aNode->mRight;
+        return aNode;
+    }
+    while (aNode->mParent != nullptr && aNode->mParent->mLeft == aNode)
+        aNode = aNode->mParent;
+    return aNode->mParent;
+}
+
+// Splits aNode into the first aCount lines and the rest.
+void TextEditor::Lines::Split(Node* aNode, size_t aCount, Node*& aLeft, Node*& aRight) {
+    if (aNode == nullptr) {
+        aLeft = aRight = nullptr;
+        return;
+    }
+
+    if (Count(aNode->mLeft) < aCount) {
+        Split(aNode->mRight, aCount - Count(aNode->mLeft) - 1, aNode->mRight, aRight);
+        aLeft = aNode;
+    } else {
+        Split(aNode->mLeft, aCount, aLeft, aNode->mLeft);
+        aRight = aNode;
+    }
+    Update(aNode);
+}
+
+TextEditor::Lines::Node* TextEditor::Lines::Merge(Node* aLeft, Node* aRight) {
+    if (aLeft == nullptr)
+        return aRight;
+    if (aRight == nullptr)
+        return aLeft;
+
+    if (aLeft->mPriority > aRight->mPriority) {
+        aLeft->mRight = Merge(aLeft->mRight, aRight);
+        Update(aLeft);
+        return aLeft;
+    }
+
+    aRight->mLeft = Merge(aLeft, aRight->mLeft);
+    Update(aRight);
+    return aRight;
+}
+
+TextEditor::Lines::Node* TextEditor::Lines::Clone(const Node* aNode, Node* aParent) {
+    if (aNode == nullptr)
+        return nullptr;
+
+    auto node = new Node{aNode->mLine, nullptr, nullptr, aParent, aNode->mPriority, aNode->mCount, aNode->mRows, aNode->mRowCount,
+        aNode->mBlockSum, aNode->mOutlineCount};
+    node->mLeft = Clone(aNode->mLeft, node);
+    node->mRight = Clone(aNode->mRight, node);
+    return node;
+}
+
+void TextEditor::Lines::Destroy(Node* aNode) {
+    if (aNode == nullptr)
+        return;
+
+    Destroy(aNode->mLeft);
+    Destroy(aNode->mRight);
+    delete aNode;
+}
+
+TextEditor::Lines::Node* TextEditor::Lines::Find(size_t aIndex) const {
+    assert(aIndex < size());
+
+    // Most lookups land on the line that was just accessed or one of its neighbours.
+    if (mFinger != nullptr) {
+        if (aIndex == mFingerIndex)
+            return mFinger;
+        if (aIndex == mFingerIndex + 1) {
+            mFinger = Next(mFinger);
+            mFingerIndex = aIndex;
+            return mFinger;
+        }
+        if (aIndex + 1 == mFingerIndex) {
+            mFinger = Prev(mFinger);
+            mFingerIndex = aIndex;
+            return mFinger;
+        }
+    }
+
+    auto node = mRoot;
+    auto index = aIndex;
+    while (node != nullptr) {
+        auto left = Count(node->mLeft);
+        if (index < left)
+            node = node->mLeft;
+        else if (index == left)
+            break;
+        else {
+            index -= left + 1;
+            node = node->mRight;
+        }
+    }
+
+    mFinger = node;
+    mFingerIndex = aIndex;
+    return node;
+}
+
+void TextEditor::Lines::SetRoot(Node* aRoot) {
+    mRoot = aRoot;
+    if (mRoot != nullptr)
+        mRoot->mParent = nullptr;
+    mFinger = nullptr;
+}
+
+void TextEditor::Lines::clear() {
+    Destroy(mRoot);
+    SetRoot(nullptr);
+}
+
+uint32_t TextEditor::Lines::NextPriority() {
+    // xorshift32; the priorities only need to be well spread to keep the tree balanced
+    mSeed ^= mSeed << 13;
+    mSeed ^= mSeed >> 17;
+    mSeed ^= mSeed << 5;
+    return mSeed;
+}
+
+void TextEditor::Lines::UpdateSubtree(Node* aNode) {
+    if (aNode == nullptr)
+        return;
+
+    UpdateSubtree(aNode->mLeft);
+    UpdateSubtree(aNode->mRight);
+    Update(aNode);
+}
+
+// Builds the treap in order in O(n) instead of inserting line by line: keeps its right spine on a stack, and lets
+// each new line, the last one so far, take the part of the spine with lower priorities as its left subtree.
+TextEditor::Lines::Node* TextEditor::Lines::Build(std::vector<Line>&& aLines) {
+    std::vector<Node*> spine;
+    for (auto& line : aLines) {
+        auto node = new Node{std::move(line), nullptr, nullptr, nullptr, NextPriority(), 1, 1, 1, Blocks(), 0};
+        while (!spine.empty() && spine.back()->mPriority < node->mPriority) {
+            node->mLeft = spine.back();
+            spine.pop_back();
+        }
+        if (!spine.empty())
+            spine.back()->mRight = node;
+        spine.push_back(node);
+    }
+
+    if (spine.empty())
+        return nullptr;
+    UpdateSubtree(spine.front());
+    return spine.front();
+}
+
+void TextEditor::Lines::assign(std::vector<Line>&& aLines) {
+    clear();
+    SetRoot(Build(std::move(aLines)));
+}
+
+TextEditor::Line& TextEditor::Lines::insert(size_t aIndex, Line&& aLine) {
+    assert(aIndex <= size());
+
+    auto node = new Node{std::move(aLine), nullptr, nullptr, nullptr, NextPriority(), 1, 1, 1, Blocks(), 0};
+    node->mBlockSum = node->mLine.mBlocks;
+    node->mOutlineCount = (uint32_t)node->mLine.mOutline.size();
+
+    Node* left;
+    Node* right;
+    Split(mRoot, aIndex, left, right);
+    SetRoot(Merge(Merge(left, node), right));
+    return node->mLine;
+}
+
+void TextEditor::Lines::insert(size_t aIndex, std::vector<Line>&& aLines) {
+    assert(aIndex <= size());
+
+    Node* left;
+    Node* right;
+    Split(mRoot, aIndex, left, right);
+    SetRoot(Merge(Merge(left, Build(std::move(aLines))), right));
+}
+
+void TextEditor::Lines::erase(size_t aStart, size_t aEnd) {
+    assert(aStart <= aEnd && aEnd <= size());
+
+    if (aStart == aEnd)
+        return;
+
+    Node* left;
+    Node* middle;
+    Node* right;
+    Split(mRoot, aStart, left, right);
+    Split(right, aEnd - aStart, middle, right);
+    Destroy(middle);
+    SetRoot(Merge(left, right));
+}
+
+void TextEditor::Lines::SetRows(size_t aIndex, int aRows) const {
+    assert(aRows >= 0);
+    auto node = Find(aIndex);
+    const uint32_t old = node->mRows;
+    node->mRows = (uint32_t)aRows;
+    for (; node != nullptr; node = node->mParent)
+        node->mRowCount = node->mRowCount - old + (uint32_t)aRows;
+}
+
+void TextEditor::Lines::ResetRows() {
+    for (auto node = First(mRoot); node != nullptr; node = Next(node))
+        node->mRows = node->mRows != 0 ? 1 : 0;
+    UpdateSubtree(mRoot);
+}
+
+size_t TextEditor::Lines::GetFirstRow(size_t aIndex) const {
+    auto node = Find(aIndex);
+    size_t row = RowCount(node->mLeft);
+    for (; node->mParent != nullptr; node = node->mParent) {
+        if (node->mParent->mRight == node)
+            row += RowCount(node->mParent->mLeft) + node->mParent->mRows;
+    }
+    return row;
+}
+
+size_t TextEditor::Lines::FindRow(size_t aRow, int& aRowInLine) const {
+    aRowInLine = 0;
+    if (aRow >= rows())
+        return size();
+
+    auto node = mRoot;
+    size_t index = 0;
+    for (;;) {
+        const size_t left = RowCount(node->mLeft);
+        if (aRow < left) {
+            node = node->mLeft;
+        } else if (aRow < left + node->mRows) {
+            aRowInLine = (int)(aRow - left);
+            return index + Count(node->mLeft);
+        } else {
+            aRow -= left + node->mRows;
+            index += Count(node->mLeft) + 1;
+            node = node->mRight;
+        }
+    }
+}
+
+void TextEditor::Lines::UpdateBlocks(size_t aIndex) {
+    for (auto node = Find(aIndex); node != nullptr; node = node->mParent)
+        node->mBlockSum = Blocks::Join(Blocks::Join(BlockSum(node->mLeft), node->mLine.mBlocks), BlockSum(node->mRight));
+}
+
+TextEditor::Blocks TextEditor::Lines::GetBlocksBefore(size_t aIndex) const {
+    if (aIndex >= size())
+        return BlockSum(mRoot);
+
+    // The left subtree of the line, then every ancestor it is right of, each after the ones further up
+    auto node = Find(aIndex);
+    Blocks joined = BlockSum(node->mLeft);
+    for (; node->mParent != nullptr; node = node->mParent) {
+        if (node->mParent->mRight == node)
+            joined = Blocks::Join(Blocks::Join(BlockSum(node->mParent->mLeft), node->mParent->mLine.mBlocks), joined);
+    }
+    return joined;
+}
+
+void TextEditor::Lines::UpdateOutline(size_t aIndex) {
+    for (auto node = Find(aIndex); node != nullptr; node = node->mParent)
+        node->mOutlineCount = (uint32_t)node->mLine.mOutline.size() + OutlineCount(node->mLeft) + OutlineCount(node->mRight);
+}
+
+size_t TextEditor::Lines::FindOutline(size_t aSymbol, int& aInLine) const {
+    aInLine = 0;
+    if (aSymbol >= GetOutlineSize())
+        return size();
+
+    auto node = mRoot;
+    size_t index = 0;
+    for (;;) {
+        const size_t left = OutlineCount(node->mLeft);
+        const size_t own = node->mLine.mOutline.size();
+        if (aSymbol < left) {
+            node = node->mLeft;
+        } else if (aSymbol < left + own) {
+            aInLine = (int)(aSymbol - left);
+            return index + Count(node->mLeft);
+        } else {
+            aSymbol -= left + own;
+            index += Count(node->mLeft) + 1;
+            node = node->mRight;
+        }
+    }
+}
+
+size_t TextEditor::Lines::CountOutlineBefore(size_t aIndex) const {
+    if (aIndex >= size())
+        return GetOutlineSize();
+
+    auto node = Find(aIndex);
+    size_t count = OutlineCount(node->mLeft);
+    for (; node->mParent != nullptr; node = node->mParent) {
+        if (node->mParent->mRight == node)
+            count += OutlineCount(node->mParent->mLeft) + node->mParent->mLine.mOutline.size();
+    }
+    return count;
+}
+
+// Joins the lines after aIndex one by one until they close aDepth blocks, a whole subtree at a time while it doesn't:
+// from the line's right subtree up to the first ancestor the line is left of, and so on, then down into the subtree
+// where the count is reached.
+size_t TextEditor::Lines::FindBlockEnd(size_t aIndex, uint32_t aDepth, Blocks* aBetween) const {
+    if (aDepth == 0 || aIndex + 1 >= size())
+        return size();
+
+    auto node = Find(aIndex);
+    auto subtree = node->mRight;
+    size_t index = aIndex + 1; // of the first line in subtree
+    Blocks joined;
+    for (;;) {
+        const auto withSubtree = Blocks::Join(joined, BlockSum(subtree));
+        if (withSubtree.mCloses >= aDepth)
+            break;
+        joined = withSubtree;
+        index += Count(subtree);
+
+        while (node->mParent != nullptr && node->mParent->mRight == node)
+            node = node->mParent;
+        node = node->mParent;
+        if (node == nullptr)
+            return size();
+
+        const auto before = joined;
+        joined = Blocks::Join(joined, node->mLine.mBlocks);
+        if (joined.mCloses >= aDepth) {
+            if (aBetween != nullptr)
+                *aBetween = before;
+            return index;
+        }
+        ++index;
+        subtree = node->mRight;
+    }
+
+    for (;;) {
+        const auto withLeft = Blocks::Join(joined, BlockSum(subtree->mLeft));
+        if (withLeft.mCloses >= aDepth) {
+            subtree = subtree->mLeft;
+            continue;
+        }
+        joined = Blocks::Join(withLeft, subtree->mLine.mBlocks);
+        index += Count(subtree->mLeft);
+        if (joined.mCloses >= aDepth) {
+            if (aBetween != nullptr)
+                *aBetween = withLeft;
+            return index;
+        }
+        ++index;
+        subtree = subtree->mRight;
+    }
+}
+
+// FindBlockEnd the other way around: the lines before aIndex are joined from the last one back, until they open aDepth
+// blocks that are still open at aIndex.
+size_t TextEditor::Lines::FindBlockStart(size_t aIndex, uint32_t aDepth, Blocks* aBetween) const {
+    if (aDepth == 0 || aIndex == 0 || aIndex >= size())
+        return size();
+
+    auto node = Find(aIndex);
+    auto subtree = node->mLeft;
+    size_t index = aIndex; // one past the last line in subtree
+    Blocks joined;
+    for (;;) {
+        const auto withSubtree = Blocks::Join(BlockSum(subtree), joined);
+        if (withSubtree.mOpens >= aDepth)
+            break;
+        joined = withSubtree;
+        index -= Count(subtree);
+
+        while (node->mParent != nullptr && node->mParent->mLeft == node)
+            node = node->mParent;
+        node = node->mParent;
+        if (node == nullptr)
+            return size();
+
+        const auto before = joined;
+        joined = Blocks::Join(node->mLine.mBlocks, joined);
+        --index;
+        if (joined.mOpens >= aDepth) {
+            if (aBetween != nullptr)
+                *aBetween = before;
+            return index;
+        }
+        subtree = node->mLeft;
+    }
+
+    for (;;) {
+        const auto withRight = Blocks::Join(BlockSum(subtree->mRight), joined);
+        if (withRight.mOpens >= aDepth) {
+            subtree = subtree->mRight;
+            continue;
+        }
+        joined = Blocks::Join(subtree->mLine.mBlocks, withRight);
+        index -= Count(subtree->mRight) + 1;
+        if (joined.mOpens >= aDepth) {
+            if (aBetween != nullptr)
+                *aBetween = withRight;
+            return index;
+        }
+        subtree = subtree->mLeft;
+    }
+}
+
+TextEditor::TextEditor()
+    : mLineSpacing(1.0f)
+    , mUndoIndex(0)
+    , mUndoBudget(DefaultUndoBudget)
+    , mUndoBytes(0)
+    , mUndoGroupOpen(false)
+    , mTraceBusy(false)
+    , mTabSize(4)
+    , mOverwrite(false)
+    , mReadOnly(false)
+    , mWithinRender(false)
+    , mScrollToCursor(false)
+    , mScrollToTop(false)
+    , mTextChanged(false)
+    , mTextUtf8(true)
+    , mColorizerEnabled(true)
+    , mTextStart(20.0f)
+    , mLeftMargin(10)
+    , mCursorPositionChanged(false)
+    , mColorRangeMin(0)
+    , mColorRangeMax(0)
+    , mSelectionMode(SelectionMode::Normal)
+    , mFoldCount(0)
+    , mAutoComplete(true)
+    , mVersion(0)
+    , mTextVersion(0)
+    , mTextChangeBytes(0)
+    , mBackgroundColorizer(false)
+    , mColorizeJobBusy(false)
+    , mColorizeJobTorn(false)
+    , mColorizeJobMin(0)
+    , mColorizeJobMax(0)
+    , mColorizeQuit(false)
+    , mHasMarkers(false)
+    , mLastClick(-1.0f)
+    , mHandleKeyboardInputs(true)
+    , mHandleMouseInputs(true)
+    , mIgnoreImGuiChild(false)
+    , mShowWhitespaces(true)
+    , mWordWrap(false)
+    , mWrapWidth(0.0f)
+    , mCursorsBusy(false)
+    , mColumnMode(false)
+    , mStartTime(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count())
+    , mDrawGeneration(0)
+    , mLastDrawId(0)
+    , mMaxLineWidth(0.0f) {
+    SetPalette(GetDarkPalette());
+    SetLanguageDefinition(LanguageDefinition::Lua());
+    mLines.push_back(Line());
+}
+
+TextEditor::~TextEditor() {
+    if (mColorizeThread.joinable()) {
+        {
+            std::scoped_lock _{mColorizeMutex};
+            mColorizeQuit = true;
+        }
+        mColorizeCondition.notify_all();
+        mColorizeThread.join();
+    }
+}
+
+// The definitions LanguageDefinition::CPlusPlus() and the like return, which live as long as the program unchanged
+static std::unordered_set<const TextEditor::LanguageDefinition*>& GetBuiltinDefinitions() {
+    static std::unordered_set<const TextEditor::LanguageDefinition*> sDefinitions;
+    return sDefinitions;
+}
+
+// The language built from aDefinition, built once for as long as an editor holds on to it. A live one holds on to its
+// definition, so no other definition can turn up at the same address meanwhile.
+std::shared_ptr<const TextEditor::Language> TextEditor::GetLanguage(std::shared_ptr<const LanguageDefinition> aDefinition) {
+    static std::mutex sMutex;
+    static std::map<const LanguageDefinition*, std::weak_ptr<const Language>> sLanguages;
+
+    std::scoped_lock _{sMutex};
+    for (auto it = sLanguages.begin(); it != sLanguages.end();)
+        it = it->second.expired() ? sLanguages.erase(it) : std::next(it);
+    auto& shared = sLanguages[aDefinition.get()];
+    if (auto language = shared.lock())
+        return language;
+
+    std::vector<std::string> builtins;
+    for (auto& keyword : aDefinition->mKeywords) {
+        if (!keyword.empty())
+            builtins.push_back(keyword);
+    }
+    for (auto& identifier : aDefinition->mIdentifiers) {
+        if (!identifier.first.empty())
+            builtins.push_back(identifier.first);
+    }
+    auto language = std::make_shared<Language>(aDefinition, std::move(builtins));
+
+    // One DFA for all the token regexes; std::regex is left for patterns it can't express
+    std::vector<std::string> patterns;
+    for (auto& r : aDefinition->mTokenRegexStrings)
+        patterns.push_back(r.first);
+    if (!patterns.empty() && !language->mRegexDfa.Compile(patterns))
+        language->mRegexDfa.Clear();
+
+    shared = language;
+    return language;
+}
+
+void TextEditor::SetLanguageDefinition(const LanguageDefinition& aLanguageDef) {
+    if (GetBuiltinDefinitions().count(&aLanguageDef) != 0)
+        SetLanguageDefinition(std::shared_ptr<const LanguageDefinition>(std::shared_ptr<const LanguageDefinition>(), &aLanguageDef));
+    else
+        SetLanguageDefinition(std::make_shared<const LanguageDefinition>(aLanguageDef));
+}
+
+void TextEditor::SetLanguageDefinition(std::shared_ptr<const LanguageDefinition> aLanguageDef) {
+    // The background colorizer reads the language
+    CancelColorizeJob();
+
+    mLanguage = GetLanguage(std::move(aLanguageDef));
+    mRegexList.clear();
+    if (mLanguage->mRegexDfa.IsEmpty()) {
+        for (auto& r : mLanguage->mDefinition->mTokenRegexStrings)
+            mRegexList.push_back(std::make_pair(std::regex(r.first, std::regex_constants::optimize), r.second));
+    }
+    mCompletions.SetBuiltins(std::shared_ptr<const CompletionIndex::Builtins>(mLanguage, &mLanguage->mBuiltins));
+
+    Colorize();
+}
+
+void TextEditor::SetPalette(const Palette& aValue) {
+    mPaletteBase = aValue;
+}
+
+std::string TextEditor::GetText(const Coordinates& aStart, const Coordinates& aEnd) const {
+    std::string result;
+
+    auto lstart = aStart.mLine;
+    auto lend = aEnd.mLine;
+    auto istart = GetCharacterIndex(aStart);
+    auto iend = GetCharacterIndex(aEnd);
+    size_t s = 0;
+
+    auto lineIt = mLines.iterator_at(lstart);
+    auto it = lineIt;
+    for (auto i = lstart; i < lend && it != mLines.end(); ++i, ++it)
+        s += it->size() + 1;
+    result.reserve(s + max(iend, 0));
+
+    while (istart < iend || lstart < lend) {
+        if (lineIt == mLines.end())
+            break;
+
+        auto& line = *lineIt;
+        if (istart < (int)line.size()) {
+            // The rest of the line, or up to iend on the last one
+            auto end = lstart < lend ? (int)line.size() : min(iend, (int)line.size());
+            result.append(line, istart, end - istart);
+            istart = end;
+        } else {
+            istart = 0;
+            ++lstart;
+            ++lineIt;
+            result += '\n';
+        }
+    }
+
+    return result;
+}
+
+TextEditor::Coordinates TextEditor::GetActualCursorCoordinates() const {
+    return SanitizeCoordinates(mState.mCursorPosition);
+}
+
+TextEditor::Coordinates TextEditor::SanitizeCoordinates(const Coordinates& aValue) const {
+    auto line = aValue.mLine;
+    auto column = aValue.mColumn;
+    if (line >= (int)mLines.size()) {
+        if (mLines.empty()) {
+            line = 0;
+            column = 0;
+        } else {
+            line = (int)mLines.size() - 1;
+            column = GetLineMaxColumn(line);
+        }
+        return Coordinates(line, column);
+    } else {
+        column = mLines.empty() ? 0 : min(column, GetLineMaxColumn(line));
+        return Coordinates(line, column);
+    }
+}
+
+// https://en.wikipedia.org/wiki/UTF-8
+// We assume that the char is a standalone character (<128) or a leading byte of an UTF-8 code sequence (non-10xxxxxx code)
+// Bytes in the UTF-8 sequence c leads, as far as c tells
+static int UTF8SequenceLength(TextEditor::Char c) {
+    if ((c & 0xFE) == 0xFC)
+        return 6;
+    if ((c & 0xFC) == 0xF8)
+        return 5;
+    if ((c & 0xF8) == 0xF0)
+        return 4;
+    else if ((c & 0xF0) == 0xE0)
+        return 3;
+    else if ((c & 0xE0) == 0xC0)
+        return 2;
+    return 1;
+}
+
+// Bytes in the character at aChar: its UTF-8 sequence, or just the one byte where that isn't well-formed, so text that
+// isn't UTF-8 is kept as it is and gets a column per stray byte
+static int UTF8CharLength(const char* aChar, const char* aEnd) {
+    const int length = UTF8SequenceLength((TextEditor::Char)*aChar);
+    if (length == 1 || length > aEnd - aChar)
+        return 1;
+    return TextScan::ValidUtf8Length(aChar, aChar + length) == (size_t)length ? length : 1;
+}
+
+static int UTF8CharLength(const std::string& aLine, size_t aIndex) {
+    return UTF8CharLength(aLine.data() + aIndex, aLine.data() + aLine.size());
+}
+
+static bool IsUTFSequence(char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+// Where the character before aIndex starts, stepping back the way UTF8CharLength steps forward
+static int UTF8CharStart(const std::string& aLine, int aIndex) {
+    int start = aIndex - 1;
+    while (start > 0 && aIndex - start < 4 && IsUTFSequence(aLine[start]))
+        --start;
+    return start + UTF8CharLength(aLine, start) == aIndex ? start : aIndex - 1;
+}
+
+// "Borrowed" from ImGui source
+static inline int ImTextCharToUtf8(char* buf, int buf_size, unsigned int c) {
+    if (c < 0x80) {
+        buf[0] = (char)c;
+        return 1;
+    }
+    if (c < 0x800) {
+        if (buf_size < 2)
+            return 0;
+        buf[0] = (char)(0xc0 + (c >> 6));
+        buf[1] = (char)(0x80 + (c & 0x3f));
+        return 2;
+    }
+    if (c >= 0xdc00 && c < 0xe000) {
+        return 0;
+    }
+    if (c >= 0xd800 && c < 0xdc00) {
+        if (buf_size < 4)
+            return 0;
+        buf[0] = (char)(0xf0 + (c >> 18));
+        buf[1] = (char)(0x80 + ((c >> 12) & 0x3f));
+        buf[2] = (char)(0x80 + ((c >> 6) & 0x3f));
+        buf[3] = (char)(0x80 + ((c) & 0x3f));
+        return 4;
+    }
+    // else if (c < 0x10000)
+    {
+        if (buf_size < 3)
+            return 0;
+        buf[0] = (char)(0xe0 + (c >> 12));
+        buf[1] = (char)(0x80 + ((c >> 6) & 0x3f));
+        buf[2] = (char)(0x80 + ((c) & 0x3f));
+        return 3;
+    }
+}
+
+void TextEditor::Advance(Coordinates& aCoordinates) const {
+    if (aCoordinates.mLine < (int)mLines.size()) {
+        auto& line = mLines[aCoordinates.mLine];
+        auto cindex = GetCharacterIndex(aCoordinates);
+
+        if (cindex + 1 < (int)line.size()) {
+            auto delta = UTF8CharLength(line, cindex);
+            cindex = min(cindex + delta, (int)line.size() - 1);
+        } else {
+            ++aCoordinates.mLine;
+            cindex = 0;
+        }
+        aCoordinates.mColumn = GetCharacterColumn(aCoordinates.mLine, cindex);
+    }
+}
+
+void TextEditor::DeleteRange(const Coordinates& aStart, const Coordinates& aEnd) {
+    assert(aEnd >= aStart);
+    assert(!mReadOnly);
+
+    // printf("D(%d.%d)-(%d.%d)\n", aStart.mLine, aStart.mColumn, aEnd.mLine, aEnd.mColumn);
+
+    if (aEnd == aStart)
+        return;
+
+    auto start = GetCharacterIndex(aStart);
+    auto end = GetCharacterIndex(aEnd);
+
+    if (aStart.mLine == aEnd.mLine) {
+        auto& line = mLines[aStart.mLine];
+        auto n = GetLineMaxColumn(aStart.mLine);
+        if (aEnd.mColumn >= n)
+            line.EraseText(start, line.size());
+        else
+            line.EraseText(start, end);
+    } else {
+        auto& firstLine = mLines[aStart.mLine];
+        auto& lastLine = mLines[aEnd.mLine];
+
+        firstLine.EraseText(start, firstLine.size());
+        lastLine.EraseText(0, end);
+
+        if (aStart.mLine < aEnd.mLine)
+            firstLine.AppendText(lastLine, 0, lastLine.size());
+
+        // The last line's error marker goes with what is left of it, unless the first line has one
+        if (firstLine.mError == 0)
+            firstLine.mError = lastLine.mError;
+
+        if (aStart.mLine < aEnd.mLine)
+            RemoveLine(aStart.mLine + 1, aEnd.mLine + 1);
+    }
+
+    mTextChanged = true;
+}
+
+// Splits aValue into lines up front: what comes before its first newline goes into aWhere's line, the lines after that
+// into the document in one splice, the last of them followed by the rest of aWhere's line. '\r's are left out.
+int TextEditor::InsertTextAt(Coordinates& /* inout */ aWhere, const char* aValue) {
+    assert(!mReadOnly);
+    assert(!mLines.empty());
+
+    auto appendLine = [](std::string& aTo, const char* aBegin, const char* aEnd) {
+        for (const char* cr; (cr = (const char*)memchr(aBegin, '\r', aEnd - aBegin)) != nullptr; aBegin = cr + 1)
+            aTo.append(aBegin, cr);
+        aTo.append(aBegin, aEnd);
+    };
+
+    const char* end = aValue + strlen(aValue);
+    const char* lineEnd = (const char*)memchr(aValue, '\n', end - aValue);
+    std::string first;
+    appendLine(first, aValue, lineEnd != nullptr ? lineEnd : end);
+
+    auto& line = mLines[aWhere.mLine];
+    int cindex = GetCharacterIndex(aWhere);
+    if (lineEnd == nullptr) {
+        if (!first.empty()) {
+            line.InsertText(cindex, first.data(), first.size());
+            cindex += (int)first.size();
+            mTextChanged = true;
+        }
+        // Not one column per character, tabs can be wider
+        aWhere.mColumn = GetCharacterColumn(aWhere.mLine, cindex);
+        return 0;
+    }
+
+    std::vector<Line> lines;
+    for (const char* start = lineEnd + 1;; start = lineEnd + 1) {
+        lineEnd = (const char*)memchr(start, '\n', end - start);
+        lines.emplace_back();
+        appendLine(lines.back(), start, lineEnd != nullptr ? lineEnd : end);
+        if (lineEnd == nullptr)
+            break;
+    }
+
+    const int lastIndex = (int)lines.back().size();
+    lines.back().AppendText(line, cindex, line.size());
+    line.EraseText(cindex, line.size());
+    if (!first.empty())
+        line.InsertText(cindex, first.data(), first.size());
+
+    const int totalLines = (int)lines.size();
+    InsertLines(aWhere.mLine + 1, std::move(lines));
+    aWhere.mLine += totalLines;
+    aWhere.mColumn = GetCharacterColumn(aWhere.mLine, lastIndex);
+    mTextChanged = true;
+
+    return totalLines;
+}
+
+void TextEditor::AddUndo(UndoRecord& aValue) {
+    assert(!mReadOnly);
+    // printf("AddUndo: (@%d.%d) +\'%s' [%d.%d .. %d.%d], -\'%s', [%d.%d .. %d.%d] (@%d.%d)\n",
+    //	aValue.mBefore.mCursorPosition.mLine, aValue.mBefore.mCursorPosition.mColumn,
+    //	aValue.mAdded.c_str(), aValue.mAddedStart.mLine, aValue.mAddedStart.mColumn, aValue.mAddedEnd.mLine, aValue.mAddedEnd.mColumn,
+    //	aValue.mRemoved.c_str(), aValue.mRemovedStart.mLine, aValue.mRemovedStart.mColumn, aValue.mRemovedEnd.mLine,
+    //aValue.mRemovedEnd.mColumn, 	aValue.mAfter.mCursorPosition.mLine, aValue.mAfter.mCursorPosition.mColumn
+    //	);
+
+    // A new edit ends what could be redone
+    const bool redoDropped = mUndoIndex < (int)mUndoBuffer.size();
+    while (mUndoIndex < (int)mUndoBuffer.size()) {
+        mUndoBytes -= GetUndoRecordBytes(mUndoBuffer.back());
+        mUndoBuffer.pop_back();
+    }
+
+    if (mUndoGroupOpen && !redoDropped && !mUndoBuffer.empty() && CoalesceUndo(mUndoBuffer.back(), aValue)) {
+        // The journal below still gets the keystroke on its own
+    } else {
+        mUndoBuffer.push_back(aValue);
+        mUndoBytes += GetUndoRecordBytes(aValue);
+        ++mUndoIndex;
+    }
+    TrimUndoBuffer();
+    mUndoGroupOpen = aValue.mGroup != UndoRecord::Group::None;
+    mColumnMode = false; // the text moved under the corners
+
+    // The edit is done by now, journal it the way Redo would replay it
+    auto journal = [this](const UndoRecord& aEdit) {
+        if (!aEdit.mRemoved.empty() && !aEdit.mAdded.empty() && aEdit.mRemovedStart == aEdit.mAddedStart) {
+            RecordTextChange(aEdit.mRemovedStart, aEdit.mRemoved, aEdit.mAdded);
+        } else {
+            if (!aEdit.mRemoved.empty())
+                RecordTextChange(aEdit.mRemovedStart, aEdit.mRemoved, std::string());
+            if (!aEdit.mAdded.empty())
+                RecordTextChange(aEdit.mAddedStart, std::string(), aEdit.mAdded);
+        }
+    };
+    // Line prefix edits are journalled a line at a time as they are made
+    if (aValue.mBatch.empty() && aValue.mPrefixes.empty())
+        journal(aValue);
+    for (auto& edit : aValue.mBatch)
+        journal(edit);
+}
+
+bool TextEditor::CoalesceUndo(UndoRecord& aInto, const UndoRecord& aValue) {
+    if (aValue.mGroup == UndoRecord::Group::None || aValue.mGroup != aInto.mGroup || aValue.mBefore.mCursorPosition != aInto.mAfter.mCursorPosition)
+        return false;
+
+    const size_t bytes = GetUndoRecordBytes(aInto);
+    switch (aValue.mGroup) {
+    case UndoRecord::Group::Typing: {
+        // One record per word, with the blanks that lead into it
+        auto isBlank = [](char aChar) { return aChar == ' ' || aChar == '\t'; };
+        if (aValue.mAddedStart != aInto.mAddedEnd || (isBlank(aValue.mAdded.front()) && !isBlank(aInto.mAdded.back())))
+            return false;
+        aInto.mAdded += aValue.mAdded;
+        aInto.mAddedEnd = aValue.mAddedEnd;
+        break;
+    }
+    case UndoRecord::Group::Backspace:
+        if (aValue.mRemovedEnd != aInto.mRemovedStart)
+            return false;
+        aInto.mRemoved.insert(0, aValue.mRemoved);
+        aInto.mRemovedStart = aValue.mRemovedStart;
+        break;
+    case UndoRecord::Group::Delete: {
+        if (aValue.mRemovedStart != aInto.mRemovedStart)
+            return false;
+        // aValue.mRemovedEnd is where the character ended once the earlier ones were gone, Redo needs where it ended
+        // before them, which is one character past aInto.mRemovedEnd
+        auto& end = aInto.mRemovedEnd;
+        if (aValue.mRemoved.front() == '\t')
+            end.mColumn = (end.mColumn / mTabSize) * mTabSize + mTabSize;
+        else
+            ++end.mColumn;
+        aInto.mRemoved += aValue.mRemoved;
+        break;
+    }
+    default:
+        return false;
+    }
+    aInto.mAfter = aValue.mAfter;
+
+    mUndoBytes = mUndoBytes - bytes + GetUndoRecordBytes(aInto);
+    return true;
+}
+
+void TextEditor::TrimUndoBuffer() {
+    while (mUndoBytes > mUndoBudget && mUndoIndex > 1) {
+        mUndoBytes -= GetUndoRecordBytes(mUndoBuffer.front());
+        mUndoBuffer.pop_front();
+        --mUndoIndex;
+    }
+}
+
+size_t TextEditor::GetUndoRecordBytes(const UndoRecord& aValue) {
+    size_t bytes = sizeof(UndoRecord) + aValue.mAdded.size() + aValue.mRemoved.size() +
+                   (aValue.mBefore.mCursors.size() + aValue.mAfter.mCursors.size()) * sizeof(Cursor) +
+                   aValue.mPrefixes.size() * sizeof(LinePrefix) + aValue.mPrefixText.size();
+    for (auto& edit : aValue.mBatch)
+        bytes += GetUndoRecordBytes(edit);
+    return bytes;
+}
+
+void TextEditor::SetUndoBudget(size_t aBytes) {
+    mUndoBudget = aBytes;
+    TrimUndoBuffer();
+}
+
+void TextEditor::StartTrace() {
+    mTrace.reset(new EditTrace::Writer());
+    mTraceBusy = false;
+
+    // Up to the end of the last line: GetText() adds a newline after it
+    const int last = (int)mLines.size() - 1;
+    auto text = GetText(Coordinates(), Coordinates(last, GetLineMaxColumn(last)));
+    auto& s = mState;
+    mTrace->Write(EditTrace::Op::Start,
+        {mTabSize, mOverwrite, s.mCursorPosition.mLine, s.mCursorPosition.mColumn, s.mSelectionStart.mLine,
+            s.mSelectionStart.mColumn, s.mSelectionEnd.mLine, s.mSelectionEnd.mColumn, mInteractiveStart.mLine,
+            mInteractiveStart.mColumn, mInteractiveEnd.mLine, mInteractiveEnd.mColumn},
+        text.data(), text.size());
+    for (auto& cursor : s.mCursors) {
+        mTrace->Write(EditTrace::Op::AddCursor, {cursor.mSelectionStart.mLine, cursor.mSelectionStart.mColumn, cursor.mSelectionEnd.mLine,
+            cursor.mSelectionEnd.mColumn, cursor.mCursorPosition.mLine, cursor.mCursorPosition.mColumn});
+    }
+
+    // The folds so far, outer ones before those hidden under them
+    if (mFoldCount > 0) {
+        int index = 0;
+        for (auto& line : mLines) {
+            if (line.mFolded != 0)
+                mTrace->Write(EditTrace::Op::Fold, {index, (int)line.mFolded});
+            ++index;
+        }
+    }
+}
+
+std::vector<uint8_t> TextEditor::StopTrace() {
+    if (mTrace == nullptr)
+        return {};
+    auto bytes = mTrace->TakeBytes();
+    mTrace.reset();
+    return bytes;
+}
+
+void TextEditor::ReplayTraceEvent(const EditTrace::Event& aEvent) {
+    auto a = aEvent.mArgs;
+    // Into the text as it is when the position is used, so a trace replayed on text that has drifted from the recording
+    // can't put a cursor or a selection outside it
+    auto at = [this, a](int aIndex) { return SanitizeCoordinates(Coordinates(max(0, a[aIndex]), max(0, a[aIndex + 1]))); };
+
+    switch (aEvent.mOp) {
+    case EditTrace::Op::Start:
+        SetText(aEvent.mText);
+        SetTabSize(a[0]);
+        mOverwrite = a[1] != 0;
+        mState.mCursorPosition = at(2);
+        mState.mSelectionStart = at(4);
+        mState.mSelectionEnd = at(6);
+        mInteractiveStart = at(8);
+        mInteractiveEnd = at(10);
+        mState.mCursors.clear();
+        mColumnMode = false;
+        break;
+    case EditTrace::Op::SetText:
+        SetText(aEvent.mText);
+        break;
+    case EditTrace::Op::EnterCharacter:
+        EnterCharacter((ImWchar)a[0], a[1] != 0);
+        break;
+    case EditTrace::Op::Backspace:
+        Backspace();
+        break;
+    case EditTrace::Op::Delete:
+        Delete();
+        break;
+    case EditTrace::Op::Copy:
+        Copy();
+        break;
+    case EditTrace::Op::Cut:
+        Cut();
+        break;
+    case EditTrace::Op::Paste:
+        ImGui::SetClipboardText(aEvent.mText.c_str());
+        Paste();
+        break;
+    case EditTrace::Op::InsertText:
+        InsertText(aEvent.mText);
+        break;
+    case EditTrace::Op::MoveUp:
+        MoveUp(a[0], a[1] != 0);
+        break;
+    case EditTrace::Op::MoveDown:
+        MoveDown(a[0], a[1] != 0);
+        break;
+    case EditTrace::Op::MoveLeft:
+        MoveLeft(a[0], a[1] != 0, a[2] != 0);
+        break;
+    case EditTrace::Op::MoveRight:
+        MoveRight(a[0], a[1] != 0, a[2] != 0);
+        break;
+    case EditTrace::Op::MoveTop:
+        MoveTop(a[0] != 0);
+        break;
+    case EditTrace::Op::MoveBottom:
+        MoveBottom(a[0] != 0);
+        break;
+    case EditTrace::Op::MoveHome:
+        MoveHome(a[0] != 0);
+        break;
+    case EditTrace::Op::MoveEnd:
+        MoveEnd(a[0] != 0);
+        break;
+    case EditTrace::Op::SetSelection:
+        // The interactive range is state SetSelection reads besides its arguments
+        mState.mCursorPosition = at(5);
+        mInteractiveStart = at(7);
+        mInteractiveEnd = at(9);
+        SetSelection(at(0), at(2), (SelectionMode)a[4]);
+        break;
+    case EditTrace::Op::SetCursorPosition:
+        SetCursorPosition(at(0));
+        break;
+    case EditTrace::Op::SelectWordUnderCursor:
+        SelectWordUnderCursor();
+        break;
+    case EditTrace::Op::SelectAll:
+        SelectAll();
+        break;
+    case EditTrace::Op::Undo:
+        Undo(a[0]);
+        break;
+    case EditTrace::Op::Redo:
+        Redo(a[0]);
+        break;
+    case EditTrace::Op::ToggleComment:
+        ToggleComment(a[0] != 0);
+        break;
+    case EditTrace::Op::ToggleOverwrite:
+        mOverwrite ^= true;
+        break;
+    case EditTrace::Op::SetFindPattern: {
+        TextSearch::Options options;
+        options.mCaseSensitive = a[0] != 0;
+        options.mWholeWord = a[1] != 0;
+        options.mRegex = a[2] != 0;
+        SetFindPattern(aEvent.mText, options);
+        break;
+    }
+    case EditTrace::Op::FindNext:
+        FindNext();
+        break;
+    case EditTrace::Op::FindPrevious:
+        FindPrevious();
+        break;
+    case EditTrace::Op::ReplaceAll:
+        ReplaceAll(aEvent.mText);
+        break;
+    case EditTrace::Op::Fold:
+        if (a[0] >= 0 && a[1] > 0 && a[0] + a[1] < (int)mLines.size() && !IsFolded(a[0]))
+            FoldLines(a[0], a[1]);
+        break;
+    case EditTrace::Op::Unfold:
+        Unfold(a[0]);
+        break;
+    case EditTrace::Op::Complete:
+        Complete(aEvent.mText);
+        break;
+    case EditTrace::Op::AddCursor:
+        mState.mCursors.push_back(Cursor{min(at(0), at(2)), max(at(0), at(2)), at(4)});
+        MergeCursors();
+        break;
+    case EditTrace::Op::RemoveCursor:
+        RemoveCursor(at(0));
+        break;
+    case EditTrace::Op::AddCursorAtNextMatch:
+        AddCursorAtNextMatch();
+        break;
+    case EditTrace::Op::SetColumnSelection:
+        SetColumnSelection(at(0), at(2));
+        break;
+    case EditTrace::Op::ClearCursors:
+        ClearCursors();
+        break;
+    default:
+        break;
+    }
+}
+
+void TextEditor::RecordTextChange(const Coordinates& aStart, const std::string& aRemoved, const std::string& aInserted) {
+    RecordTextChange(aStart.mLine, GetCharacterIndex(aStart), aRemoved, aInserted);
+}
+
+void TextEditor::RecordTextChange(int aLine, int aIndex, const std::string& aRemoved, const std::string& aInserted) {
+    TextChange change;
+    change.mStartLine = change.mEndLine = aLine;
+    change.mStartIndex = change.mEndIndex = aIndex;
+    for (auto c : aRemoved) {
+        if (c == '\n') {
+            ++change.mEndLine;
+            change.mEndIndex = 0;
+        } else if (c != '\r') {
+            ++change.mEndIndex;
+        }
+    }
+    // InsertTextAt drops carriage returns
+    change.mText.reserve(aInserted.size());
+    for (auto c : aInserted) {
+        if (c != '\r')
+            change.mText += c;
+    }
+    change.mVersion = ++mTextVersion;
+
+    mTextChangeBytes += change.mText.size();
+    mTextChanges.push_back(std::move(change));
+    while (!mTextChanges.empty() && (mTextChanges.size() > MaxTextChanges || mTextChangeBytes > MaxTextChangeBytes)) {
+        mTextChangeBytes -= mTextChanges.front().mText.size();
+        mTextChanges.pop_front();
+    }
+}
+
+void TextEditor::ResetTextChanges() {
+    mTextChanges.clear();
+    mTextChangeBytes = 0;
+    ++mTextVersion;
+}
+
+bool TextEditor::GetTextChanges(uint64_t aVersion, std::vector<TextChange>& aChanges) const {
+    const uint64_t oldest = mTextVersion - mTextChanges.size();
+    if (aVersion < oldest || aVersion > mTextVersion)
+        return false;
+    aChanges.insert(aChanges.end(), mTextChanges.begin() + (size_t)(aVersion - oldest), mTextChanges.end());
+    return true;
+}
+
+size_t TextEditor::Language::GetMemoryUsage() const {
+    auto& definition = *mDefinition;
+    size_t bytes = sizeof(definition) + mRegexDfa.GetMemoryUsage() + mBuiltins.GetMemoryUsage();
+    for (auto* keywords : {&definition.mKeywords, &definition.mBlockStarts, &definition.mBlockEnds}) {
+        bytes += HeapBytes::Hash(*keywords);
+        for (auto& keyword : *keywords)
+            bytes += HeapBytes::String(keyword);
+    }
+    for (auto* identifiers : {&definition.mIdentifiers, &definition.mPreprocIdentifiers}) {
+        bytes += HeapBytes::Hash(*identifiers);
+        for (auto& identifier : *identifiers)
+            bytes += HeapBytes::String(identifier.first) + HeapBytes::String(identifier.second.mDeclaration);
+    }
+    bytes += definition.mTokenRegexStrings.capacity() * sizeof(LanguageDefinition::TokenRegexString);
+    for (auto& r : definition.mTokenRegexStrings)
+        bytes += HeapBytes::String(r.first);
+    return bytes;
+}
+
+TextEditor::MemoryUsage TextEditor::GetMemoryUsage() const {
+    MemoryUsage usage;
+    usage.mText = mLines.GetNodeBytes();
+    for (auto& line : mLines) {
+        usage.mText += HeapBytes::String(line);
+        usage.mColors += line.mRuns.capacity() * sizeof(TokenRun) + line.mSymbols.capacity() * sizeof(uint32_t) +
+                         line.mOutline.capacity() * sizeof(OutlineSymbol);
+        if (line.mColumns != nullptr)
+            usage.mCaches += sizeof(Line::ColumnIndex) + line.mColumns->mStops.capacity() * sizeof(Line::ColumnStop);
+        if (line.mWrap != nullptr)
+            usage.mCaches += sizeof(Line::WrapIndex) + line.mWrap->mRowStarts.capacity() * sizeof(uint32_t) +
+                             line.mWrap->mRowWidths.capacity() * sizeof(float);
+    }
+    usage.mColors += mCompletions.GetMemoryUsage();
+    for (auto& draw : mLineDraws)
+        usage.mCaches += sizeof(LineDraw) + draw.mVertices.capacity() * sizeof(ImDrawVert) +
+                         draw.mIndices.capacity() * sizeof(ImDrawIdx);
+    // The worker's copy of a chunk, unless the worker has it right now
+    if (!mColorizeJobBusy) {
+        for (auto& line : mColorizeJob.mLines)
+            usage.mCaches += sizeof(Line) + HeapBytes::String(line) + line.mRuns.capacity() * sizeof(TokenRun);
+    }
+    usage.mUndo = mUndoBytes + mTextChangeBytes;
+    usage.mShared = mLanguage->GetMemoryUsage();
+    return usage;
+}
+
+void TextEditor::Compact() {
+    // Rows stay counted as they were wrapped until the line is wrapped again, so dropping mWrap is safe
+    for (auto& line : mLines) {
+        line.mColumns.reset();
+        line.mWrap.reset();
+    }
+    std::vector<LineDraw>().swap(mLineDraws);
+    if (!mColorizeJobBusy)
+        std::vector<Line>().swap(mColorizeJob.mLines);
+}
+
+TextEditor::Coordinates TextEditor::ScreenPosToCoordinates(const ImVec2& aPosition) const {
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImVec2 local(aPosition.x - origin.x, aPosition.y - origin.y);
+
+    int rowInLine;
+    const int lineNo = (int)mLines.FindRow((size_t)max(0, (int)floor(local.y / mCharAdvance.y)), rowInLine);
+    return RowPosToCoordinates(lineNo, rowInLine, local.x - mTextStart);
+}
+
+// Folds or unfolds the line whose fold marker is at aPosition, if there is one
+bool TextEditor::ToggleFoldAt(const ImVec2& aPosition) {
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImVec2 local(aPosition.x - origin.x, aPosition.y - origin.y);
+    if (local.x < mTextStart - mCharAdvance.x * 2.0f || local.x >= mTextStart || local.y < 0.0f)
+        return false;
+
+    int rowInLine;
+    const int lineNo = (int)mLines.FindRow((size_t)(local.y / mCharAdvance.y), rowInLine);
+    if (lineNo >= (int)mLines.size() || rowInLine != 0)
+        return false;
+    if (IsFolded(lineNo)) {
+        Unfold(lineNo);
+        return true;
+    }
+    return Fold(lineNo);
+}
+
+// Position of the character on row aRow of aLine whose middle is right of aX, which is relative to the row's start.
+// Past the end of a row that wraps, that is the row's last character: its end is where the next row starts.
+TextEditor::Coordinates TextEditor::RowPosToCoordinates(int aLine, int aRow, float aX) const {
+    if (aLine >= (int)mLines.size())
+        return SanitizeCoordinates(Coordinates(aLine, 0));
+
+    auto& line = mLines[aLine];
+    size_t columnIndex = 0;
+    size_t rowEnd = line.size();
+    bool lastRow = true;
+    float columnX = 0.0f;
+    int columnCoord = 0;
+    float spaceSize = ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), FLT_MAX, -1.0f, " ").x;
+
+    if (auto wrap = GetWrap(aLine)) {
+        aRow = max(0, min(aRow, wrap->GetRows() - 1));
+        if (aRow > 0) {
+            columnIndex = wrap->mRowStarts[aRow - 1];
+            columnCoord = GetCharacterColumn(aLine, (int)columnIndex);
+        }
+        lastRow = aRow + 1 == wrap->GetRows();
+        if (!lastRow)
+            rowEnd = wrap->mRowStarts[aRow];
+    } else if (auto index = GetColumnIndexX(line)) {
+        // Every character before the last stop left of the position is left of it too, start there
+        auto stop = std::upper_bound(
+            index->mStops.begin(), index->mStops.end(), aX, [](float aX, const Line::ColumnStop& aStop) { return aX < aStop.mX; });
+        if (stop != index->mStops.begin()) {
+            --stop;
+            columnIndex = stop->mIndex;
+            columnX = stop->mX;
+            columnCoord = stop->mColumn;
+        }
+    }
+
+    while (columnIndex < rowEnd) {
+        float columnWidth, newColumnX;
+        if (line[columnIndex] == '\t') {
+            newColumnX = AdvanceX(line, columnIndex, columnX, spaceSize);
+            columnWidth = newColumnX - columnX;
+        } else {
+            columnWidth = GetCharacterWidth(line, columnIndex);
+            newColumnX = columnX + columnWidth;
+        }
+        if (columnX + columnWidth * 0.5f > aX)
+            break;
+        const size_t next = columnIndex + UTF8CharLength(line, columnIndex);
+        if (!lastRow && next >= rowEnd)
+            break;
+        columnX = newColumnX;
+        if (line[columnIndex] == '\t')
+            columnCoord = (columnCoord / mTabSize) * mTabSize + mTabSize;
+        else
+            columnCoord++;
+        columnIndex = next;
+    }
+
+    return SanitizeCoordinates(Coordinates(aLine, columnCoord));
+}
+
+TextEditor::Coordinates TextEditor::FindWordStart(const Coordinates& aFrom) const {
+    Coordinates at = aFrom;
+    if (at.mLine >= (int)mLines.size())
+        return at;
+
+    auto& line = mLines[at.mLine];
+    auto cindex = GetCharacterIndex(at);
+
+    if (cindex >= (int)line.size())
+        return at;
+
+    while (cindex > 0 && isspace((Char)line[cindex]))
+        --cindex;
+
+    auto cstart = line.GetStyle(cindex).mKind;
+    while (cindex > 0) {
+        auto c = (Char)line[cindex];
+        if ((c & 0xC0) != 0x80) // not UTF code sequence 10xxxxxx
+        {
+            if (c <= 32 && isspace(c)) {
+                cindex++;
+                break;
+            }
+            if (cstart != line.GetStyle(cindex - 1).mKind)
+                break;
+        }
+        --cindex;
+    }
+    return Coordinates(at.mLine, GetCharacterColumn(at.mLine, cindex));
+}
+
+TextEditor::Coordinates TextEditor::FindWordEnd(const Coordinates& aFrom) const {
+    Coordinates at = aFrom;
+    if (at.mLine >= (int)mLines.size())
+        return at;
+
+    auto& line = mLines[at.mLine];
+    auto cindex = GetCharacterIndex(at);
+
+    if (cindex >= (int)line.size())
+        return at;
+
+    bool prevspace = (bool)isspace((Char)line[cindex]);
+    auto cstart = line.GetStyle(cindex).mKind;
+    while (cindex < (int)line.size()) {
+        auto c = (Char)line[cindex];
+        auto d = UTF8CharLength(line, cindex);
+        if (cstart != line.GetStyle(cindex).mKind)
+            break;
+
+        if (prevspace != !!isspace(c)) {
+            if (isspace(c))
+                while (cindex < (int)line.size() && isspace((Char)line[cindex]))
+                    ++cindex;
+            break;
+        }
+        cindex += d;
+    }
+    return Coordinates(aFrom.mLine, GetCharacterColumn(aFrom.mLine, cindex));
+}
+
+TextEditor::Coordinates TextEditor::FindNextWord(const Coordinates& aFrom) const {
+    Coordinates at = aFrom;
+    if (at.mLine >= (int)mLines.size())
+        return at;
+
+    // skip to the next non-word character
+    auto cindex = GetCharacterIndex(aFrom);
+    bool isword = false;
+    bool skip = false;
+    if (cindex < (int)mLines[at.mLine].size()) {
+        auto& line = mLines[at.mLine];
+        isword = isalnum((Char)line[cindex]);
+        skip = isword;
+    }
+
+    while (!isword || skip) {
+        if (at.mLine >= mLines.size()) {
+            auto l = max(0, (int)mLines.size() - 1);
+            return Coordinates(l, GetLineMaxColumn(l));
+        }
+
+        auto& line = mLines[at.mLine];
+        if (cindex < (int)line.size()) {
+            isword = isalnum((Char)line[cindex]);
+
+            if (isword && !skip)
+                return Coordinates(at.mLine, GetCharacterColumn(at.mLine, cindex));
+
+            if (!isword)
+                skip = false;
+
+            cindex++;
+        } else {
+            cindex = 0;
+            ++at.mLine;
+            skip = false;
+            isword = false;
+        }
+    }
+
+    return at;
+}
+
+int TextEditor::GetCharacterIndex(const Coordinates& aCoordinates) const {
+    if (aCoordinates.mLine >= mLines.size())
+        return -1;
+    auto& line = mLines[aCoordinates.mLine];
+    int c = 0;
+    int i = 0;
+    if (auto index = GetColumnIndex(line)) {
+        auto stop = std::upper_bound(index->mStops.begin(), index->mStops.end(), aCoordinates.mColumn,
+            [](int aColumn, const Line::ColumnStop& aStop) { return aColumn < aStop.mColumn; });
+        if (stop != index->mStops.begin()) {
+            --stop;
+            c = stop->mColumn;
+            i = (int)stop->mIndex;
+        }
+    }
+    for (; i < line.size() && c < aCoordinates.mColumn;) {
+        if (line[i] == '\t')
+            c = (c / mTabSize) * mTabSize + mTabSize;
+        else
+            ++c;
+        i += UTF8CharLength(line, i);
+    }
+    return i;
+}
+
+int TextEditor::GetCharacterColumn(int aLine, int aIndex) const {
+    if (aLine >= mLines.size())
+        return 0;
+    auto& line = mLines[aLine];
+    int col = 0;
+    int i = 0;
+    if (auto index = GetColumnIndex(line)) {
+        auto stop = std::upper_bound(index->mStops.begin(), index->mStops.end(), aIndex,
+            [](int aOffset, const Line::ColumnStop& aStop) { return aOffset < (int)aStop.mIndex; });
+        if (stop != index->mStops.begin()) {
+            --stop;
+            col = stop->mColumn;
+            i = (int)stop->mIndex;
+        }
+    }
+    while (i < aIndex && i < (int)line.size()) {
+        auto c = (Char)line[i];
+        i += UTF8CharLength(line, i);
+        if (c == '\t')
+            col = (col / mTabSize) * mTabSize + mTabSize;
+        else
+            col++;
+    }
+    return col;
+}
+
+int TextEditor::GetLineCharacterCount(int aLine) const {
+    if (aLine >= mLines.size())
+        return 0;
+    auto& line = mLines[aLine];
+    if (auto index = GetColumnIndex(line))
+        return index->mCharacterCount;
+    int c = 0;
+    for (unsigned i = 0; i < line.size(); c++)
+        i += UTF8CharLength(line, i);
+    return c;
+}
+
+int TextEditor::GetLineMaxColumn(int aLine) const {
+    if (aLine >= mLines.size())
+        return 0;
+    auto& line = mLines[aLine];
+    if (auto index = GetColumnIndex(line))
+        return index->mMaxColumn;
+    int col = 0;
+    for (unsigned i = 0; i < line.size();) {
+        auto c = (Char)line[i];
+        if (c == '\t')
+            col = (col / mTabSize) * mTabSize + mTabSize;
+        else
+            col++;
+        i += UTF8CharLength(line, i);
+    }
+    return col;
+}
+
+TextEditor::Line::ColumnIndex* TextEditor::GetColumnIndex(const Line& aLine) const {
+    if (aLine.size() < Line::ColumnIndex::MinLineLength)
+        return nullptr;
+    if (aLine.mColumns && aLine.mColumns->mTabSize == mTabSize)
+        return aLine.mColumns.get();
+
+    auto index = std::make_shared<Line::ColumnIndex>();
+    index->mTabSize = mTabSize;
+    int col = 0;
+    int count = 0;
+    for (size_t i = 0; i < aLine.size(); ++count) {
+        if (count % Line::ColumnIndex::Stride == 0)
+            index->mStops.push_back(Line::ColumnStop{(uint32_t)i, col, 0.0f});
+        auto c = (Char)aLine[i];
+        if (c == '\t')
+            col = (col / mTabSize) * mTabSize + mTabSize;
+        else
+            col++;
+        i += UTF8CharLength(aLine, i);
+    }
+    index->mStops.shrink_to_fit();
+    index->mCharacterCount = count;
+    index->mMaxColumn = col;
+    aLine.mColumns = std::move(index);
+    return aLine.mColumns.get();
+}
+
+TextEditor::Line::ColumnIndex* TextEditor::GetColumnIndexX(const Line& aLine) const {
+    auto index = GetColumnIndex(aLine);
+    if (index == nullptr)
+        return nullptr;
+    const ImFont* font = ImGui::GetFont();
+    const float fontSize = ImGui::GetFontSize();
+    if (index->mFont == font && index->mFontSize == fontSize)
+        return index;
+
+    float spaceSize = ImGui::GetFont()->CalcTextSizeA(fontSize, FLT_MAX, -1.0f, " ", nullptr, nullptr).x;
+    float x = 0.0f;
+    int count = 0;
+    for (size_t i = 0; i < aLine.size(); ++count) {
+        if (count % Line::ColumnIndex::Stride == 0)
+            index->mStops[count / Line::ColumnIndex::Stride].mX = x;
+        x = AdvanceX(aLine, i, x, spaceSize);
+        i += UTF8CharLength(aLine, i);
+    }
+    index->mWidth = x;
+    index->mFont = font;
+    index->mFontSize = fontSize;
+    return index;
+}
+
+// Where aLine breaks into rows to fit mWrapWidth, or null while word wrap is off. A line is wrapped again only after
+// an edit or when the width, font or tab size changed; the row count it comes to is passed on to mLines.
+const TextEditor::Line::WrapIndex* TextEditor::GetWrap(int aLine) const {
+    if (!mWordWrap || mWrapWidth <= 0.0f)
+        return nullptr;
+
+    auto& line = mLines[aLine];
+    const ImFont* font = ImGui::GetFont();
+    const float fontSize = ImGui::GetFontSize();
+    if (!line.mWrap || line.mWrap->mWidth != mWrapWidth || line.mWrap->mTabSize != mTabSize || line.mWrap->mFont != font ||
+        line.mWrap->mFontSize != fontSize) {
+        auto wrap = std::make_shared<Line::WrapIndex>();
+        wrap->mWidth = mWrapWidth;
+        wrap->mTabSize = mTabSize;
+        wrap->mFont = font;
+        wrap->mFontSize = fontSize;
+
+        // Break after the last space or tab that fits, or inside a word too wide for a row of its own. Blanks never
+        // start a row: they hang past the edge instead.
+        float spaceSize = font->CalcTextSizeA(fontSize, FLT_MAX, -1.0f, " ", nullptr, nullptr).x;
+        size_t rowStart = 0;
+        size_t lastBreak = 0;
+        float x = 0.0f;
+        float lastBreakX = 0.0f;
+        for (size_t i = 0; i < line.size();) {
+            const char c = line[i];
+            const bool blank = c == ' ' || c == '\t';
+            const float newX = AdvanceX(line, i, x, spaceSize);
+            if (!blank && newX > mWrapWidth && i > rowStart) {
+                const bool atBreak = lastBreak > rowStart;
+                wrap->mRowWidths.push_back(atBreak ? lastBreakX : x);
+                rowStart = atBreak ? lastBreak : i;
+                wrap->mRowStarts.push_back((uint32_t)rowStart);
+                i = rowStart;
+                x = 0.0f;
+                continue;
+            }
+            x = newX;
+            i += UTF8CharLength(line, i);
+            if (blank) {
+                lastBreak = i;
+                lastBreakX = x;
+            }
+        }
+        wrap->mRowWidths.push_back(x);
+        line.mWrap = std::move(wrap);
+    }
+
+    const int rows = mLines.GetRows(aLine);
+    if (rows != 0 && rows != line.mWrap->GetRows())
+        mLines.SetRows(aLine, line.mWrap->GetRows());
+    return line.mWrap.get();
+}
+
+bool TextEditor::IsOnWordBoundary(const Coordinates& aAt) const {
+    if (aAt.mLine >= (int)mLines.size() || aAt.mColumn == 0)
+        return true;
+
+    auto& line = mLines[aAt.mLine];
+    auto cindex = GetCharacterIndex(aAt);
+    if (cindex >= (int)line.size())
+        return true;
+
+    if (mColorizerEnabled)
+        return line.GetStyle(cindex).mKind != line.GetStyle(cindex - 1).mKind;
+
+    return isspace((Char)line[cindex]) != isspace((Char)line[cindex - 1]);
+}
+
+void TextEditor::RemoveLine(int aStart, int aEnd) {
+    assert(!mReadOnly);
+    assert(aEnd >= aStart);
+    assert(mLines.size() > (size_t)(aEnd - aStart));
+
+    // What is left of the lines usually joins the one before them
+    if (mFoldCount > 0)
+        UnfoldLines(aStart - 1, aEnd);
+
+    auto lineIt = mLines.iterator_at(aStart);
+    for (int i = aStart; i < aEnd; ++i, ++lineIt) {
+        for (auto symbol : lineIt->mSymbols)
+            mCompletions.Release(symbol);
+    }
+
+    ShiftColorizeRanges(aStart, aStart - aEnd);
+    mLines.erase(aStart, aEnd);
+    assert(!mLines.empty());
+
+    mTextChanged = true;
+}
+
+void TextEditor::RemoveLine(int aIndex) {
+    assert(!mReadOnly);
+    assert(mLines.size() > 1);
+
+    if (mFoldCount > 0)
+        UnfoldLines(aIndex - 1, aIndex + 1);
+
+    for (auto symbol : mLines[aIndex].mSymbols)
+        mCompletions.Release(symbol);
+
+    ShiftColorizeRanges(aIndex, -1);
+    mLines.erase(aIndex);
+    assert(!mLines.empty());
+
+    mTextChanged = true;
+}
+
+void TextEditor::InsertLines(int aIndex, std::vector<Line>&& aLines) {
+    assert(!mReadOnly);
+
+    const int count = (int)aLines.size();
+    if (count == 0)
+        return;
+
+    if (mFoldCount > 0 && aIndex < (int)mLines.size())
+        RevealLine(aIndex);
+
+    mLines.insert(aIndex, std::move(aLines));
+    ShiftColorizeRanges(aIndex, count);
+}
+
+TextEditor::Line& TextEditor::InsertLine(int aIndex) {
+    assert(!mReadOnly);
+
+    // A line can't come in among hidden ones
+    if (mFoldCount > 0 && aIndex < (int)mLines.size())
+        RevealLine(aIndex);
+
+    auto& result = mLines.insert(aIndex);
+    ShiftColorizeRanges(aIndex, 1);
+    return result;
+}
+
+// Keeps the pending colorize range on the same lines while lines are inserted (aDelta > 0) before aIndex or
+// removed (aDelta < 0) from aIndex on, so several edits between two frames don't leave a changed line outside of it.
+void TextEditor::ShiftColorizeRanges(int aIndex, int aDelta) {
+    if (mColorRangeMin < mColorRangeMax) {
+        if (mColorRangeMin > aIndex || (aDelta < 0 && mColorRangeMin == aIndex))
+            mColorRangeMin = max(aIndex, mColorRangeMin + aDelta);
+        if (mColorRangeMax > aIndex)
+            mColorRangeMax = max(aIndex, mColorRangeMax + aDelta);
+    }
+
+    // The chunk out with the background colorizer maps its lines by position: follow it when everything moves,
+    // give up on it when lines come or go in its middle.
+    if (mColorizeJobBusy) {
+        if (aIndex + max(0, -aDelta) <= mColorizeJobMin) {
+            mColorizeJobMin += aDelta;
+            mColorizeJobMax += aDelta;
+        } else if (aIndex < mColorizeJobMax) {
+            mColorizeJobTorn = true;
+            mColorizeJobMax = max(mColorizeJobMin, mColorizeJobMax + aDelta);
+        }
+    }
+}
+
+std::string TextEditor::GetWordUnderCursor() const {
+    auto c = GetCursorPosition();
+    return GetWordAt(c);
+}
+
+std::string TextEditor::GetWordAt(const Coordinates& aCoords) const {
+    auto start = FindWordStart(aCoords);
+    auto end = FindWordEnd(aCoords);
+
+    std::string r;
+
+    auto istart = GetCharacterIndex(start);
+    auto iend = GetCharacterIndex(end);
+
+    for (auto it = istart; it < iend; ++it)
+        r.push_back(mLines[aCoords.mLine][it]);
+
+    return r;
+}
+
+ImU32 TextEditor::GetStyleColor(const Style& aStyle) const {
+    if (!mColorizerEnabled)
+        return mPalette[(int)PaletteIndex::Default];
+    if (aStyle.mComment)
+        return mPalette[(int)PaletteIndex::Comment];
+    if (aStyle.mMultiLineComment)
+        return mPalette[(int)PaletteIndex::MultiLineComment];
+    auto const color = mPalette[(int)aStyle.mKind];
+    if (aStyle.mPreprocessor) {
+        const auto ppcolor = mPalette[(int)PaletteIndex::Preprocessor];
+        const int c0 = ((ppcolor & 0xff) + (color & 0xff)) / 2;
+        const int c1 = (((ppcolor >> 8) & 0xff) + ((color >> 8) & 0xff)) / 2;
+        const int c2 = (((ppcolor >> 16) & 0xff) + ((color >> 16) & 0xff)) / 2;
+        const int c3 = (((ppcolor >> 24) & 0xff) + ((color >> 24) & 0xff)) / 2;
+        return ImU32(c0 | (c1 << 8) | (c2 << 16) | (c3 << 24));
+    }
+    return color;
+}
+
+static bool IsIdentifierChar(char c) {
+    return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+void TextEditor::HandleKeyboardInputs() {
+    ImGuiIO& io = ImGui::GetIO();
+    auto shift = io.KeyShift;
+    auto ctrl = io.ConfigMacOSXBehaviors ? io.KeySuper : io.KeyCtrl;
+    auto alt = io.ConfigMacOSXBehaviors ? io.KeyCtrl : io.KeyAlt;
+
+    if (ImGui::IsWindowFocused()) {
+        if (ImGui::IsWindowHovered())
+            ImGui::SetMouseCursor(ImGuiMouseCursor_TextInput);
+        // ImGui::CaptureKeyboardFromApp(true);
+
+        io.WantCaptureKeyboard = true;
+        io.WantTextInput = true;
+
+        // While the completion popup is open, it takes the keys that pick a word
+        if (mCompletion.mOpen && !ctrl && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)))
+            mCompletion.mSelected = max(0, mCompletion.mSelected - 1);
+        else if (mCompletion.mOpen && !ctrl && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)))
+            mCompletion.mSelected = min((int)mCompletion.mItems.size() - 1, mCompletion.mSelected + 1);
+        else if (mCompletion.mOpen && !ctrl && !shift && !alt &&
+                 (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Tab)) || ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Enter))))
+            AcceptCompletion();
+        else if (mCompletion.mOpen && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Escape)))
+            CloseCompletion();
+        else if (!mState.mCursors.empty() && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Escape)))
+            ClearCursors();
+        else if (ctrl && !shift && alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)))
+            AddCursorOnRow(-1);
+        else if (ctrl && !shift && alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)))
+            AddCursorOnRow(1);
+        else if (ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGuiKey_D))
+            AddCursorAtNextMatch();
+        else if (!ctrl && shift && alt &&
+                 (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)) || ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)) ||
+                     ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_LeftArrow)) || ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_RightArrow)))) {
+            // Grows the column selection from its other corner, by rows and by columns past the ends of lines too
+            const auto start = mColumnMode ? mInteractiveStart : mState.mCursorPosition;
+            auto end = mColumnMode ? mInteractiveEnd : mState.mCursorPosition;
+            int rowInLine;
+            if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)) && mLines.GetFirstRow(end.mLine) > 0)
+                end.mLine = (int)mLines.FindRow(mLines.GetFirstRow(end.mLine) - 1, rowInLine);
+            else if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)) && mLines.GetFirstRow(end.mLine) + (size_t)mLines.GetRows(end.mLine) < mLines.rows())
+                end.mLine = (int)mLines.FindRow(mLines.GetFirstRow(end.mLine) + (size_t)mLines.GetRows(end.mLine), rowInLine);
+            else if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_LeftArrow)))
+                end.mColumn = max(0, end.mColumn - 1);
+            else if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_RightArrow)))
+                ++end.mColumn;
+            SetColumnSelection(start, end);
+        }
+        else if (!IsReadOnly() && ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Z)))
+            Undo();
+        else if (ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGuiKey_Y) || ctrl && shift && !alt && ImGui::IsKeyPressed(ImGuiKey_Z))
+            Redo();
+        else if (!ctrl && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)))
+            MoveUp(1, shift);
+        else if (!ctrl && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)))
+            MoveDown(1, shift);
+        else if (!alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_LeftArrow)))
+            MoveLeft(1, shift, ctrl);
+        else if (!alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_RightArrow)))
+            MoveRight(1, shift, ctrl);
+        else if (!alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_PageUp)))
+            MoveUp(GetPageSize() - 4, shift);
+        else if (!alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_PageDown)))
+            MoveDown(GetPageSize() - 4, shift);
+        else if (!alt && ctrl && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Home)))
+            MoveTop(shift);
+        else if (ctrl && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_End)))
+            MoveBottom(shift);
+        else if (!ctrl && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Home)))
+            MoveHome(shift);
+        else if (!ctrl && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_End)))
+            MoveEnd(shift);
+        else if (!IsReadOnly() && !ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Delete)))
+            Delete();
+        else if (!IsReadOnly() && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Backspace))) {
+            Backspace();
+            if (mCompletion.mOpen)
+                UpdateCompletion();
+        }
+        else if (!ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Insert))) {
+            if (mTrace != nullptr)
+                mTrace->Write(EditTrace::Op::ToggleOverwrite);
+            mOverwrite ^= true;
+        }
+        else if (ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Insert)))
+            Copy();
+        else if (ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_C)))
+            Copy();
+        else if (!IsReadOnly() && !ctrl && shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Insert)))
+            Paste();
+        else if (!IsReadOnly() && ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_V)))
+            Paste();
+        else if (ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_X)))
+            Cut();
+        else if (!ctrl && shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Delete)))
+            Cut();
+        else if (ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_A)))
+            SelectAll();
+        else if (ctrl && !alt && ImGui::IsKeyPressed(ImGuiKey_Slash))
+          ToggleComment(shift);
+        else if (!ctrl && !alt && ImGui::IsKeyPressed(ImGuiKey_F3)) {
+            if (shift)
+                FindPrevious();
+            else
+                FindNext();
+        }
+        else if (ctrl && shift && !alt && ImGui::IsKeyPressed(ImGuiKey_LeftBracket)) {
+            // The block the cursor's line starts, or else the innermost one around it
+            const int line = GetActualCursorCoordinates().mLine;
+            if (!Fold(line)) {
+                const auto start = mLines.FindBlockStart((size_t)line, 1);
+                if (start < mLines.size())
+                    Fold((int)start);
+            }
+        }
+        else if (ctrl && shift && !alt && ImGui::IsKeyPressed(ImGuiKey_RightBracket))
+            Unfold(GetActualCursorCoordinates().mLine);
+        else if (ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGuiKey_RightBracket))
+            JumpToMatchingBlock();
+        else if (!IsReadOnly() && ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGuiKey_Space))
+            OpenCompletion();
+        else if (!IsReadOnly() && !ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Enter)))
+            EnterCharacter('\n', false);
+        else if (!IsReadOnly() && !ctrl && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Tab))) {
+            // A selection over several lines gets indented, or with Shift unindented, as a block
+            if (mState.mCursors.empty() && mState.mSelectionStart.mLine != mState.mSelectionEnd.mLine)
+                EnterCharacter('\t', shift);
+            else {
+                EnterCharacter(' ', false);
+                EnterCharacter(' ', false);
+            }
+        }
+
+        if (!IsReadOnly() && !io.InputQueueCharacters.empty()) {
+            bool identifier = false;
+            for (int i = 0; i < io.InputQueueCharacters.Size; i++) {
+                auto c = io.InputQueueCharacters[i];
+                // Ctrl+Space opens the completion popup rather than typing a space
+                if (c == ' ' && ctrl && !alt)
+                    continue;
+                if (c != 0 && (c == '\n' || c >= 32)) {
+                    EnterCharacter(c, shift);
+                    identifier = c < 0x80 && IsIdentifierChar((char)c);
+                }
+            }
+            io.InputQueueCharacters.resize(0);
+
+            if (identifier && (mAutoComplete || mCompletion.mOpen))
+                UpdateCompletion();
+        }
+    }
+}
+
+void TextEditor::HandleMouseInputs() {
+    ImGuiIO& io = ImGui::GetIO();
+    auto shift = io.KeyShift;
+    auto ctrl = io.ConfigMacOSXBehaviors ? io.KeySuper : io.KeyCtrl;
+    auto alt = io.ConfigMacOSXBehaviors ? io.KeyCtrl : io.KeyAlt;
+
+    if (ImGui::IsWindowHovered()) {
+        if (!shift && !alt) {
+            auto click = ImGui::IsMouseClicked(0);
+            auto doubleClick = ImGui::IsMouseDoubleClicked(0);
+            auto t = ImGui::GetTime();
+            auto tripleClick = click && !doubleClick && (mLastClick != -1.0f && (t - mLastClick) < io.MouseDoubleClickTime);
+
+            /*
+            Left mouse button triple click
+            */
+
+            if (tripleClick) {
+                if (!ctrl) {
+                    ClearCursors();
+                    mState.mCursorPosition = mInteractiveStart = mInteractiveEnd = ScreenPosToCoordinates(ImGui::GetMousePos());
+                    mSelectionMode = SelectionMode::Line;
+                    SetSelection(mInteractiveStart, mInteractiveEnd, mSelectionMode);
+                }
+
+                mLastClick = -1.0f;
+            }
+
+            /*
+            Left mouse button double click
+            */
+
+            else if (doubleClick) {
+                if (!ctrl) {
+                    ClearCursors();
+                    mState.mCursorPosition = mInteractiveStart = mInteractiveEnd = ScreenPosToCoordinates(ImGui::GetMousePos());
+                    if (mSelectionMode == SelectionMode::Line)
+                        mSelectionMode = SelectionMode::Normal;
+                    else
+                        mSelectionMode = SelectionMode::Word;
+                    SetSelection(mInteractiveStart, mInteractiveEnd, mSelectionMode);
+                }
+
+                mLastClick = (float)ImGui::GetTime();
+            }
+
+            /*
+            Left mouse button click
+            */
+            else if (click && mCompletion.mOpen && CompletionItemAt(ImGui::GetMousePos()) >= 0) {
+                mCompletion.mSelected = CompletionItemAt(ImGui::GetMousePos());
+                AcceptCompletion();
+                mLastClick = -1.0f;
+            }
+            else if (click && ToggleFoldAt(ImGui::GetMousePos())) {
+                mLastClick = -1.0f;
+            }
+            else if (click) {
+                ClearCursors();
+                mState.mCursorPosition = mInteractiveStart = mInteractiveEnd = ScreenPosToCoordinates(ImGui::GetMousePos());
+                if (ctrl)
+                    mSelectionMode = SelectionMode::Word;
+                else
+                    mSelectionMode = SelectionMode::Normal;
+                SetSelection(mInteractiveStart, mInteractiveEnd, mSelectionMode);
+
+                mLastClick = (float)ImGui::GetTime();
+            }
+            // Mouse left button dragging (=> update selection)
+            else if (ImGui::IsMouseDragging(0) && ImGui::IsMouseDown(0)) {
+                io.WantCaptureMouse = true;
+                mState.mCursorPosition = mInteractiveEnd = ScreenPosToCoordinates(ImGui::GetMousePos());
+                SetSelection(mInteractiveStart, mInteractiveEnd, mSelectionMode);
+            }
+        } else if (alt) {
+            // Alt+click adds a cursor, or removes the one clicked; Shift+Alt+click or drag selects a column
+            if (ImGui::IsMouseClicked(0)) {
+                if (shift)
+                    SetColumnSelection(mColumnMode ? mInteractiveStart : mState.mCursorPosition, ScreenPosToColumn(ImGui::GetMousePos()));
+                else {
+                    const auto pos = ScreenPosToCoordinates(ImGui::GetMousePos());
+                    if (!RemoveCursor(pos))
+                        AddCursor(pos);
+                }
+                mLastClick = -1.0f;
+            } else if (shift && mColumnMode && ImGui::IsMouseDragging(0) && ImGui::IsMouseDown(0)) {
+                io.WantCaptureMouse = true;
+                SetColumnSelection(mInteractiveStart, ScreenPosToColumn(ImGui::GetMousePos()));
+            }
+        }
+    }
+}
+
+// Where a draw list is at, to copy out what gets drawn after
+struct DrawMark {
+    int mVertices;
+    int mIndices;
+    unsigned int mFirstIndex;
+};
+
+static DrawMark MarkDrawList(const ImDrawList* aList) {
+    return DrawMark{aList->VtxBuffer.Size, aList->IdxBuffer.Size, aList->_VtxCurrentIdx};
+}
+
+// Appends what was drawn since aMark, positions relative to aOrigin and indices to its first vertex. Fails if the list
+// started a new command in between, which numbers the vertices from 0 again.
+static bool CopyDrawn(const ImDrawList* aList, const DrawMark& aMark, const ImVec2& aOrigin, std::vector<ImDrawVert>& aVertices,
+    std::vector<ImDrawIdx>& aIndices) {
+    const int vertices = aList->VtxBuffer.Size - aMark.mVertices;
+    if (aList->_VtxCurrentIdx - aMark.mFirstIndex != (unsigned int)vertices)
+        return false;
+
+    const size_t first = aVertices.size();
+    aVertices.insert(aVertices.end(), aList->VtxBuffer.Data + aMark.mVertices, aList->VtxBuffer.Data + aList->VtxBuffer.Size);
+    for (size_t i = first; i < aVertices.size(); ++i) {
+        aVertices[i].pos.x -= aOrigin.x;
+        aVertices[i].pos.y -= aOrigin.y;
+    }
+    for (int i = aMark.mIndices; i < aList->IdxBuffer.Size; ++i)
+        aIndices.push_back((ImDrawIdx)(aList->IdxBuffer.Data[i] - aMark.mFirstIndex));
+    return true;
+}
+
+// Draws what CopyDrawn copied out again, at aOrigin
+static void ReplayDrawn(ImDrawList* aList, const ImDrawVert* aVertices, int aVertexCount, const ImDrawIdx* aIndices, int aIndexCount,
+    const ImVec2& aOrigin) {
+    if (aIndexCount == 0)
+        return;
+
+    aList->PrimReserve(aIndexCount, aVertexCount);
+    ImDrawVert* vertices = aList->_VtxWritePtr;
+    memcpy(vertices, aVertices, aVertexCount * sizeof(ImDrawVert));
+    for (int i = 0; i < aVertexCount; ++i) {
+        vertices[i].pos.x += aOrigin.x;
+        vertices[i].pos.y += aOrigin.y;
+    }
+    ImDrawIdx* indices = aList->_IdxWritePtr;
+    const unsigned int first = aList->_VtxCurrentIdx;
+    for (int i = 0; i < aIndexCount; ++i)
+        indices[i] = (ImDrawIdx)(aIndices[i] + first);
+
+    aList->_VtxWritePtr += aVertexCount;
+    aList->_IdxWritePtr += aIndexCount;
+    aList->_VtxCurrentIdx += aVertexCount;
+}
+
+void TextEditor::Render() {
+    /* Compute mCharAdvance regarding to scaled font size (Ctrl + mouse wheel)*/
+    const float fontSize = ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), FLT_MAX, -1.0f, "#", nullptr, nullptr).x;
+    mCharAdvance = ImVec2(fontSize, ImGui::GetTextLineHeightWithSpacing() * mLineSpacing);
+
+    /* Update palette with the current alpha from style */
+    for (int i = 0; i < (int)PaletteIndex::Max; ++i) {
+        auto color = ImGui::ColorConvertU32ToFloat4(mPaletteBase[i]);
+        color.w *= ImGui::GetStyle().Alpha;
+        mPalette[i] = ImGui::ColorConvertFloat4ToU32(color);
+    }
+
+    auto contentSize = ImGui::GetWindowContentRegionMax();
+    auto drawList = ImGui::GetWindowDrawList();
+
+    if (mScrollToTop) {
+        mScrollToTop = false;
+        ImGui::SetScrollY(0.f);
+    }
+
+    ImVec2 cursorScreenPos = ImGui::GetCursorScreenPos();
+    auto scrollX = ImGui::GetScrollX();
+    auto scrollY = ImGui::GetScrollY();
+
+    // Lines take one row each, or as many as word wrap breaks them into
+    auto firstRow = (int)floor(scrollY / mCharAdvance.y);
+    auto lastRow = (int)floor((scrollY + contentSize.y) / mCharAdvance.y);
+    auto globalLineMax = (int)mLines.size();
+
+    // Deduce mTextStart by evaluating mLines size (global lineMax) plus two spaces as text width
+    char buf[16];
+    snprintf(buf, 16, " %d ", globalLineMax);
+    mTextStart = ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), FLT_MAX, -1.0f, buf, nullptr, nullptr).x + mLeftMargin;
+    if (mWordWrap)
+        mWrapWidth = max(mCharAdvance.x, ImGui::GetContentRegionAvail().x - mTextStart - mCharAdvance.x);
+
+    if (!mLines.empty()) {
+        float spaceSize = ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), FLT_MAX, -1.0f, " ", nullptr, nullptr).x;
+
+        // Line numbers and text drawn the same way as last frame are copied from mLineDraws, not laid out again
+        DrawStyle drawStyle;
+        drawStyle.mFont = ImGui::GetFont();
+        drawStyle.mFontSize = ImGui::GetFontSize();
+        drawStyle.mTabSize = mTabSize;
+        drawStyle.mShowWhitespaces = mShowWhitespaces;
+        drawStyle.mWrapWidth = mWordWrap ? mWrapWidth : 0.0f;
+        drawStyle.mPalette = mPalette;
+        if (drawStyle != mDrawStyle) {
+            mDrawStyle = drawStyle;
+            ++mDrawGeneration;
+            mMaxLineWidth = 0.0f;
+        }
+        const size_t rows = (size_t)max(min(lastRow, (int)mLines.rows() - 1) - firstRow + 1, 0) + 2;
+        if (mLineDraws.size() < rows)
+            mLineDraws.resize(rows);
+        const ImVec2 clipMin = drawList->GetClipRectMin();
+        const ImVec2 clipMax = drawList->GetClipRectMax();
+        const auto& blockMatch = FindMatchingBlock();
+
+        // The popup goes once the cursor moved or the text changed other than by typing the identifier
+        if (mCompletion.mOpen && (mCompletion.mAt != GetActualCursorCoordinates() || mCompletion.mVersion != mVersion))
+            mCompletion.mOpen = false;
+
+        // All the carets blink together
+        const bool focused = ImGui::IsWindowFocused();
+        bool caretShown = false;
+        if (focused) {
+            auto timeEnd = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            auto elapsed = timeEnd - mStartTime;
+            caretShown = elapsed > 400;
+            if (elapsed > 800)
+                mStartTime = timeEnd;
+        }
+
+        int rowInLine;
+        auto lineNo = (int)mLines.FindRow((size_t)max(0, firstRow), rowInLine);
+        auto row = max(0, firstRow) - rowInLine; // the one lineNo starts on
+        auto lineIt = mLines.iterator_at(lineNo);
+        while (lineNo < (int)mLines.size() && row <= lastRow) {
+            ImVec2 lineStartScreenPos = ImVec2(cursorScreenPos.x, cursorScreenPos.y + row * mCharAdvance.y);
+            ImVec2 textScreenPos = ImVec2(lineStartScreenPos.x + mTextStart, lineStartScreenPos.y);
+
+            auto& line = *lineIt;
+            Coordinates lineStartCoord(lineNo, 0);
+            Coordinates lineEndCoord(lineNo, GetLineMaxColumn(lineNo));
+            const Line::WrapIndex* wrap = GetWrap(lineNo);
+            const int lineRows = wrap != nullptr ? wrap->GetRows() : 1;
+            const float lineHeight = lineRows * mCharAdvance.y;
+
+            // Fills from aStartX on row aStartRow to aEndX on row aEndRow, and the rows between to their ends
+            auto fillRows = [&](int aStartRow, float aStartX, int aEndRow, float aEndX, ImU32 aColor) {
+                for (int r = aStartRow; r <= aEndRow; ++r) {
+                    const float x0 = r == aStartRow ? aStartX : 0.0f;
+                    const float x1 = r == aEndRow ? aEndX : wrap->mRowWidths[r];
+                    if (x0 < x1) {
+                        ImVec2 vstart(lineStartScreenPos.x + mTextStart + x0, lineStartScreenPos.y + r * mCharAdvance.y);
+                        ImVec2 vend(lineStartScreenPos.x + mTextStart + x1, lineStartScreenPos.y + (r + 1) * mCharAdvance.y);
+                        drawList->AddRectFilled(vstart, vend, aColor);
+                    }
+                }
+            };
+
+            // Highlight the matches of the find pattern. Only lines in view are searched, and on those only what is
+            // in view: from the column stop left of it, or the first row that is, to the right edge or the last row.
+            if (!mSearch.IsEmpty()) {
+                const char* begin = line.data();
+                const char* end = begin + line.size();
+                size_t index = 0;
+                float x = 0.0f;
+                int r = 0;
+                if (wrap != nullptr) {
+                    r = max(0, min(lineRows - 1, (int)std::floor((clipMin.y - lineStartScreenPos.y) / mCharAdvance.y)));
+                    index = r > 0 ? wrap->mRowStarts[r - 1] : 0;
+                } else if (auto columns = GetColumnIndexX(line)) {
+                    auto stop = std::partition_point(columns->mStops.begin(), columns->mStops.end(),
+                        [&](const Line::ColumnStop& aStop) { return aStop.mX <= clipMin.x - textScreenPos.x; });
+                    if (stop != columns->mStops.begin()) {
+                        --stop;
+                        index = stop->mIndex;
+                        x = stop->mX;
+                    }
+                }
+
+                // Where a byte offset is on screen, walking on from the last one
+                auto walkTo = [&](size_t aIndex) {
+                    while (index < aIndex) {
+                        x = AdvanceX(line, index, x, spaceSize);
+                        index += UTF8CharLength(line, index);
+                        if (wrap != nullptr && r + 1 < lineRows && index == wrap->mRowStarts[r]) {
+                            ++r;
+                            x = 0.0f;
+                        }
+                    }
+                };
+
+                const char* start;
+                const char* stop;
+                for (const char* at = begin + index; mSearch.Find(begin, end, at, start, stop); at = stop) {
+                    walkTo(start - begin);
+                    if (textScreenPos.x + x > clipMax.x || lineStartScreenPos.y + r * mCharAdvance.y > clipMax.y)
+                        break;
+                    const int startRow = r;
+                    const float startX = x;
+                    walkTo(stop - begin);
+                    fillRows(startRow, startX, r, x, mPalette[(int)PaletteIndex::FindMatch]);
+                }
+            }
+
+            // Highlight the block token at the cursor and its partner
+            if (blockMatch.mFound) {
+                auto highlight = [&](const Coordinates& aStart, const Coordinates& aEnd) {
+                    if (aStart.mLine != lineNo)
+                        return;
+                    int startRow, endRow;
+                    const float startX = TextDistanceToRowStart(aStart, startRow);
+                    const float endX = TextDistanceToRowStart(aEnd, endRow);
+                    fillRows(startRow, startX, endRow, endX, mPalette[(int)PaletteIndex::MatchingBlock]);
+                };
+                highlight(blockMatch.mStart, blockMatch.mEnd);
+                highlight(blockMatch.mPartnerStart, blockMatch.mPartnerEnd);
+            }
+
+            // Draw selection for the current line, a rectangle per row it covers
+            auto drawSelection = [&](const Coordinates& aStart, const Coordinates& aEnd) {
+                float sstart = -1.0f;
+                float ssend = -1.0f;
+                int srow = 0;
+                int erow = lineRows - 1;
+
+                assert(aStart <= aEnd);
+                if (aStart <= lineEndCoord)
+                    sstart = aStart > lineStartCoord ? TextDistanceToRowStart(aStart, srow) : 0.0f;
+                if (aEnd > lineStartCoord)
+                    ssend = TextDistanceToRowStart(aEnd < lineEndCoord ? aEnd : lineEndCoord, erow);
+
+                if (aEnd.mLine > lineNo)
+                    ssend += mCharAdvance.x;
+
+                if (sstart != -1 && ssend != -1)
+                    fillRows(srow, sstart, erow, ssend, mPalette[(int)PaletteIndex::Selection]);
+            };
+            drawSelection(mState.mSelectionStart, mState.mSelectionEnd);
+
+            // The other cursors are in order, so the ones on this line follow the first that doesn't end before it
+            auto cursorsOnLine = std::partition_point(mState.mCursors.begin(), mState.mCursors.end(),
+                [&](const Cursor& aCursor) { return aCursor.mSelectionEnd < lineStartCoord; });
+            for (auto it = cursorsOnLine; it != mState.mCursors.end() && it->mSelectionStart <= lineEndCoord; ++it) {
+                if (it->mSelectionStart < it->mSelectionEnd)
+                    drawSelection(it->mSelectionStart, it->mSelectionEnd);
+            }
+
+            // Draw breakpoints
+            auto start = ImVec2(lineStartScreenPos.x + scrollX, lineStartScreenPos.y);
+
+            if (line.mBreakpoint) {
+                auto end = ImVec2(lineStartScreenPos.x + contentSize.x + 2.0f * scrollX, lineStartScreenPos.y + lineHeight);
+                drawList->AddRectFilled(start, end, mPalette[(int)PaletteIndex::Breakpoint]);
+            }
+
+            // Draw error markers
+            if (line.mError != 0) {
+                auto end = ImVec2(lineStartScreenPos.x + contentSize.x + 2.0f * scrollX, lineStartScreenPos.y + lineHeight);
+                drawList->AddRectFilled(start, end, mPalette[(int)PaletteIndex::ErrorMarker]);
+
+                if (ImGui::IsMouseHoveringRect(lineStartScreenPos, end)) {
+                    ImGui::BeginTooltip();
+                    ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.2f, 0.2f, 1.0f));
+                    ImGui::Text("Error at line %d:", lineNo + 1);
+                    ImGui::PopStyleColor();
+                    ImGui::Separator();
+                    ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 1.0f, 0.2f, 1.0f));
+                    ImGui::Text("%s", mErrorMessages[line.mError - 1].c_str());
+                    ImGui::PopStyleColor();
+                    ImGui::EndTooltip();
+                }
+            }
+
+            // Draw the fold marker between the line number and the text: pointing right on a folded line, down on one
+            // that can be folded
+            const bool folded = line.mFolded != 0;
+            if (folded || (line.mBlocks.mOpens > 0 && GetFoldEnd(lineNo) >= 0)) {
+                const float size = mCharAdvance.x * 0.3f;
+                const float x = textScreenPos.x - mCharAdvance.x;
+                const float y = lineStartScreenPos.y + mCharAdvance.y * 0.5f;
+                const auto color = mPalette[(int)PaletteIndex::LineNumber];
+                if (folded)
+                    drawList->AddTriangleFilled(ImVec2(x - size * 0.6f, y - size), ImVec2(x - size * 0.6f, y + size), ImVec2(x + size, y), color);
+                else
+                    drawList->AddTriangleFilled(ImVec2(x - size, y - size * 0.6f), ImVec2(x + size, y - size * 0.6f), ImVec2(x, y + size), color);
+            }
+
+            // What was drawn of the line last time, unless the clip rect cuts through it: the font leaves out the
+            // glyphs that fall outside
+            LineDraw* draw = nullptr;
+            bool cached = false;
+            if (lineStartScreenPos.y >= clipMin.y && lineStartScreenPos.y + lineHeight <= clipMax.y) {
+                const ImVec2 fraction(textScreenPos.x - std::floor(textScreenPos.x), textScreenPos.y - std::floor(textScreenPos.y));
+                const float clipMinX = clipMin.x - textScreenPos.x;
+                const float clipMaxX = clipMax.x - textScreenPos.x;
+                draw = &mLineDraws[lineNo % mLineDraws.size()];
+                cached = line.mDrawId != 0 && draw->mId == line.mDrawId && draw->mLine == lineNo && draw->mGeneration == mDrawGeneration &&
+                         draw->mFraction.x == fraction.x && draw->mFraction.y == fraction.y && draw->mClipMinX == clipMinX &&
+                         draw->mClipMaxX == clipMaxX;
+                if (!cached) {
+                    if (line.mDrawId == 0)
+                        line.mDrawId = ++mLastDrawId;
+                    draw->mId = line.mDrawId;
+                    draw->mLine = lineNo;
+                    draw->mGeneration = mDrawGeneration;
+                    draw->mFraction = fraction;
+                    draw->mClipMinX = clipMinX;
+                    draw->mClipMaxX = clipMaxX;
+                    draw->mVertices.clear();
+                    draw->mIndices.clear();
+                    draw->mWidth = -1.0f;
+                }
+            }
+
+            // The widest line seen so far sets the scroll width. Measuring every line up front would cost as much as
+            // drawing them, so lines are taken in as they come into view and are measured again only after an edit.
+            // Wrapped lines don't scroll sideways.
+            float width = wrap != nullptr ? wrap->mRowWidths.back() : -1.0f;
+            if (wrap == nullptr) {
+                width = cached ? draw->mWidth : -1.0f;
+                if (width < 0.0f) {
+                    width = TextDistanceToLineStart(Coordinates(lineNo, GetLineMaxColumn(lineNo)));
+                    if (draw != nullptr)
+                        draw->mWidth = width;
+                }
+                mMaxLineWidth = max(mMaxLineWidth, width);
+            }
+
+            // Draw line number (right aligned)
+            if (cached) {
+                ReplayDrawn(drawList, draw->mVertices.data(), draw->mNumberVertices, draw->mIndices.data(), draw->mNumberIndices, textScreenPos);
+            } else {
+                const auto mark = MarkDrawList(drawList);
+                snprintf(buf, 16, "%d  ", lineNo + 1);
+
+                auto lineNoWidth = ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), FLT_MAX, -1.0f, buf, nullptr, nullptr).x;
+                drawList->AddText(ImVec2(lineStartScreenPos.x + mTextStart - lineNoWidth, lineStartScreenPos.y),
+                    mPalette[(int)PaletteIndex::LineNumber], buf);
+
+                if (draw != nullptr && !CopyDrawn(drawList, mark, textScreenPos, draw->mVertices, draw->mIndices))
+                    draw->mId = 0;
+                if (draw != nullptr) {
+                    draw->mNumberVertices = (int)draw->mVertices.size();
+                    draw->mNumberIndices = (int)draw->mIndices.size();
+                }
+            }
+
+            // Highlight the current line (where the cursor is)
+            if (mState.mCursorPosition.mLine == lineNo && !HasSelection()) {
+                auto end = ImVec2(start.x + contentSize.x + scrollX, start.y + lineHeight);
+                drawList->AddRectFilled(
+                    start, end, mPalette[(int)(focused ? PaletteIndex::CurrentLineFill : PaletteIndex::CurrentLineFillInactive)]);
+                drawList->AddRect(start, end, mPalette[(int)PaletteIndex::CurrentLineEdge], 1.0f);
+            }
+
+            // Render the cursors
+            if (caretShown) {
+                auto drawCaret = [&](const Coordinates& aAt) {
+                    float width = 1.0f;
+                    auto cindex = GetCharacterIndex(aAt);
+                    int crow;
+                    float cx = TextDistanceToRowStart(aAt, crow);
+
+                    if (mOverwrite && cindex < (int)line.size()) {
+                        auto c = (Char)line[cindex];
+                        if (c == '\t') {
+                            auto x = (1.0f + std::floor((1.0f + cx) / (float(mTabSize) * spaceSize))) * (float(mTabSize) * spaceSize);
+                            width = x - cx;
+                        } else {
+                            char buf2[2];
+                            buf2[0] = line[cindex];
+                            buf2[1] = '\0';
+                            width = ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), FLT_MAX, -1.0f, buf2).x;
+                        }
+                    }
+                    ImVec2 cstart(textScreenPos.x + cx, lineStartScreenPos.y + crow * mCharAdvance.y);
+                    ImVec2 cend(textScreenPos.x + cx + width, lineStartScreenPos.y + (crow + 1) * mCharAdvance.y);
+                    drawList->AddRectFilled(cstart, cend, mPalette[(int)PaletteIndex::Cursor]);
+                };
+                if (mState.mCursorPosition.mLine == lineNo)
+                    drawCaret(mState.mCursorPosition);
+                for (auto it = cursorsOnLine; it != mState.mCursors.end() && it->mSelectionStart <= lineEndCoord; ++it) {
+                    if (it->mCursorPosition.mLine == lineNo)
+                        drawCaret(it->mCursorPosition);
+                }
+            }
+
+            // Render colorized text a run at a time. Spaces and tabs only move the pen along (and get a marker when
+            // whitespace is shown), the text between them goes to AddText straight from the line. Only what falls in
+            // the clip rect's x range is laid out: a long line starts from the column stop just left of it, and
+            // drawText returns false once the pen is past its right edge. A wrapped line is drawn a row at a time,
+            // each from the left.
+            ImVec2 bufferOffset;
+            const float visibleMinX = clipMin.x - textScreenPos.x - mCharAdvance.x * 2.0f;
+            const float visibleMaxX = clipMax.x - textScreenPos.x + mCharAdvance.x * 2.0f;
+            auto drawText = [&](size_t aStart, size_t aEnd, ImU32 aColor) {
+                const char* text = line.data();
+                for (size_t i = aStart; i < aEnd;) {
+                    if (bufferOffset.x > visibleMaxX)
+                        return false;
+                    if (text[i] == '\t') {
+                        auto oldX = bufferOffset.x;
+                        bufferOffset.x =
+                            (1.0f + std::floor((1.0f + bufferOffset.x) / (float(mTabSize) * spaceSize))) * (float(mTabSize) * spaceSize);
+                        ++i;
+
+                        if (mShowWhitespaces) {
+                            const auto s = ImGui::GetFontSize();
+                            const auto x1 = textScreenPos.x + oldX + 1.0f;
+                            const auto x2 = textScreenPos.x + bufferOffset.x - 1.0f;
+                            const auto y = textScreenPos.y + bufferOffset.y + s * 0.5f;
+                            const ImVec2 p1(x1, y);
+                            const ImVec2 p2(x2, y);
+                            const ImVec2 p3(x2 - s * 0.2f, y - s * 0.2f);
+                            const ImVec2 p4(x2 - s * 0.2f, y + s * 0.2f);
+                            drawList->AddLine(p1, p2, 0x90909090);
+                            drawList->AddLine(p2, p3, 0x90909090);
+                            drawList->AddLine(p2, p4, 0x90909090);
+                        }
+                    } else if (text[i] == ' ') {
+                        if (mShowWhitespaces) {
+                            const auto s = ImGui::GetFontSize();
+                            const auto x = textScreenPos.x + bufferOffset.x + spaceSize * 0.5f;
+                            const auto y = textScreenPos.y + bufferOffset.y + s * 0.5f;
+                            drawList->AddCircleFilled(ImVec2(x, y), 1.5f, 0x80808080, 4);
+                        }
+                        bufferOffset.x += spaceSize;
+                        ++i;
+                    } else {
+                        auto end = i + 1;
+                        while (end < aEnd && text[end] != '\t' && text[end] != ' ')
+                            ++end;
+
+                        // A word running past the right edge is cut after the character that crosses it
+                        const char* fits = text + end;
+                        const float wordWidth = ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), visibleMaxX - bufferOffset.x, -1.0f,
+                            text + i, text + end, &fits).x;
+                        const char* wordEnd = fits < text + end ? min(fits + UTF8CharLength(fits, text + end), text + end) : text + end;
+
+                        const ImVec2 newOffset(textScreenPos.x + bufferOffset.x, textScreenPos.y + bufferOffset.y);
+                        drawList->AddText(newOffset, aColor, text + i, wordEnd);
+                        if (wordEnd < text + end)
+                            return false;
+                        bufferOffset.x += wordWidth;
+                        i = end;
+                    }
+                }
+                return true;
+            };
+
+            if (cached) {
+                ReplayDrawn(drawList, draw->mVertices.data() + draw->mNumberVertices, (int)draw->mVertices.size() - draw->mNumberVertices,
+                    draw->mIndices.data() + draw->mNumberIndices, (int)draw->mIndices.size() - draw->mNumberIndices, textScreenPos);
+            } else {
+                const auto mark = MarkDrawList(drawList);
+
+                // Bytes no run covers, like text typed since the line was last colorized, are drawn uncolored
+                const auto defaultColor = GetStyleColor(Style());
+                auto drawRuns = [&](size_t aFrom, size_t aTo) {
+                    size_t drawn = aFrom;
+                    bool more = true;
+                    auto run = std::partition_point(line.mRuns.begin(), line.mRuns.end(),
+                        [drawn](const TokenRun& aRun) { return (size_t)aRun.mOffset + aRun.mLength <= drawn; });
+                    for (; more && run != line.mRuns.end() && run->mOffset < aTo; ++run) {
+                        const auto start = max((size_t)run->mOffset, drawn);
+                        const auto end = min((size_t)run->mOffset + run->mLength, aTo);
+                        if (drawn < start)
+                            more = drawText(drawn, start, defaultColor);
+                        if (more && start < end)
+                            more = drawText(start, end, GetStyleColor(run->mStyle));
+                        drawn = max(drawn, end);
+                    }
+                    if (more && drawn < aTo)
+                        drawText(drawn, aTo, defaultColor);
+                };
+
+                if (wrap != nullptr) {
+                    for (int r = 0; r < lineRows; ++r) {
+                        bufferOffset = ImVec2(0.0f, r * mCharAdvance.y);
+                        drawRuns(r > 0 ? wrap->mRowStarts[r - 1] : 0, r + 1 < lineRows ? wrap->mRowStarts[r] : line.size());
+                    }
+                } else {
+                    // Skip what is scrolled off to the left
+                    size_t drawn = 0;
+                    if (auto index = GetColumnIndexX(line)) {
+                        auto stop = std::partition_point(index->mStops.begin(), index->mStops.end(),
+                            [visibleMinX](const Line::ColumnStop& aStop) { return aStop.mX <= visibleMinX; });
+                        if (stop != index->mStops.begin()) {
+                            --stop;
+                            drawn = stop->mIndex;
+                            bufferOffset.x = stop->mX;
+                        }
+                    }
+                    drawRuns(drawn, line.size());
+                }
+
+                if (draw != nullptr && !CopyDrawn(drawList, mark, textScreenPos, draw->mVertices, draw->mIndices))
+                    draw->mId = 0;
+            }
+
+            // A folded line ends in a box that stands for the lines under it, which are skipped over
+            row += lineRows;
+            if (folded) {
+                const char* ellipsis = "...";
+                const auto color = mPalette[(int)PaletteIndex::LineNumber];
+                const float x = textScreenPos.x + width + spaceSize;
+                const float y = lineStartScreenPos.y + (lineRows - 1) * mCharAdvance.y;
+                const float ellipsisWidth = ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), FLT_MAX, -1.0f, ellipsis).x;
+                drawList->AddRect(ImVec2(x, y + 1.0f), ImVec2(x + ellipsisWidth + spaceSize, y + mCharAdvance.y - 1.0f), color);
+                drawList->AddText(ImVec2(x + spaceSize * 0.5f, y), color, ellipsis);
+
+                lineNo += 1 + (int)line.mFolded;
+                lineIt = mLines.iterator_at(lineNo);
+            } else {
+                ++lineNo;
+                ++lineIt;
+            }
+        }
+
+        if (mCompletion.mOpen)
+            RenderCompletion(drawList, ImVec2(cursorScreenPos.x + mTextStart, cursorScreenPos.y));
+
+        // Draw a tooltip on known identifiers/preprocessor symbols
+        if (ImGui::IsMousePosValid() && CompletionItemAt(ImGui::GetMousePos()) < 0) {
+            auto id = GetWordAt(ScreenPosToCoordinates(ImGui::GetMousePos()));
+            if (!id.empty()) {
+                auto it = mLanguage->mDefinition->mIdentifiers.find(id);
+                if (it != mLanguage->mDefinition->mIdentifiers.end()) {
+                    ImGui::BeginTooltip();
+                    ImGui::TextUnformatted(it->second.mDeclaration.c_str());
+                    ImGui::EndTooltip();
+                } else {
+                    auto pi = mLanguage->mDefinition->mPreprocIdentifiers.find(id);
+                    if (pi != mLanguage->mDefinition->mPreprocIdentifiers.end()) {
+                        ImGui::BeginTooltip();
+                        ImGui::TextUnformatted(pi->second.mDeclaration.c_str());
+                        ImGui::EndTooltip();
+                    }
+                }
+            }
+        }
+    }
+    if (ImGui::IsMouseReleased(ImGuiMouseButton_Right) && ImGui::IsItemHovered())
+        ImGui::OpenPopup("##context", ImGuiPopupFlags_MouseButtonRight);
+    ImGui::SetNextWindowBgAlpha(0.8f);
+    if (ImGui::BeginPopup("##context") || ImGui::BeginPopupContextItem()) {
+        constexpr auto command = [](const char* name, const char* shortcut, bool selected, int shortcut_key = 0) -> bool {
+            if (shortcut_key != 0 && ImGui::IsKeyPressed(static_cast<ImGuiKey>(shortcut_key), false) &&
+                ImGui::IsKeyPressed(ImGuiKey_LeftCtrl, false))
+                selected = true;
+            bool item = ImGui::MenuItem(name, shortcut, &selected, true);
+            return item;
+        };
+        auto selected = false;
+        if (ImGui::IsItemClicked(0))
+            ImGui::CloseCurrentPopup();
+        if (command("Copy", "Ctrl-C", selected, ImGuiKey_C)) {
+          Copy();
+            ImGui::CloseCurrentPopup();
+        } else if (command("Cut", "Ctrl-X", selected, ImGuiKey_X)) {
+            Cut();
+            ImGui::CloseCurrentPopup();
+        } else if (command("Paste", "Ctrl-V", selected, ImGuiKey_V)) {
+            Paste();
+            ImGui::CloseCurrentPopup();
+        } else if (command("Select All", "Ctrl-A", selected, ImGuiKey_A)) {
+            SelectAll();
+            ImGui::CloseCurrentPopup();
+        } 
+        ImGui::EndPopup();
+    }
+    ImGui::Dummy(ImVec2(mWordWrap ? 0.0f : (mTextStart + mMaxLineWidth + 2), mLines.rows() * mCharAdvance.y));
+
+    if (mScrollToCursor) {
+        EnsureCursorVisible();
+        ImGui::SetWindowFocus();
+        mScrollToCursor = false;
+    }
+}
+
+void TextEditor::Render(const char* aTitle, const ImVec2& aSize, bool aBorder) {
+    mWithinRender = true;
+    mTextChanged = false;
+    mCursorPositionChanged = false;
+
+    ImGui::PushStyleColor(ImGuiCol_ChildBg, ImGui::ColorConvertU32ToFloat4(mPalette[(int)PaletteIndex::Background]));
+    ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0.0f, 0.0f));
+    if (!mIgnoreImGuiChild)
+        ImGui::BeginChild(aTitle, aSize, aBorder,
+            ImGuiWindowFlags_HorizontalScrollbar | ImGuiWindowFlags_AlwaysHorizontalScrollbar | ImGuiWindowFlags_NoMove);
+
+    if (mHandleKeyboardInputs) {
+        HandleKeyboardInputs();
+        ImGui::PushAllowKeyboardFocus(true);
+    }
+
+    if (mHandleMouseInputs)
+        HandleMouseInputs();
+
+    ColorizeInternal();
+    Render();
+
+    if (mHandleKeyboardInputs)
+        ImGui::PopAllowKeyboardFocus();
+
+    if (!mIgnoreImGuiChild)
+        ImGui::EndChild();
+
+    ImGui::PopStyleVar();
+    ImGui::PopStyleColor();
+
+    mWithinRender = false;
+}
+
+void TextEditor::SetText(const std::string& aText) {
+    SetText(aText.data(), aText.size());
+}
+
+void TextEditor::SetText(const char* aText, size_t aLength) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::SetText, {}, aText, aLength);
+
+    // Bytes that aren't UTF-8 stay as they are, a column each; the scan only tells whether there are any
+    mTextUtf8 = TextScan::ValidUtf8Length(aText, aText + aLength) == aLength;
+
+    // Split at '\n' and drop every '\r'. Each line is allocated once at its exact size, straight from the text
+    // unless a lone '\r' has to be cut out of it.
+    const char* end = aText + aLength;
+    std::vector<Line> lines;
+    lines.reserve(TextScan::CountNewlines(aText, end) + 1);
+    std::string pending;
+    for (const char* p = aText;;) {
+        const char* lineBreak = TextScan::FindLineBreak(p, end);
+        if (lineBreak != end && *lineBreak == '\r' && (lineBreak + 1 == end || lineBreak[1] != '\n')) {
+            pending.append(p, lineBreak);
+            p = lineBreak + 1;
+            continue;
+        }
+
+        if (pending.empty()) {
+            lines.emplace_back(p, (size_t)(lineBreak - p));
+        } else {
+            pending.append(p, lineBreak);
+            lines.emplace_back(pending.data(), pending.size());
+            pending.clear();
+        }
+
+        if (lineBreak == end)
+            break;
+        p = lineBreak + (*lineBreak == '\r' ? 2 : 1);
+    }
+    mCompletions.ReleaseLines();
+    mCompletion.mOpen = false;
+    KeepMarkers(lines);
+    mLines.assign(std::move(lines));
+    mFoldCount = 0;
+    mState.mCursors.clear();
+    mColumnMode = false;
+
+    mTextChanged = true;
+    ResetTextChanges();
+    mScrollToTop = true;
+
+    mUndoBuffer.clear();
+    mUndoIndex = 0;
+    mUndoBytes = 0;
+    mUndoGroupOpen = false;
+    mMaxLineWidth = 0.0f;
+
+    Colorize();
+}
+
+// The markers stay on the same line numbers when the text is set
+void TextEditor::KeepMarkers(std::vector<Line>& aLines) const {
+    if (!mHasMarkers)
+        return;
+
+    auto lineIt = mLines.begin();
+    for (size_t i = 0; i < aLines.size() && lineIt != mLines.end(); ++i, ++lineIt) {
+        aLines[i].mBreakpoint = lineIt->mBreakpoint;
+        aLines[i].mError = lineIt->mError;
+    }
+}
+
+void TextEditor::SetErrorMarkers(const ErrorMarkers& aMarkers) {
+    mErrorMessages.clear();
+    if (mHasMarkers) {
+        for (auto& line : mLines)
+            line.mError = 0;
+    }
+
+    for (auto& marker : aMarkers) {
+        if (marker.first < 1 || marker.first > (int)mLines.size())
+            continue;
+        mErrorMessages.push_back(marker.second);
+        mLines[marker.first - 1].mError = (uint32_t)mErrorMessages.size();
+    }
+    mHasMarkers |= !mErrorMessages.empty();
+}
+
+void TextEditor::SetBreakpoints(const Breakpoints& aMarkers) {
+    if (mHasMarkers) {
+        for (auto& line : mLines)
+            line.mBreakpoint = false;
+    }
+
+    for (auto breakpoint : aMarkers) {
+        if (breakpoint >= 1 && breakpoint <= (int)mLines.size())
+            mLines[breakpoint - 1].mBreakpoint = true;
+    }
+    mHasMarkers |= !aMarkers.empty();
+}
+
+TextEditor::ErrorMarkers TextEditor::GetErrorMarkers() const {
+    ErrorMarkers markers;
+    if (mHasMarkers) {
+        int lineNo = 1;
+        for (auto lineIt = mLines.begin(); lineIt != mLines.end(); ++lineIt, ++lineNo) {
+            if (lineIt->mError != 0)
+                markers.emplace_hint(markers.end(), lineNo, mErrorMessages[lineIt->mError - 1]);
+        }
+    }
+    return markers;
+}
+
+TextEditor::Breakpoints TextEditor::GetBreakpoints() const {
+    Breakpoints breakpoints;
+    if (mHasMarkers) {
+        int lineNo = 1;
+        for (auto lineIt = mLines.begin(); lineIt != mLines.end(); ++lineIt, ++lineNo) {
+            if (lineIt->mBreakpoint)
+                breakpoints.insert(lineNo);
+        }
+    }
+    return breakpoints;
+}
+
+void TextEditor::SetTextLines(const std::vector<std::string>& aLines) {
+    TraceScope trace(this);
+    if (trace) {
+        std::string text;
+        for (size_t i = 0; i < aLines.size(); ++i) {
+            if (i > 0)
+                text += '\n';
+            text += aLines[i];
+        }
+        mTrace->Write(EditTrace::Op::SetText, {}, text.data(), text.size());
+    }
+
+    std::vector<Line> lines;
+    lines.reserve(max(aLines.size(), (size_t)1));
+    for (auto& line : aLines)
+        lines.emplace_back(line.data(), line.size());
+    if (lines.empty())
+        lines.emplace_back();
+    mCompletions.ReleaseLines();
+    mCompletion.mOpen = false;
+    KeepMarkers(lines);
+    mLines.assign(std::move(lines));
+    mFoldCount = 0;
+    mState.mCursors.clear();
+    mColumnMode = false;
+
+    mTextChanged = true;
+    ResetTextChanges();
+    mScrollToTop = true;
+
+    mUndoBuffer.clear();
+    mUndoIndex = 0;
+    mUndoBytes = 0;
+    mUndoGroupOpen = false;
+    mMaxLineWidth = 0.0f;
+
+    Colorize();
+}
+
+std::vector<TextEditor::Cursor> TextEditor::GetCursors(int& aMain) const {
+    std::vector<Cursor> cursors;
+    cursors.reserve(mState.mCursors.size() + 1);
+    cursors.insert(cursors.end(), mState.mCursors.begin(), mState.mCursors.end());
+    cursors.push_back(Cursor{mState.mSelectionStart, mState.mSelectionEnd, mState.mCursorPosition});
+    for (auto& cursor : cursors) {
+        cursor.mCursorPosition = SanitizeCoordinates(cursor.mCursorPosition);
+        cursor.mSelectionStart = SanitizeCoordinates(cursor.mSelectionStart);
+        cursor.mSelectionEnd = SanitizeCoordinates(cursor.mSelectionEnd);
+        if (cursor.mSelectionStart >= cursor.mSelectionEnd)
+            cursor.mSelectionStart = cursor.mSelectionEnd = cursor.mCursorPosition;
+    }
+
+    auto less = [](const Cursor& aLeft, const Cursor& aRight) {
+        if (aLeft.mSelectionStart != aRight.mSelectionStart)
+            return aLeft.mSelectionStart < aRight.mSelectionStart;
+        if (aLeft.mSelectionEnd != aRight.mSelectionEnd)
+            return aLeft.mSelectionEnd < aRight.mSelectionEnd;
+        return aLeft.mCursorPosition < aRight.mCursorPosition;
+    };
+    const Cursor main = cursors.back();
+    std::sort(cursors.begin(), cursors.end(), less);
+    aMain = (int)(std::lower_bound(cursors.begin(), cursors.end(), main, less) - cursors.begin());
+    return cursors;
+}
+
+void TextEditor::SetCursors(std::vector<Cursor>&& aCursors, int aMain) {
+    const Cursor main = aCursors[aMain];
+    mState.mSelectionStart = main.mSelectionStart;
+    mState.mSelectionEnd = main.mSelectionEnd;
+    mState.mCursorPosition = main.mCursorPosition;
+    mInteractiveStart = main.mSelectionStart;
+    mInteractiveEnd = main.mSelectionEnd;
+    aCursors.erase(aCursors.begin() + aMain);
+    mState.mCursors = std::move(aCursors);
+    mCursorPositionChanged = true;
+}
+
+// Orders the cursors and makes one of any that overlap, or meet where one of them selects nothing. The main cursor
+// stays the main one.
+void TextEditor::MergeCursors() {
+    if (mState.mCursors.empty())
+        return;
+
+    int main;
+    auto cursors = GetCursors(main);
+    size_t kept = 0;
+    for (size_t i = 1; i < cursors.size(); ++i) {
+        auto& last = cursors[kept];
+        const auto& next = cursors[i];
+        const bool empty = last.mSelectionStart == last.mSelectionEnd || next.mSelectionStart == next.mSelectionEnd;
+        if (next.mSelectionStart < last.mSelectionEnd || (next.mSelectionStart == last.mSelectionEnd && empty)) {
+            // The main cursor stays where it is, another one goes to the end if it was at its own
+            if ((int)i == main) {
+                last.mCursorPosition = next.mCursorPosition;
+                main = (int)kept;
+            } else if ((int)kept != main && next.mCursorPosition == next.mSelectionEnd) {
+                last.mCursorPosition = max(last.mSelectionEnd, next.mSelectionEnd);
+            }
+            last.mSelectionEnd = max(last.mSelectionEnd, next.mSelectionEnd);
+        } else {
+            cursors[++kept] = next;
+            if ((int)i == main)
+                main = (int)kept;
+        }
+    }
+    cursors.resize(kept + 1);
+    SetCursors(std::move(cursors), main);
+}
+
+// Does aMove, which moves the main cursor, at every cursor in turn, each one made the main cursor while it moves. The
+// main cursor goes last, so it is the one the view follows. Returns false while there is only the main cursor, or
+// when already called from here, for the caller to go on and move the main cursor.
+template <typename F> bool TextEditor::MoveCursors(F aMove) {
+    if (mState.mCursors.empty() || mCursorsBusy)
+        return false;
+
+    mCursorsBusy = true;
+    mColumnMode = false;
+    auto cursors = std::move(mState.mCursors);
+    mState.mCursors.clear();
+    const Cursor main{mState.mSelectionStart, mState.mSelectionEnd, mState.mCursorPosition};
+    const auto interactiveStart = mInteractiveStart;
+    const auto interactiveEnd = mInteractiveEnd;
+
+    for (auto& cursor : cursors) {
+        mState.mSelectionStart = cursor.mSelectionStart;
+        mState.mSelectionEnd = cursor.mSelectionEnd;
+        mState.mCursorPosition = cursor.mCursorPosition;
+        mInteractiveStart = cursor.mSelectionStart < cursor.mSelectionEnd ? cursor.mSelectionStart : cursor.mCursorPosition;
+        mInteractiveEnd = cursor.mSelectionStart < cursor.mSelectionEnd ? cursor.mSelectionEnd : cursor.mCursorPosition;
+        aMove();
+        cursor = Cursor{mState.mSelectionStart, mState.mSelectionEnd, mState.mCursorPosition};
+    }
+
+    mState.mSelectionStart = main.mSelectionStart;
+    mState.mSelectionEnd = main.mSelectionEnd;
+    mState.mCursorPosition = main.mCursorPosition;
+    mInteractiveStart = interactiveStart;
+    mInteractiveEnd = interactiveEnd;
+    aMove();
+
+    mState.mCursors = std::move(cursors);
+    MergeCursors();
+    mCursorsBusy = false;
+    return true;
+}
+
+// Makes every cursor's edit as one change to the text: one undo record with an edit per cursor, and one colorize from
+// the first edited line to the last. aEdits go in the order of GetCursors and don't overlap. Their places are taken as
+// byte offsets before anything changes and made from the first edit to the last, each one moved by the lines the
+// edits before it added or removed, and on the line where the one before it ended, by the bytes. The cursors end up
+// after their edit's text, or with aKeepCursors false only the main one does.
+void TextEditor::EditCursors(const std::vector<CursorEdit>& aEdits, int aMain, bool aKeepCursors) {
+    assert(!mReadOnly);
+    if (aEdits.empty())
+        return;
+
+    struct Place {
+        int mLine;
+        int mIndex;
+        bool operator<(const Place& o) const { return mLine != o.mLine ? mLine < o.mLine : mIndex < o.mIndex; }
+    };
+    std::vector<Place> places(aEdits.size() * 2);
+    for (size_t i = 0; i < aEdits.size(); ++i) {
+        auto& start = places[i * 2];
+        auto& end = places[i * 2 + 1];
+        start = Place{aEdits[i].mStart.mLine, GetCharacterIndex(aEdits[i].mStart)};
+        end = Place{aEdits[i].mEnd.mLine, GetCharacterIndex(aEdits[i].mEnd)};
+        if (i > 0 && start < places[i * 2 - 1])
+            start = places[i * 2 - 1];
+        if (end < start)
+            end = start;
+    }
+
+    UndoRecord u;
+    u.mBefore = mState;
+    std::vector<Cursor> cursors(aEdits.size());
+    Place oldEnd{-1, 0};
+    Place newEnd{-1, 0};
+    auto moved = [&](const Place& aPlace) {
+        if (aPlace.mLine == oldEnd.mLine)
+            return Place{newEnd.mLine, aPlace.mIndex - oldEnd.mIndex + newEnd.mIndex};
+        return Place{aPlace.mLine + newEnd.mLine - oldEnd.mLine, aPlace.mIndex};
+    };
+    for (size_t i = 0; i < aEdits.size(); ++i) {
+        const auto start = moved(places[i * 2]);
+        const auto end = moved(places[i * 2 + 1]);
+
+        UndoRecord edit;
+        edit.mRemovedStart = Coordinates(start.mLine, GetCharacterColumn(start.mLine, start.mIndex));
+        edit.mRemovedEnd = Coordinates(end.mLine, GetCharacterColumn(end.mLine, end.mIndex));
+        edit.mRemoved = GetText(edit.mRemovedStart, edit.mRemovedEnd);
+        DeleteRange(edit.mRemovedStart, edit.mRemovedEnd);
+        edit.mAdded = aEdits[i].mText;
+        edit.mAddedStart = edit.mAddedEnd = edit.mRemovedStart;
+        InsertTextAt(edit.mAddedEnd, edit.mAdded.c_str());
+
+        oldEnd = places[i * 2 + 1];
+        newEnd = Place{edit.mAddedEnd.mLine, GetCharacterIndex(edit.mAddedEnd)};
+        cursors[i].mSelectionStart = cursors[i].mSelectionEnd = cursors[i].mCursorPosition = edit.mAddedEnd;
+        if (!edit.mRemoved.empty() || !edit.mAdded.empty())
+            u.mBatch.push_back(std::move(edit));
+    }
+    if (u.mBatch.empty())
+        return;
+
+    mTextChanged = true;
+    if (!aKeepCursors) {
+        cursors = {cursors[aMain]};
+        aMain = 0;
+    }
+    SetCursors(std::move(cursors), aMain);
+    MergeCursors();
+
+    const int first = u.mBatch.front().mAddedStart.mLine;
+    Colorize(first - 1, u.mBatch.back().mAddedEnd.mLine - first + 3);
+
+    u.mAfter = mState;
+    AddUndo(u);
+    EnsureCursorVisible();
+}
+
+void TextEditor::AddCursor(const Coordinates& aPosition) {
+    AddCursor(aPosition, aPosition);
+}
+
+void TextEditor::AddCursor(const Coordinates& aSelectionStart, const Coordinates& aSelectionEnd) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::AddCursor, {aSelectionStart.mLine, aSelectionStart.mColumn, aSelectionEnd.mLine, aSelectionEnd.mColumn,
+            aSelectionEnd.mLine, aSelectionEnd.mColumn});
+
+    mState.mCursors.push_back(Cursor{min(aSelectionStart, aSelectionEnd), max(aSelectionStart, aSelectionEnd), aSelectionEnd});
+    mColumnMode = false;
+    MergeCursors();
+}
+
+bool TextEditor::RemoveCursor(const Coordinates& aPosition) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::RemoveCursor, {aPosition.mLine, aPosition.mColumn});
+
+    const auto at = SanitizeCoordinates(aPosition);
+    for (auto it = mState.mCursors.begin(); it != mState.mCursors.end(); ++it) {
+        if (it->mCursorPosition == at) {
+            mState.mCursors.erase(it);
+            mColumnMode = false;
+            mCursorPositionChanged = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Selects the next match of the main cursor's selection after the last cursor with another cursor, going on from the
+// top past the end of the text and over the matches that are selected already. With nothing selected, the first call
+// selects the word at the cursor.
+bool TextEditor::AddCursorAtNextMatch() {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::AddCursorAtNextMatch);
+
+    if (mState.mCursors.empty() && !HasSelection()) {
+        SelectWordUnderCursor();
+        SetCursorPosition(mState.mSelectionEnd);
+        return HasSelection();
+    }
+
+    int main;
+    const auto cursors = GetCursors(main);
+    const auto pattern = GetText(cursors[main].mSelectionStart, cursors[main].mSelectionEnd);
+    TextSearch search;
+    if (pattern.find('\n') != std::string::npos || !search.Compile(pattern, TextSearch::Options()))
+        return false;
+
+    const int lineCount = (int)mLines.size();
+    int lineNo = cursors.back().mSelectionEnd.mLine;
+    int from = GetCharacterIndex(cursors.back().mSelectionEnd);
+    for (int i = 0; i <= lineCount; ++i, from = 0, lineNo = (lineNo + 1) % lineCount) {
+        const auto& line = mLines[lineNo];
+        const char* begin = line.data();
+        const char* end = begin + line.size();
+        const char* start;
+        const char* stop;
+        for (const char* at = begin + from; search.Find(begin, end, at, start, stop); at = stop) {
+            const Coordinates matchStart(lineNo, GetCharacterColumn(lineNo, (int)(start - begin)));
+            const Coordinates matchEnd(lineNo, GetCharacterColumn(lineNo, (int)(stop - begin)));
+            auto cursor = std::partition_point(
+                cursors.begin(), cursors.end(), [&](const Cursor& aCursor) { return aCursor.mSelectionEnd < matchEnd; });
+            if (cursor != cursors.end() && cursor->mSelectionStart == matchStart && cursor->mSelectionEnd == matchEnd)
+                continue;
+
+            mState.mCursors.push_back(Cursor{matchStart, matchEnd, matchEnd});
+            mColumnMode = false;
+            MergeCursors();
+            return true;
+        }
+    }
+    return false;
+}
+
+// A cursor on every line from aStart's to aEnd's, selecting from aStart's column to aEnd's as far as the line goes
+void TextEditor::SetColumnSelection(const Coordinates& aStart, const Coordinates& aEnd) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::SetColumnSelection, {aStart.mLine, aStart.mColumn, aEnd.mLine, aEnd.mColumn});
+
+    const int last = (int)mLines.size() - 1;
+    const int endLine = min(aEnd.mLine, last);
+    std::vector<Cursor> cursors;
+    int main = 0;
+    for (int lineNo = min(aStart.mLine, endLine); lineNo <= max(min(aStart.mLine, last), endLine); ++lineNo) {
+        if (mLines.IsHidden(lineNo))
+            continue;
+        const int maxColumn = GetLineMaxColumn(lineNo);
+        const Coordinates from(lineNo, min(aStart.mColumn, maxColumn));
+        const Coordinates to(lineNo, min(aEnd.mColumn, maxColumn));
+        if (lineNo == endLine)
+            main = (int)cursors.size();
+        cursors.push_back(Cursor{min(from, to), max(from, to), to});
+    }
+    if (cursors.empty())
+        return;
+
+    SetCursors(std::move(cursors), main);
+    mInteractiveStart = aStart;
+    mInteractiveEnd = aEnd;
+    mColumnMode = true;
+    EnsureCursorVisible();
+}
+
+void TextEditor::ClearCursors() {
+    mColumnMode = false;
+    if (mState.mCursors.empty())
+        return;
+
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::ClearCursors);
+
+    mState.mCursors.clear();
+    mCursorPositionChanged = true;
+}
+
+// A cursor at the main cursor's column on the row above the first cursor, or below the last one
+void TextEditor::AddCursorOnRow(int aDelta) {
+    int main;
+    const auto cursors = GetCursors(main);
+    const int line = (aDelta < 0 ? cursors.front() : cursors.back()).mCursorPosition.mLine;
+    const int row = (int)mLines.GetFirstRow(line) + (aDelta < 0 ? -1 : mLines.GetRows(line));
+    if (row < 0 || row >= (int)mLines.rows())
+        return;
+
+    int rowInLine;
+    const int lineNo = (int)mLines.FindRow((size_t)row, rowInLine);
+    AddCursor(SanitizeCoordinates(Coordinates(lineNo, cursors[main].mCursorPosition.mColumn)));
+}
+
+// Like ScreenPosToCoordinates, but right of the end of a line the columns go on, for a corner of a column selection
+TextEditor::Coordinates TextEditor::ScreenPosToColumn(const ImVec2& aPosition) const {
+    auto at = ScreenPosToCoordinates(aPosition);
+    if (at.mLine < (int)mLines.size() && at.mColumn == GetLineMaxColumn(at.mLine)) {
+        int row;
+        const float past = aPosition.x - ImGui::GetCursorScreenPos().x - mTextStart - TextDistanceToRowStart(at, row);
+        if (past > 0.0f)
+            at.mColumn += (int)(past / mCharAdvance.x + 0.5f);
+    }
+    return at;
+}
+
+void TextEditor::EnterCharacter(ImWchar aChar, bool aShift) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::EnterCharacter, {(int)aChar, aShift});
+
+    assert(!mReadOnly);
+
+    if (!mState.mCursors.empty()) {
+        char buf[7];
+        int e = ImTextCharToUtf8(buf, 7, aChar);
+        if (e <= 0)
+            return;
+        buf[e] = '\0';
+
+        int main;
+        const auto cursors = GetCursors(main);
+        std::vector<CursorEdit> edits;
+        edits.reserve(cursors.size());
+        for (const auto& cursor : cursors) {
+            CursorEdit edit{cursor.mSelectionStart, cursor.mSelectionEnd, buf};
+            const auto& line = mLines[edit.mStart.mLine];
+            if (aChar == '\n' && mLanguage->mDefinition->mAutoIndentation) {
+                for (size_t it = 0; it < line.size() && isascii((Char)line[it]) && isblank((Char)line[it]); ++it)
+                    edit.mText += line[it];
+            } else if (aChar != '\n' && mOverwrite && edit.mStart == edit.mEnd) {
+                const int cindex = GetCharacterIndex(edit.mStart);
+                if (cindex < (int)line.size())
+                    edit.mEnd = Coordinates(edit.mStart.mLine,
+                        GetCharacterColumn(edit.mStart.mLine, min(cindex + UTF8CharLength(line, cindex), (int)line.size())));
+            }
+            edits.push_back(std::move(edit));
+        }
+        EditCursors(edits, main);
+        return;
+    }
+
+    UndoRecord u;
+
+    u.mBefore = mState;
+
+    if (HasSelection()) {
+        if (aChar == '\t' && mState.mSelectionStart.mLine != mState.mSelectionEnd.mLine) {
+            auto start = mState.mSelectionStart;
+            auto end = mState.mSelectionEnd;
+            auto originalEnd = end;
+
+            if (start > end)
+                std::swap(start, end);
+            // A selection that ends at the start of a line leaves that line be
+            if (end.mColumn == 0 && end.mLine > 0)
+                --end.mLine;
+            if (end.mLine >= (int)mLines.size())
+                end.mLine = (int)mLines.size() - 1;
+
+            // A tab in front of every line, or with Shift a tab or up to mTabSize spaces out, as one line prefix edit
+            // per line
+            u.mPrefixLine = start.mLine;
+            u.mPrefixes.reserve(end.mLine - start.mLine + 1);
+            bool modified = false;
+            auto lineIt = mLines.iterator_at(start.mLine);
+            for (int i = start.mLine; i <= end.mLine; ++i, ++lineIt) {
+                const auto& line = *lineIt;
+                LinePrefix prefix{0, 0, 0};
+                if (aShift) {
+                    if (!line.empty() && line.front() == '\t')
+                        prefix.mRemoved = 1;
+                    else
+                        while (prefix.mRemoved < mTabSize && prefix.mRemoved < line.size() && line[prefix.mRemoved] == ' ')
+                            ++prefix.mRemoved;
+                    u.mPrefixText.append(line.data(), prefix.mRemoved);
+                } else {
+                    prefix.mAdded = 1;
+                    u.mPrefixText += '\t';
+                }
+                modified |= prefix.mRemoved != 0 || prefix.mAdded != 0;
+                u.mPrefixes.push_back(prefix);
+            }
+
+            if (modified) {
+                MakeLinePrefixes(u);
+                mState.mSelectionStart = Coordinates(start.mLine, 0);
+                if (originalEnd.mColumn != 0)
+                    mState.mSelectionEnd = Coordinates(end.mLine, GetLineMaxColumn(end.mLine));
+                else
+                    mState.mSelectionEnd = Coordinates(originalEnd.mLine, 0);
+                u.mAfter = mState;
+                AddUndo(u);
+
+                EnsureCursorVisible();
+            }
+
+            return;
+        } // c == '\t'
+        else {
+            u.mRemoved = GetSelectedText();
+            u.mRemovedStart = mState.mSelectionStart;
+            u.mRemovedEnd = mState.mSelectionEnd;
+            DeleteSelection();
+        }
+    } // HasSelection
+
+    auto coord = GetActualCursorCoordinates();
+    u.mAddedStart = coord;
+
+    assert(!mLines.empty());
+
+    if (aChar == '\n') {
+        InsertLine(coord.mLine + 1);
+        auto& line = mLines[coord.mLine];
+        auto& newLine = mLines[coord.mLine + 1];
+
+        if (mLanguage->mDefinition->mAutoIndentation) {
+            size_t it = 0;
+            while (it < line.size() && isascii((Char)line[it]) && isblank((Char)line[it]))
+                ++it;
+            newLine.AppendText(line, 0, it);
+        }
+
+        const size_t whitespaceSize = newLine.size();
+        auto cindex = GetCharacterIndex(coord);
+        newLine.AppendText(line, cindex, line.size());
+        line.EraseText(cindex, line.size());
+        SetCursorPosition(Coordinates(coord.mLine + 1, GetCharacterColumn(coord.mLine + 1, (int)whitespaceSize)));
+        u.mAdded = (char)aChar;
+    } else {
+        char buf[7];
+        int e = ImTextCharToUtf8(buf, 7, aChar);
+        if (e > 0) {
+            buf[e] = '\0';
+            auto& line = mLines[coord.mLine];
+            auto cindex = GetCharacterIndex(coord);
+            // The cursor can be in the middle of a tab
+            u.mAddedStart = Coordinates(coord.mLine, GetCharacterColumn(coord.mLine, cindex));
+
+            // A character typed over a selection only replaces the selection
+            if (mOverwrite && u.mRemoved.empty() && cindex < (int)line.size()) {
+                auto d = UTF8CharLength(line, cindex);
+
+                u.mRemovedStart = u.mAddedStart;
+                u.mRemovedEnd = Coordinates(coord.mLine, GetCharacterColumn(coord.mLine, cindex + d));
+
+                while (d-- > 0 && cindex < (int)line.size()) {
+                    u.mRemoved += line[cindex];
+                    line.EraseText(cindex, cindex + 1);
+                }
+            }
+
+            line.InsertText(cindex, buf, e);
+            cindex += e;
+            u.mAdded = buf;
+            if (u.mRemoved.empty())
+                u.mGroup = UndoRecord::Group::Typing;
+
+            SetCursorPosition(Coordinates(coord.mLine, GetCharacterColumn(coord.mLine, cindex)));
+        } else
+            return;
+    }
+
+    mTextChanged = true;
+
+    u.mAddedEnd = GetActualCursorCoordinates();
+    u.mAfter = mState;
+
+    AddUndo(u);
+
+    Colorize(coord.mLine - 1, 3);
+    EnsureCursorVisible();
+}
+
+void TextEditor::SetReadOnly(bool aValue) {
+    mReadOnly = aValue;
+}
+
+void TextEditor::SetColorizerEnable(bool aValue) {
+    mColorizerEnabled = aValue;
+}
+
+void TextEditor::SetBackgroundColorizer(bool aValue) {
+    if (!aValue)
+        CancelColorizeJob();
+    mBackgroundColorizer = aValue;
+}
+
+void TextEditor::SetCursorPosition(const Coordinates& aPosition) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::SetCursorPosition, {aPosition.mLine, aPosition.mColumn});
+
+    if (mState.mCursorPosition != aPosition) {
+        mState.mCursorPosition = aPosition;
+        mCursorPositionChanged = true;
+        EnsureCursorVisible();
+    }
+}
+
+void TextEditor::SetSelectionStart(const Coordinates& aPosition) {
+    mState.mSelectionStart = SanitizeCoordinates(aPosition);
+    if (mState.mSelectionStart > mState.mSelectionEnd)
+        std::swap(mState.mSelectionStart, mState.mSelectionEnd);
+}
+
+void TextEditor::SetSelectionEnd(const Coordinates& aPosition) {
+    mState.mSelectionEnd = SanitizeCoordinates(aPosition);
+    if (mState.mSelectionStart > mState.mSelectionEnd)
+        std::swap(mState.mSelectionStart, mState.mSelectionEnd);
+}
+
+void TextEditor::SetSelection(const Coordinates& aStart, const Coordinates& aEnd, SelectionMode aMode) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::SetSelection, {aStart.mLine, aStart.mColumn, aEnd.mLine, aEnd.mColumn, (int)aMode, mState.mCursorPosition.mLine, mState.mCursorPosition.mColumn,
+            mInteractiveStart.mLine, mInteractiveStart.mColumn, mInteractiveEnd.mLine, mInteractiveEnd.mColumn});
+
+    auto oldSelStart = mState.mSelectionStart;
+    auto oldSelEnd = mState.mSelectionEnd;
+
+    mState.mSelectionStart = SanitizeCoordinates(aStart);
+    mState.mSelectionEnd = SanitizeCoordinates(aEnd);
+    if (mState.mSelectionStart > mState.mSelectionEnd)
+        std::swap(mState.mSelectionStart, mState.mSelectionEnd);
+
+    switch (aMode) {
+    case TextEditor::SelectionMode::Normal:
+        break;
+    case TextEditor::SelectionMode::Word: {
+        mState.mSelectionStart = FindWordStart(mState.mSelectionStart);
+        if (!IsOnWordBoundary(mState.mSelectionEnd))
+            mState.mSelectionEnd = FindWordEnd(FindWordStart(mState.mSelectionEnd));
+        break;
+    }
+    case TextEditor::SelectionMode::Line: {
+        const auto lineNo = mState.mSelectionEnd.mLine;
+        const auto lineSize = (size_t)lineNo < mLines.size() ? mLines[lineNo].size() : 0;
+        mState.mSelectionStart = Coordinates(mState.mSelectionStart.mLine, 0);
+        mState.mSelectionEnd = Coordinates(lineNo, GetLineMaxColumn(lineNo));
+        break;
+    }
+    default:
+        break;
+    }
+
+    if (mState.mSelectionStart != oldSelStart || mState.mSelectionEnd != oldSelEnd)
+        mCursorPositionChanged = true;
+}
+
+void TextEditor::SetTabSize(int aValue) {
+    mTabSize = max(0, min(32, aValue));
+}
+
+void TextEditor::SetWordWrap(bool aValue) {
+    if (mWordWrap == aValue)
+        return;
+
+    // The lines are wrapped as they are drawn, and take one row each again without
+    mWordWrap = aValue;
+    if (!mWordWrap)
+        mLines.ResetRows();
+    EnsureCursorVisible();
+}
+
+void TextEditor::InsertText(const std::string& aValue) {
+    InsertText(aValue.c_str());
+}
+
+void TextEditor::InsertText(const char* aValue) {
+    if (aValue == nullptr)
+        return;
+
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::InsertText, {}, aValue, strlen(aValue));
+
+    ClearCursors();
+
+    if (*aValue == '\0')
+        return;
+
+    UndoRecord u;
+    u.mBefore = mState;
+    u.mAdded = aValue;
+    u.mAddedStart = GetActualCursorCoordinates();
+
+    // Not RecordTextChange, AddUndo journals this change
+    auto pos = u.mAddedStart;
+    auto start = min(pos, mState.mSelectionStart);
+    int totalLines = pos.mLine - start.mLine;
+    totalLines += InsertTextAt(pos, aValue);
+
+    SetSelection(pos, pos);
+    SetCursorPosition(pos);
+    Colorize(start.mLine - 1, totalLines + 2);
+
+    u.mAddedEnd = pos;
+    u.mAfter = mState;
+    AddUndo(u);
+}
+
+void TextEditor::DeleteSelection() {
+    assert(mState.mSelectionEnd >= mState.mSelectionStart);
+
+    if (mState.mSelectionEnd == mState.mSelectionStart)
+        return;
+
+    DeleteRange(mState.mSelectionStart, mState.mSelectionEnd);
+
+    SetSelection(mState.mSelectionStart, mState.mSelectionStart);
+    SetCursorPosition(mState.mSelectionStart);
+    Colorize(mState.mSelectionStart.mLine, 1);
+}
+
+void TextEditor::MoveUp(int aAmount, bool aSelect) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::MoveUp, {aAmount, aSelect});
+
+    if (MoveCursors([&] { MoveUp(aAmount, aSelect); }))
+        return;
+
+    auto oldPos = mState.mCursorPosition;
+    // The rows are looked up from a line that exists, the cursor may be past the end of the text
+    const auto pos = GetActualCursorCoordinates();
+    if (mWordWrap) {
+        // By rows, to the character under the cursor
+        int rowInLine;
+        const float x = TextDistanceToRowStart(pos, rowInLine);
+        const int row = max(0, (int)mLines.GetFirstRow(pos.mLine) + rowInLine - aAmount);
+        const int line = (int)mLines.FindRow((size_t)row, rowInLine);
+        mState.mCursorPosition = RowPosToCoordinates(line, rowInLine, x);
+    } else {
+        // By rows too, which steps over folded blocks
+        int rowInLine;
+        const int row = max(0, (int)mLines.GetFirstRow(pos.mLine) - aAmount);
+        mState.mCursorPosition.mLine = (int)mLines.FindRow((size_t)row, rowInLine);
+    }
+    if (oldPos != mState.mCursorPosition) {
+        if (aSelect) {
+            if (oldPos == mInteractiveStart)
+                mInteractiveStart = mState.mCursorPosition;
+            else if (oldPos == mInteractiveEnd)
+                mInteractiveEnd = mState.mCursorPosition;
+            else {
+                mInteractiveStart = mState.mCursorPosition;
+                mInteractiveEnd = oldPos;
+            }
+        } else
+            mInteractiveStart = mInteractiveEnd = mState.mCursorPosition;
+        SetSelection(mInteractiveStart, mInteractiveEnd);
+
+        EnsureCursorVisible();
+    }
+}
+
+void TextEditor::MoveDown(int aAmount, bool aSelect) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::MoveDown, {aAmount, aSelect});
+
+    if (MoveCursors([&] { MoveDown(aAmount, aSelect); }))
+        return;
+
+    assert(mState.mCursorPosition.mColumn >= 0);
+    auto oldPos = mState.mCursorPosition;
+    const auto pos = GetActualCursorCoordinates();
+    if (mWordWrap) {
+        int rowInLine;
+        const float x = TextDistanceToRowStart(pos, rowInLine);
+        const int row = max(0, min((int)mLines.rows() - 1, (int)mLines.GetFirstRow(pos.mLine) + rowInLine + aAmount));
+        const int line = (int)mLines.FindRow((size_t)row, rowInLine);
+        mState.mCursorPosition = RowPosToCoordinates(line, rowInLine, x);
+    } else {
+        int rowInLine;
+        const int row = min((int)mLines.rows() - 1, (int)mLines.GetFirstRow(pos.mLine) + aAmount);
+        mState.mCursorPosition.mLine = (int)mLines.FindRow((size_t)max(0, row), rowInLine);
+    }
+
+    if (mState.mCursorPosition != oldPos) {
+        if (aSelect) {
+            if (oldPos == mInteractiveEnd)
+                mInteractiveEnd = mState.mCursorPosition;
+            else if (oldPos == mInteractiveStart)
+                mInteractiveStart = mState.mCursorPosition;
+            else {
+                mInteractiveStart = oldPos;
+                mInteractiveEnd = mState.mCursorPosition;
+            }
+        } else
+            mInteractiveStart = mInteractiveEnd = mState.mCursorPosition;
+        SetSelection(mInteractiveStart, mInteractiveEnd);
+
+        EnsureCursorVisible();
+    }
+}
+
+void TextEditor::MoveLeft(int aAmount, bool aSelect, bool aWordMode) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::MoveLeft, {aAmount, aSelect, aWordMode});
+
+    if (MoveCursors([&] { MoveLeft(aAmount, aSelect, aWordMode); }))
+        return;
+
+    if (mLines.empty())
+        return;
+
+    auto oldPos = mState.mCursorPosition;
+    mState.mCursorPosition = GetActualCursorCoordinates();
+    auto line = mState.mCursorPosition.mLine;
+    auto cindex = GetCharacterIndex(mState.mCursorPosition);
+
+    while (aAmount-- > 0) {
+        if (cindex == 0) {
+            if (line > 0) {
+                line = GetVisibleLine(line - 1);
+                if ((int)mLines.size() > line)
+                    cindex = (int)mLines[line].size();
+                else
+                    cindex = 0;
+            }
+        } else {
+            if ((int)mLines.size() > line)
+                cindex = UTF8CharStart(mLines[line], cindex);
+            else
+                --cindex;
+        }
+
+        mState.mCursorPosition = Coordinates(line, GetCharacterColumn(line, cindex));
+        if (aWordMode) {
+            mState.mCursorPosition = FindWordStart(mState.mCursorPosition);
+            cindex = GetCharacterIndex(mState.mCursorPosition);
+        }
+    }
+
+    mState.mCursorPosition = Coordinates(line, GetCharacterColumn(line, cindex));
+
+    assert(mState.mCursorPosition.mColumn >= 0);
+    if (aSelect) {
+        if (oldPos == mInteractiveStart)
+            mInteractiveStart = mState.mCursorPosition;
+        else if (oldPos == mInteractiveEnd)
+            mInteractiveEnd = mState.mCursorPosition;
+        else {
+            mInteractiveStart = mState.mCursorPosition;
+            mInteractiveEnd = oldPos;
+        }
+    } else
+        mInteractiveStart = mInteractiveEnd = mState.mCursorPosition;
+    SetSelection(mInteractiveStart, mInteractiveEnd, aSelect && aWordMode ? SelectionMode::Word : SelectionMode::Normal);
+
+    EnsureCursorVisible();
+}
+
+void TextEditor::MoveRight(int aAmount, bool aSelect, bool aWordMode) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::MoveRight, {aAmount, aSelect, aWordMode});
+
+    if (MoveCursors([&] { MoveRight(aAmount, aSelect, aWordMode); }))
+        return;
+
+    auto oldPos = mState.mCursorPosition;
+
+    if (mLines.empty() || oldPos.mLine >= mLines.size())
+        return;
+
+    auto cindex = GetCharacterIndex(mState.mCursorPosition);
+    while (aAmount-- > 0) {
+        auto lindex = mState.mCursorPosition.mLine;
+        auto& line = mLines[lindex];
+
+        if (cindex >= line.size()) {
+            if (mState.mCursorPosition.mLine < mLines.size() - 1) {
+                // Past the lines folded under this one
+                mState.mCursorPosition.mLine = max(0, min((int)mLines.size() - 1, mState.mCursorPosition.mLine + 1 + (int)line.mFolded));
+                mState.mCursorPosition.mColumn = 0;
+            } else
+                return;
+        } else {
+            cindex += UTF8CharLength(line, cindex);
+            mState.mCursorPosition = Coordinates(lindex, GetCharacterColumn(lindex, cindex));
+            if (aWordMode) {
+                mState.mCursorPosition = FindNextWord(mState.mCursorPosition);
+
+                // The next word may be folded away, then the line after the fold starts it
+                const int visible = GetVisibleLine(mState.mCursorPosition.mLine);
+                if (visible != mState.mCursorPosition.mLine)
+                    mState.mCursorPosition = Coordinates(visible + 1 + (int)mLines[visible].mFolded, 0);
+            }
+        }
+    }
+
+    if (aSelect) {
+        if (oldPos == mInteractiveEnd)
+            mInteractiveEnd = SanitizeCoordinates(mState.mCursorPosition);
+        else if (oldPos == mInteractiveStart)
+            mInteractiveStart = mState.mCursorPosition;
+        else {
+            mInteractiveStart = oldPos;
+            mInteractiveEnd = mState.mCursorPosition;
+        }
+    } else
+        mInteractiveStart = mInteractiveEnd = mState.mCursorPosition;
+    SetSelection(mInteractiveStart, mInteractiveEnd, aSelect && aWordMode ? SelectionMode::Word : SelectionMode::Normal);
+
+    EnsureCursorVisible();
+}
+
+void TextEditor::MoveTop(bool aSelect) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::MoveTop, {aSelect});
+
+    if (MoveCursors([&] { MoveTop(aSelect); }))
+        return;
+
+    auto oldPos = mState.mCursorPosition;
+    SetCursorPosition(Coordinates(0, 0));
+
+    if (mState.mCursorPosition != oldPos) {
+        if (aSelect) {
+            mInteractiveEnd = oldPos;
+            mInteractiveStart = mState.mCursorPosition;
+        } else
+            mInteractiveStart = mInteractiveEnd = mState.mCursorPosition;
+        SetSelection(mInteractiveStart, mInteractiveEnd);
+    }
+}
+
+void TextEditor::TextEditor::MoveBottom(bool aSelect) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::MoveBottom, {aSelect});
+
+    if (MoveCursors([&] { MoveBottom(aSelect); }))
+        return;
+
+    auto oldPos = GetCursorPosition();
+    auto newPos = Coordinates((int)mLines.size() - 1, 0);
+    SetCursorPosition(newPos);
+    if (aSelect) {
+        mInteractiveStart = oldPos;
+        mInteractiveEnd = newPos;
+    } else
+        mInteractiveStart = mInteractiveEnd = newPos;
+    SetSelection(mInteractiveStart, mInteractiveEnd);
+}
+
+void TextEditor::MoveHome(bool aSelect) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::MoveHome, {aSelect});
+
+    if (MoveCursors([&] { MoveHome(aSelect); }))
+        return;
+
+    auto oldPos = mState.mCursorPosition;
+    SetCursorPosition(Coordinates(mState.mCursorPosition.mLine, 0));
+
+    if (mState.mCursorPosition != oldPos) {
+        if (aSelect) {
+            if (oldPos == mInteractiveStart)
+                mInteractiveStart = mState.mCursorPosition;
+            else if (oldPos == mInteractiveEnd)
+                mInteractiveEnd = mState.mCursorPosition;
+            else {
+                mInteractiveStart = mState.mCursorPosition;
+                mInteractiveEnd = oldPos;
+            }
+        } else
+            mInteractiveStart = mInteractiveEnd = mState.mCursorPosition;
+        SetSelection(mInteractiveStart, mInteractiveEnd);
+    }
+}
+
+void TextEditor::MoveEnd(bool aSelect) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::MoveEnd, {aSelect});
+
+    if (MoveCursors([&] { MoveEnd(aSelect); }))
+        return;
+
+    auto oldPos = mState.mCursorPosition;
+    SetCursorPosition(Coordinates(mState.mCursorPosition.mLine, GetLineMaxColumn(oldPos.mLine)));
+
+    if (mState.mCursorPosition != oldPos) {
+        if (aSelect) {
+            if (oldPos == mInteractiveEnd)
+                mInteractiveEnd = mState.mCursorPosition;
+            else if (oldPos == mInteractiveStart)
+                mInteractiveStart = mState.mCursorPosition;
+            else {
+                mInteractiveStart = oldPos;
+                mInteractiveEnd = mState.mCursorPosition;
+            }
+        } else
+            mInteractiveStart = mInteractiveEnd = mState.mCursorPosition;
+        SetSelection(mInteractiveStart, mInteractiveEnd);
+    }
+}
+
+// Makes aEdit's line prefix edits, or with aUndo takes them back, touching each line once. Each line's change goes to
+// the journal, and the lines are colorized together after.
+void TextEditor::EditLinePrefixes(const UndoRecord& aEdit, bool aUndo) {
+    auto lineIt = mLines.iterator_at(aEdit.mPrefixLine);
+    const char* text = aEdit.mPrefixText.data();
+    for (size_t i = 0; i < aEdit.mPrefixes.size(); ++i, ++lineIt) {
+        const auto& prefix = aEdit.mPrefixes[i];
+        std::string removed(text, prefix.mRemoved);
+        std::string added(text + prefix.mRemoved, prefix.mAdded);
+        text += prefix.mRemoved + prefix.mAdded;
+        if (aUndo)
+            std::swap(removed, added);
+        if (removed.empty() && added.empty())
+            continue;
+
+        auto& line = *lineIt;
+        if (!removed.empty())
+            line.EraseText(prefix.mIndex, prefix.mIndex + removed.size());
+        if (!added.empty())
+            line.InsertText(prefix.mIndex, added.data(), added.size());
+        RecordTextChange(aEdit.mPrefixLine + (int)i, (int)prefix.mIndex, removed, added);
+    }
+
+    mTextChanged = true;
+    Colorize(aEdit.mPrefixLine, (int)aEdit.mPrefixes.size());
+}
+
+// EditLinePrefixes for a new edit, which keeps the cursor and the selection on the same characters
+void TextEditor::MakeLinePrefixes(const UndoRecord& aEdit) {
+    Coordinates* ends[] = {&mState.mCursorPosition, &mState.mSelectionStart, &mState.mSelectionEnd};
+    int indexes[3];
+    for (int i = 0; i < 3; ++i) {
+        *ends[i] = SanitizeCoordinates(*ends[i]);
+        indexes[i] = GetCharacterIndex(*ends[i]);
+    }
+
+    EditLinePrefixes(aEdit, false);
+
+    for (int i = 0; i < 3; ++i) {
+        const int lineNo = ends[i]->mLine;
+        const int n = lineNo - aEdit.mPrefixLine;
+        if (n < 0 || n >= (int)aEdit.mPrefixes.size())
+            continue;
+
+        // What comes in where the cursor is goes before it
+        const auto& prefix = aEdit.mPrefixes[n];
+        const int at = (int)prefix.mIndex;
+        if (indexes[i] > at || (indexes[i] == at && prefix.mRemoved == 0))
+            *ends[i] = Coordinates(lineNo, GetCharacterColumn(lineNo, max(at, indexes[i] - prefix.mRemoved) + prefix.mAdded));
+    }
+}
+
+void TextEditor::ToggleComment(bool shift) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::ToggleComment, {shift});
+
+    ClearCursors();
+
+    // Determine start and end lines
+    size_t start_line = (size_t)mState.mCursorPosition.mLine;
+    size_t end_line = start_line;
+
+    if (mState.mSelectionStart.mLine != mState.mSelectionEnd.mLine) {
+        start_line = (size_t)min(mState.mSelectionStart.mLine, mState.mSelectionEnd.mLine);
+        end_line = (size_t)max(mState.mSelectionStart.mLine, mState.mSelectionEnd.mLine);
+    }
+
+    // Nothing to do for a single empty line
+    if (start_line < mLines.size() && mLines[start_line].empty() && end_line == start_line)
+        return;
+
+    UndoRecord u;
+    u.mBefore = mState;
+
+    // Find first non-whitespace char index in the first line
+    size_t first_non_ws = 0;
+    if (start_line < mLines.size()) {
+        const auto& firstLine = mLines[start_line];
+        while (first_non_ws < firstLine.size() && std::isspace(static_cast<unsigned char>(firstLine[first_non_ws])))
+            ++first_non_ws;
+    }
+
+    if (shift) {
+        // Block comment toggle
+        if (!HasSelection()) {
+            // Insert /* */ at cursor
+            auto coord = GetActualCursorCoordinates();
+            Coordinates insertPos = coord;
+            const char* block = "/* */";
+            InsertTextAt(insertPos, block);
+            // Place cursor between the comment markers (after "/*")
+            SetCursorPosition(Coordinates(coord.mLine, coord.mColumn + 2));
+
+            u.mAdded = block;
+            u.mAddedStart = coord;
+            u.mAddedEnd = insertPos;
+            u.mAfter = mState;
+            AddUndo(u);
+            return;
+        } else {
+            // Wrap or unwrap selection
+            auto selStart = SanitizeCoordinates(mState.mSelectionStart);
+            auto selEnd = SanitizeCoordinates(mState.mSelectionEnd);
+            if (selStart > selEnd)
+                std::swap(selStart, selEnd);
+
+            std::string selText = GetText(selStart, selEnd);
+            u.mRemoved = selText;
+            u.mRemovedStart = selStart;
+            u.mRemovedEnd = selEnd;
+
+            bool isWrapped = selText.size() >= 4 && selText.substr(0, 2) == "/*" && selText.substr(selText.size() - 2) == "*/";
+
+            if (isWrapped) {
+                // Unwrap: remove /* and */ from selection
+                std::string newText = selText.substr(2, selText.size() - 4);
+                DeleteRange(selStart, selEnd);
+                auto insertPos = selStart;
+                InsertTextAt(insertPos, newText.c_str());
+
+                u.mAdded = newText;
+                u.mAddedStart = selStart;
+                u.mAddedEnd = insertPos;
+                mState.mSelectionStart = selStart;
+                mState.mSelectionEnd = insertPos;
+                u.mAfter = mState;
+                AddUndo(u);
+                return;
+            } else {
+                // Wrap: replace selection with /* selection */
+                std::string newText = "/*" + selText + "*/";
+                DeleteRange(selStart, selEnd);
+                auto insertPos = selStart;
+                InsertTextAt(insertPos, newText.c_str());
+
+                u.mAdded = newText;
+                u.mAddedStart = selStart;
+                u.mAddedEnd = insertPos;
+                // Adjust selection to cover newly inserted block
+                mState.mSelectionStart = selStart;
+                mState.mSelectionEnd = insertPos;
+                u.mAfter = mState;
+                AddUndo(u);
+                return;
+            }
+        }
+    } else {
+        // Single-line comment mode: operate on each line in range
+        bool uncomment_all = false;
+
+        // Look at first line to see if it begins with //
+        if (start_line < mLines.size()) {
+            const auto& fl = mLines[start_line];
+            if (first_non_ws + 1 < fl.size() && fl[first_non_ws] == '/' && fl[first_non_ws + 1] == '/')
+                uncomment_all = true;
+        }
+
+        // If we think we can uncomment all, verify every line is commented (after whitespace)
+        if (uncomment_all) {
+            for (size_t line_idx = start_line; line_idx <= end_line && line_idx < mLines.size(); ++line_idx) {
+                const auto& line = mLines[line_idx];
+                if (line.empty())
+                    continue;
+                size_t non_ws = 0;
+                while (non_ws < line.size() && std::isspace(static_cast<unsigned char>(line[non_ws])))
+                    ++non_ws;
+                if (!(non_ws + 1 < line.size() && line[non_ws] == '/' && line[non_ws + 1] == '/')) {
+                    uncomment_all = false;
+                    break;
+                }
+            }
+        }
+
+        // "//" out after the indentation of every line, or in there on every line with any text, as one line prefix
+        // edit per line
+        const size_t last_line = min(end_line, mLines.size() - 1);
+        u.mPrefixLine = (int)start_line;
+        if (start_line <= last_line)
+            u.mPrefixes.reserve(last_line - start_line + 1);
+        bool didModify = false;
+        auto lineIt = mLines.iterator_at(start_line);
+        for (size_t line_idx = start_line; line_idx <= last_line; ++line_idx, ++lineIt) {
+            const auto& line = *lineIt;
+
+            // Find first non-whitespace character
+            size_t non_ws = 0;
+            while (non_ws < line.size() && std::isspace(static_cast<unsigned char>(line[non_ws])))
+                ++non_ws;
+
+            LinePrefix prefix{(uint32_t)non_ws, 0, 0};
+            if (uncomment_all) {
+                if (non_ws + 1 < line.size() && line[non_ws] == '/' && line[non_ws + 1] == '/')
+                    prefix.mRemoved = 2;
+            } else if (!line.empty()) {
+                prefix.mAdded = 2;
+            }
+            if (prefix.mRemoved != 0 || prefix.mAdded != 0) {
+                u.mPrefixText += "//";
+                didModify = true;
+            }
+            u.mPrefixes.push_back(prefix);
+        }
+
+        if (didModify) {
+            MakeLinePrefixes(u);
+            u.mAfter = mState;
+            AddUndo(u);
+        }
+    }
+
+    // Reset cursor animation (keep consistent with rest of editor)
+    mStartTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void TextEditor::Delete() {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::Delete);
+
+    assert(!mReadOnly);
+
+    if (mLines.empty())
+        return;
+
+    if (!mState.mCursors.empty()) {
+        int main;
+        const auto cursors = GetCursors(main);
+        std::vector<CursorEdit> edits;
+        edits.reserve(cursors.size());
+        for (const auto& cursor : cursors) {
+            CursorEdit edit{cursor.mSelectionStart, cursor.mSelectionEnd, std::string()};
+            if (edit.mStart == edit.mEnd) {
+                const auto& pos = edit.mStart;
+                const auto& line = mLines[pos.mLine];
+                const int cindex = GetCharacterIndex(pos);
+                if (cindex < (int)line.size())
+                    edit.mEnd = Coordinates(pos.mLine, GetCharacterColumn(pos.mLine, min(cindex + UTF8CharLength(line, cindex), (int)line.size())));
+                else if (pos.mLine + 1 < (int)mLines.size())
+                    edit.mEnd = Coordinates(pos.mLine + 1, 0);
+            }
+            edits.push_back(std::move(edit));
+        }
+        EditCursors(edits, main);
+        return;
+    }
+
+    UndoRecord u;
+    u.mBefore = mState;
+
+    if (HasSelection()) {
+        u.mRemoved = GetSelectedText();
+        u.mRemovedStart = mState.mSelectionStart;
+        u.mRemovedEnd = mState.mSelectionEnd;
+
+        DeleteSelection();
+    } else {
+        auto pos = GetActualCursorCoordinates();
+        SetCursorPosition(pos);
+        auto& line = mLines[pos.mLine];
+
+        if (pos.mColumn == GetLineMaxColumn(pos.mLine)) {
+            if (pos.mLine == (int)mLines.size() - 1)
+                return;
+
+            u.mRemoved = '\n';
+            u.mRemovedStart = u.mRemovedEnd = GetActualCursorCoordinates();
+            Advance(u.mRemovedEnd);
+
+            auto& nextLine = mLines[pos.mLine + 1];
+            line.AppendText(nextLine, 0, nextLine.size());
+
+            // The next line's error marker joins it too, unless this line has one
+            if (line.mError == 0)
+                line.mError = nextLine.mError;
+
+            RemoveLine(pos.mLine + 1);
+        } else {
+            auto cindex = GetCharacterIndex(pos);
+            auto cend = min(cindex + UTF8CharLength(line, cindex), (int)line.size());
+            u.mRemovedStart = Coordinates(pos.mLine, GetCharacterColumn(pos.mLine, cindex));
+            u.mRemovedEnd = Coordinates(pos.mLine, GetCharacterColumn(pos.mLine, cend));
+            u.mRemoved = GetText(u.mRemovedStart, u.mRemovedEnd);
+            u.mGroup = UndoRecord::Group::Delete;
+
+            line.EraseText(cindex, cend);
+        }
+
+        mTextChanged = true;
+
+        Colorize(pos.mLine, 1);
+    }
+
+    u.mAfter = mState;
+    AddUndo(u);
+}
+
+void TextEditor::Backspace() {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::Backspace);
+
+    assert(!mReadOnly);
+
+    if (mLines.empty())
+        return;
+
+    if (!mState.mCursors.empty()) {
+        int main;
+        const auto cursors = GetCursors(main);
+        std::vector<CursorEdit> edits;
+        edits.reserve(cursors.size());
+        for (const auto& cursor : cursors) {
+            CursorEdit edit{cursor.mSelectionStart, cursor.mSelectionEnd, std::string()};
+            if (edit.mStart == edit.mEnd) {
+                const auto& pos = edit.mEnd;
+                int cindex = GetCharacterIndex(pos);
+                if (cindex > 0) {
+                    cindex = UTF8CharStart(mLines[pos.mLine], cindex);
+                    edit.mStart = Coordinates(pos.mLine, GetCharacterColumn(pos.mLine, cindex));
+                } else if (pos.mLine > 0) {
+                    edit.mStart = Coordinates(pos.mLine - 1, GetLineMaxColumn(pos.mLine - 1));
+                }
+            }
+            edits.push_back(std::move(edit));
+        }
+        EditCursors(edits, main);
+        return;
+    }
+
+    UndoRecord u;
+    u.mBefore = mState;
+
+    if (HasSelection()) {
+        u.mRemoved = GetSelectedText();
+        u.mRemovedStart = mState.mSelectionStart;
+        u.mRemovedEnd = mState.mSelectionEnd;
+
+        DeleteSelection();
+    } else {
+        auto pos = GetActualCursorCoordinates();
+        SetCursorPosition(pos);
+
+        if (mState.mCursorPosition.mColumn == 0) {
+            if (mState.mCursorPosition.mLine == 0)
+                return;
+
+            u.mRemoved = '\n';
+            u.mRemovedStart = u.mRemovedEnd = Coordinates(pos.mLine - 1, GetLineMaxColumn(pos.mLine - 1));
+            Advance(u.mRemovedEnd);
+
+            auto& line = mLines[mState.mCursorPosition.mLine];
+            auto& prevLine = mLines[mState.mCursorPosition.mLine - 1];
+            auto prevSize = GetLineMaxColumn(mState.mCursorPosition.mLine - 1);
+            prevLine.AppendText(line, 0, line.size());
+
+            // The line's error marker joins it too, unless the line before has one
+            if (prevLine.mError == 0)
+                prevLine.mError = line.mError;
+
+            RemoveLine(mState.mCursorPosition.mLine);
+            --mState.mCursorPosition.mLine;
+            mState.mCursorPosition.mColumn = prevSize;
+        } else {
+            auto& line = mLines[mState.mCursorPosition.mLine];
+            auto cend = GetCharacterIndex(pos);
+            auto cindex = UTF8CharStart(line, cend);
+
+            // A tab or a multi-byte character can be more than one column wide
+            u.mRemovedEnd = GetActualCursorCoordinates();
+            u.mRemovedStart = Coordinates(pos.mLine, GetCharacterColumn(pos.mLine, cindex));
+            mState.mCursorPosition.mColumn = u.mRemovedStart.mColumn;
+
+            while (cindex < line.size() && cend-- > cindex) {
+                u.mRemoved += line[cindex];
+                line.EraseText(cindex, cindex + 1);
+            }
+            u.mGroup = UndoRecord::Group::Backspace;
+        }
+
+        mTextChanged = true;
+
+        EnsureCursorVisible();
+        Colorize(mState.mCursorPosition.mLine, 1);
+    }
+
+    u.mAfter = mState;
+    AddUndo(u);
+}
+
+void TextEditor::SelectWordUnderCursor() {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::SelectWordUnderCursor);
+
+    auto c = GetCursorPosition();
+    SetSelection(FindWordStart(c), FindWordEnd(c));
+}
+
+void TextEditor::SelectAll() {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::SelectAll);
+
+    ClearCursors();
+    SetSelection(Coordinates(0, 0), Coordinates((int)mLines.size(), 0));
+}
+
+bool TextEditor::HasSelection() const {
+    return mState.mSelectionEnd > mState.mSelectionStart;
+}
+
+void TextEditor::Copy() {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::Copy);
+
+    if (!mState.mCursors.empty()) {
+        // A line per cursor, which Paste gives back to each cursor while there are as many
+        int main;
+        const auto cursors = GetCursors(main);
+        std::string text;
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            if (i > 0)
+                text += '\n';
+            text += GetText(cursors[i].mSelectionStart, cursors[i].mSelectionEnd);
+        }
+        ImGui::SetClipboardText(text.c_str());
+        return;
+    }
+
+    if (HasSelection()) {
+        ImGui::SetClipboardText(GetSelectedText().c_str());
+    } else {
+        if (!mLines.empty()) {
+            auto& line = mLines[GetActualCursorCoordinates().mLine];
+            ImGui::SetClipboardText(line.c_str());
+        }
+    }
+}
+
+void TextEditor::Cut() {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::Cut);
+
+    if (IsReadOnly()) {
+        Copy();
+    } else if (!mState.mCursors.empty()) {
+        Copy();
+
+        int main;
+        const auto cursors = GetCursors(main);
+        std::vector<CursorEdit> edits;
+        edits.reserve(cursors.size());
+        for (const auto& cursor : cursors)
+            edits.push_back(CursorEdit{cursor.mSelectionStart, cursor.mSelectionEnd, std::string()});
+        EditCursors(edits, main);
+    } else {
+        if (HasSelection()) {
+            UndoRecord u;
+            u.mBefore = mState;
+            u.mRemoved = GetSelectedText();
+            u.mRemovedStart = mState.mSelectionStart;
+            u.mRemovedEnd = mState.mSelectionEnd;
+
+            Copy();
+            DeleteSelection();
+
+            u.mAfter = mState;
+            AddUndo(u);
+        }
+    }
+}
+
+void TextEditor::Paste() {
+    if (IsReadOnly())
+        return;
+
+    auto clipText = ImGui::GetClipboardText();
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::Paste, {}, clipText, clipText != nullptr ? strlen(clipText) : 0);
+
+    if (clipText != nullptr && strlen(clipText) > 0) {
+        if (!mState.mCursors.empty()) {
+            int main;
+            const auto cursors = GetCursors(main);
+            std::vector<std::string> lines(1);
+            for (const char* c = clipText; *c != '\0'; ++c) {
+                if (*c == '\n')
+                    lines.emplace_back();
+                else if (*c != '\r')
+                    lines.back() += *c;
+            }
+            if (lines.size() == cursors.size() + 1 && lines.back().empty())
+                lines.pop_back();
+
+            std::vector<CursorEdit> edits;
+            edits.reserve(cursors.size());
+            for (size_t i = 0; i < cursors.size(); ++i)
+                edits.push_back(CursorEdit{cursors[i].mSelectionStart, cursors[i].mSelectionEnd,
+                    lines.size() == cursors.size() ? lines[i] : std::string(clipText)});
+            EditCursors(edits, main);
+            return;
+        }
+
+        UndoRecord u;
+        u.mBefore = mState;
+
+        if (HasSelection()) {
+            u.mRemoved = GetSelectedText();
+            u.mRemovedStart = mState.mSelectionStart;
+            u.mRemovedEnd = mState.mSelectionEnd;
+            DeleteSelection();
+        }
+
+        u.mAdded = clipText;
+        u.mAddedStart = GetActualCursorCoordinates();
+
+        // Not InsertText, AddUndo journals this change
+        auto pos = u.mAddedStart;
+        int totalLines = InsertTextAt(pos, clipText);
+        SetSelection(pos, pos);
+        SetCursorPosition(pos);
+        Colorize(u.mAddedStart.mLine - 1, totalLines + 2);
+
+        u.mAddedEnd = GetActualCursorCoordinates();
+        u.mAfter = mState;
+        AddUndo(u);
+    }
+}
+
+bool TextEditor::SetFindPattern(const std::string& aPattern, const TextSearch::Options& aOptions) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::SetFindPattern, {aOptions.mCaseSensitive, aOptions.mWholeWord, aOptions.mRegex}, aPattern.data(),
+            aPattern.size());
+
+    return mSearch.Compile(aPattern, aOptions);
+}
+
+void TextEditor::SelectMatch(int aLine, size_t aStart, size_t aEnd) {
+    mInteractiveStart = Coordinates(aLine, GetCharacterColumn(aLine, (int)aStart));
+    mInteractiveEnd = Coordinates(aLine, GetCharacterColumn(aLine, (int)aEnd));
+    SetSelection(mInteractiveStart, mInteractiveEnd);
+    SetCursorPosition(mInteractiveEnd);
+}
+
+bool TextEditor::FindNext() {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::FindNext);
+
+    if (mSearch.IsEmpty() || mLines.empty())
+        return false;
+
+    // From the end of the selection, which is the last match found when stepping through them, round to where it
+    // started: the start line comes up again last, for what is before the start.
+    const auto from = HasSelection() ? mState.mSelectionEnd : GetActualCursorCoordinates();
+    const size_t fromIndex = (size_t)GetCharacterIndex(from);
+    const int count = (int)mLines.size();
+    auto lineIt = mLines.iterator_at(from.mLine);
+    for (int n = 0; n <= count; ++n, ++lineIt) {
+        if (lineIt == mLines.end())
+            lineIt = mLines.begin();
+        const char* begin = lineIt->data();
+        const char* end = begin + lineIt->size();
+        const char* start;
+        const char* stop;
+        if (mSearch.Find(begin, end, n == 0 ? begin + min(fromIndex, lineIt->size()) : begin, start, stop) &&
+            (n < count || (size_t)(start - begin) < fromIndex)) {
+            SelectMatch((from.mLine + n) % count, start - begin, stop - begin);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TextEditor::FindPrevious() {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::FindPrevious);
+
+    if (mSearch.IsEmpty() || mLines.empty())
+        return false;
+
+    // The last match that starts before the selection, going up and round from the bottom
+    const auto from = HasSelection() ? mState.mSelectionStart : GetActualCursorCoordinates();
+    const size_t fromIndex = (size_t)GetCharacterIndex(from);
+    const int count = (int)mLines.size();
+    for (int n = 0; n <= count; ++n) {
+        const int lineNo = (from.mLine - n % count + count) % count;
+        auto& line = mLines[lineNo];
+        const char* begin = line.data();
+        const char* end = begin + line.size();
+        const char* start;
+        const char* stop;
+        const char* lastStart = nullptr;
+        const char* lastStop = nullptr;
+        for (const char* at = n == count ? begin + min(fromIndex, line.size()) : begin; mSearch.Find(begin, end, at, start, stop); at = stop) {
+            if (n == 0 && (size_t)(start - begin) >= fromIndex)
+                break;
+            lastStart = start;
+            lastStop = stop;
+        }
+        if (lastStart != nullptr) {
+            SelectMatch(lineNo, lastStart - begin, lastStop - begin);
+            return true;
+        }
+    }
+    return false;
+}
+
+int TextEditor::ReplaceAll(const std::string& aReplacement) {
+    if (IsReadOnly() || mSearch.IsEmpty())
+        return 0;
+
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::ReplaceAll, {}, aReplacement.data(), aReplacement.size());
+
+    ClearCursors();
+
+    // Find every match before changing anything, then replace them all as one batched edit: one undo record that
+    // keeps only what each match removed and added, however far apart the matches are
+    auto clean = [](const std::string& aText) {
+        // InsertTextAt drops carriage returns and stops at a null
+        std::string text;
+        for (auto c : aText) {
+            if (c == '\0')
+                break;
+            if (c != '\r')
+                text += c;
+        }
+        return text;
+    };
+    const std::string literal = mSearch.GetOptions().mRegex ? std::string() : clean(aReplacement);
+    std::vector<CursorEdit> edits;
+    int lineNo = 0;
+    for (auto& line : mLines) {
+        const char* begin = line.data();
+        const char* end = begin + line.size();
+        const char* start;
+        const char* stop;
+        for (const char* at = begin; mSearch.Find(begin, end, at, start, stop); at = stop) {
+            edits.push_back(CursorEdit{Coordinates(lineNo, GetCharacterColumn(lineNo, (int)(start - begin))),
+                Coordinates(lineNo, GetCharacterColumn(lineNo, (int)(stop - begin))),
+                mSearch.GetOptions().mRegex ? clean(mSearch.GetReplacement(aReplacement)) : literal});
+        }
+        ++lineNo;
+    }
+    if (edits.empty())
+        return 0;
+
+    // The cursor ends up after the last replacement
+    EditCursors(edits, (int)edits.size() - 1, false);
+    return (int)edits.size();
+}
+
+// The line that closes the blocks aLine leaves open, if that is at least two lines further down, or -1
+int TextEditor::GetFoldEnd(int aLine) const {
+    if (aLine < 0 || aLine >= (int)mLines.size())
+        return -1;
+
+    const auto opens = mLines[aLine].mBlocks.mOpens;
+    if (opens == 0)
+        return -1;
+    const auto end = mLines.FindBlockEnd((size_t)aLine, opens);
+    return end < mLines.size() && end > (size_t)aLine + 1 ? (int)end : -1;
+}
+
+bool TextEditor::Fold(int aLine) {
+    const int end = GetFoldEnd(aLine);
+    if (end < 0 || IsFolded(aLine) || mLines.IsHidden(aLine))
+        return false;
+
+    // Folds nest, which Unfold relies on. One taken inside the block before its text changed can reach past the block's
+    // end now, and is opened rather than crossed.
+    for (int i = aLine + 1; i < end; ++i) {
+        if (IsFolded(i) && i + (int)mLines[i].mFolded >= end)
+            Unfold(i);
+    }
+    FoldLines(aLine, end - aLine - 1);
+    return true;
+}
+
+void TextEditor::FoldLines(int aLine, int aCount) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::Fold, {aLine, aCount});
+
+    assert(aCount > 0 && aLine + aCount < (int)mLines.size());
+    mLines[aLine].mFolded = (uint32_t)aCount;
+    ++mFoldCount;
+    for (int i = aLine + 1; i <= aLine + aCount; ++i)
+        mLines.SetRows(i, 0);
+
+    // Nothing can be left on a hidden line: the cursor and selection go to the end of the folded one
+    auto hidden = [=](const Coordinates& aAt) { return aAt.mLine > aLine && aAt.mLine <= aLine + aCount; };
+    if (hidden(mState.mCursorPosition) || hidden(mState.mSelectionStart) || hidden(mState.mSelectionEnd)) {
+        const Coordinates end(aLine, GetLineMaxColumn(aLine));
+        mInteractiveStart = mInteractiveEnd = end;
+        SetSelection(end, end);
+        SetCursorPosition(end);
+    }
+}
+
+void TextEditor::Unfold(int aLine) {
+    if (aLine < 0 || aLine >= (int)mLines.size() || !IsFolded(aLine))
+        return;
+
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::Unfold, {aLine});
+
+    auto& line = mLines[aLine];
+    const int end = aLine + 1 + (int)line.mFolded;
+    line.mFolded = 0;
+    --mFoldCount;
+
+    // The lines come back, but for those still folded under a line of their own. Under a line that is hidden itself
+    // they stay hidden, until whatever hides it unfolds.
+    if (mLines.IsHidden(aLine))
+        return;
+    for (int i = aLine + 1; i < end; ++i) {
+        mLines.SetRows(i, 1);
+        i += (int)mLines[i].mFolded;
+    }
+}
+
+// aLine, or the line it is hidden under
+int TextEditor::GetVisibleLine(int aLine) const {
+    if (mFoldCount == 0 || !mLines.IsHidden(aLine))
+        return aLine;
+    int rowInLine;
+    return (int)mLines.FindRow(mLines.GetFirstRow(aLine) - 1, rowInLine);
+}
+
+// Unfolds whatever hides aLine
+void TextEditor::RevealLine(int aLine) {
+    while (mFoldCount > 0 && mLines.IsHidden(aLine)) {
+        const int folded = GetVisibleLine(aLine);
+        assert(IsFolded(folded));
+        Unfold(folded);
+    }
+}
+
+// Unfolds the lines in [aStart, aEnd) and whatever hides them, before lines there come or go
+void TextEditor::UnfoldLines(int aStart, int aEnd) {
+    for (int i = max(0, aStart); i < min(aEnd, (int)mLines.size()) && mFoldCount > 0; ++i) {
+        RevealLine(i);
+        Unfold(i);
+    }
+}
+
+bool TextEditor::GetMatchingBlock(Coordinates& aStart, Coordinates& aEnd, Coordinates& aPartnerStart, Coordinates& aPartnerEnd) {
+    auto& match = FindMatchingBlock();
+    if (!match.mFound)
+        return false;
+    aStart = match.mStart;
+    aEnd = match.mEnd;
+    aPartnerStart = match.mPartnerStart;
+    aPartnerEnd = match.mPartnerEnd;
+    return true;
+}
+
+bool TextEditor::JumpToMatchingBlock() {
+    auto& match = FindMatchingBlock();
+    if (!match.mFound)
+        return false;
+
+    const auto to = match.mPartnerStart;
+    mInteractiveStart = mInteractiveEnd = to;
+    SetSelection(to, to);
+    SetCursorPosition(to);
+    return true;
+}
+
+// The token at the cursor is found in the runs of its line. Its partner is on the same line, or on the line the block
+// index finds in O(log n), where the lines in between tell which of that line's tokens it is. A bracket only pairs with
+// the bracket that closes it, a keyword with a keyword.
+const TextEditor::BlockMatch& TextEditor::FindMatchingBlock() {
+    const auto at = GetActualCursorCoordinates();
+    auto& match = mBlockMatch;
+    if (match.mValid && match.mAt == at && match.mVersion == mVersion)
+        return match;
+    match.mValid = true;
+    match.mAt = at;
+    match.mVersion = mVersion;
+    match.mFound = false;
+    if (mLines.empty() || mLines[at.mLine].mRuns.empty())
+        return match;
+
+    auto& tokens = mBlockTokens;
+    ScanBlockTokens(at.mLine, tokens);
+    const auto index = (uint32_t)GetCharacterIndex(at);
+    int found = -1;
+    for (int i = 0; i < (int)tokens.size() && found < 0; ++i) {
+        auto& token = tokens[i];
+        if (token.mLength == 0 || token.mOffset > index || token.mOffset + token.mLength < index)
+            continue;
+        // The token right before the cursor is second best: the one the cursor is on may come next
+        if (token.mOffset + token.mLength == index && i + 1 < (int)tokens.size() && tokens[i + 1].mOffset == index && tokens[i + 1].mLength > 0)
+            continue;
+        found = i;
+    }
+    if (found < 0)
+        return match;
+
+    const auto token = tokens[found];
+    int partnerLine = at.mLine;
+    int partner = -1;
+    uint32_t depth = 1;
+    if (token.mOpens) {
+        for (int i = found + 1; i < (int)tokens.size() && partner < 0; ++i) {
+            if (tokens[i].mCloses && --depth == 0)
+                partner = i;
+            else if (tokens[i].mOpens)
+                ++depth;
+        }
+        if (partner < 0) {
+            // The closes of that line that the lines in between leave unpaired, up to the one that closes the block
+            Blocks between;
+            partnerLine = (int)mLines.FindBlockEnd((size_t)at.mLine, depth, &between);
+            if (partnerLine >= (int)mLines.size())
+                return match;
+            uint32_t count = between.mOpens + depth - between.mCloses;
+            uint32_t opens = 0;
+            ScanBlockTokens(partnerLine, tokens);
+            for (int i = 0; i < (int)tokens.size() && partner < 0; ++i) {
+                if (tokens[i].mCloses) {
+                    if (opens > 0)
+                        --opens;
+                    else if (--count == 0)
+                        partner = i;
+                }
+                if (tokens[i].mOpens && partner < 0)
+                    ++opens;
+            }
+        }
+    } else {
+        for (int i = found - 1; i >= 0 && partner < 0; --i) {
+            if (tokens[i].mOpens && --depth == 0)
+                partner = i;
+            else if (tokens[i].mCloses)
+                ++depth;
+        }
+        if (partner < 0) {
+            Blocks between;
+            partnerLine = (int)mLines.FindBlockStart((size_t)at.mLine, depth, &between);
+            if (partnerLine >= (int)mLines.size())
+                return match;
+            uint32_t count = between.mCloses + depth - between.mOpens;
+            uint32_t closes = 0;
+            ScanBlockTokens(partnerLine, tokens);
+            for (int i = (int)tokens.size() - 1; i >= 0 && partner < 0; --i) {
+                if (tokens[i].mOpens) {
+                    if (closes > 0)
+                        --closes;
+                    else if (--count == 0)
+                        partner = i;
+                }
+                if (tokens[i].mCloses && partner < 0)
+                    ++closes;
+            }
+        }
+    }
+    if (partner < 0)
+        return match;
+
+    auto& other = tokens[partner];
+    static const char* const brackets = "()[]{}";
+    const char* bracket = token.mBracket != 0 ? strchr(brackets, token.mBracket) : nullptr;
+    const char pairs = bracket == nullptr ? token.mBracket : bracket[(bracket - brackets) % 2 == 0 ? 1 : -1];
+    if (other.mBracket != pairs || other.mLength == 0)
+        return match;
+
+    match.mFound = true;
+    match.mStart = Coordinates(at.mLine, GetCharacterColumn(at.mLine, (int)token.mOffset));
+    match.mEnd = Coordinates(at.mLine, GetCharacterColumn(at.mLine, (int)(token.mOffset + token.mLength)));
+    match.mPartnerStart = Coordinates(partnerLine, GetCharacterColumn(partnerLine, (int)other.mOffset));
+    match.mPartnerEnd = Coordinates(partnerLine, GetCharacterColumn(partnerLine, (int)(other.mOffset + other.mLength)));
+    return match;
+}
+
+// Indexes the identifiers a line was just colorized with, outside comments. Keywords and known identifiers are
+// builtins already, so only the Identifier runs are looked at, cut up where a run holds more than one.
+void TextEditor::HarvestSymbols(Line& aLine) {
+    auto& symbols = mSymbolScratch;
+    symbols.clear();
+    const char* text = aLine.data();
+    for (auto& run : aLine.mRuns) {
+        if (run.mStyle.mKind != PaletteIndex::Identifier || run.mStyle.mComment || run.mStyle.mMultiLineComment)
+            continue;
+        for (size_t i = run.mOffset, end = run.mOffset + run.mLength; i < end;) {
+            if (!IsIdentifierChar(text[i])) {
+                ++i;
+                continue;
+            }
+            auto start = i;
+            while (i < end && IsIdentifierChar(text[i]))
+                ++i;
+            if (text[start] < '0' || text[start] > '9')
+                symbols.push_back(mCompletions.Add(std::string_view(text + start, i - start)));
+        }
+    }
+
+    // Added before the old ones are released, so words the line keeps are never dropped and interned again
+    for (auto id : aLine.mSymbols)
+        mCompletions.Release(id);
+    aLine.mSymbols.assign(symbols.begin(), symbols.end());
+}
+
+// Finds what a line defines in its tokens outside comments and strings, statement by statement:
+//   local function f               a LocalFunction
+//   local a <const>, b = ...       Locals, or a LocalFunction for a single one set to a function
+//   function f / function M.a:b    a Function, or a Method for a dotted name
+//   f = function / M.a = function  likewise, and a Method after '{' or ',' where it is a table constructor's field
+void TextEditor::IndexOutline(int aIndex, Line& aLine) {
+    auto& symbols = mOutlineScratch;
+    symbols.clear();
+
+    // Every definition starts with a local or function keyword, which most lines don't have
+    const char* text = aLine.data();
+    bool keywords = false;
+    for (auto& run : aLine.mRuns) {
+        if (run.mStyle.mKind == PaletteIndex::Keyword && !run.mStyle.mComment && !run.mStyle.mMultiLineComment)
+            keywords |= (run.mLength == 5 && memcmp(text + run.mOffset, "local", 5) == 0) ||
+                        (run.mLength == 8 && memcmp(text + run.mOffset, "function", 8) == 0);
+    }
+
+    auto& tokens = mOutlineTokens;
+    tokens.clear();
+    for (size_t r = 0; keywords && r < aLine.mRuns.size(); ++r) {
+        const auto& run = aLine.mRuns[r];
+        const auto kind = run.mStyle.mKind;
+        if (run.mStyle.mComment || run.mStyle.mMultiLineComment || kind == PaletteIndex::String || kind == PaletteIndex::CharLiteral)
+            continue;
+        for (size_t i = run.mOffset, end = run.mOffset + run.mLength; i < end;) {
+            TokenRun token;
+            token.mOffset = (uint32_t)i;
+            token.mStyle = run.mStyle;
+            if (text[i] == ' ' || text[i] == '\t') {
+                ++i;
+                continue;
+            } else if (IsIdentifierChar(text[i])) {
+                while (i < end && IsIdentifierChar(text[i]))
+                    ++i;
+            } else if (i + 1 < end && (text[i + 1] == '=' || (text[i] == '.' && text[i + 1] == '.'))) {
+                i += 2; // not '=' or '.', but ==, ~=, <=, >= or ..
+            } else {
+                ++i;
+            }
+            token.mLength = (uint16_t)(i - token.mOffset);
+            tokens.push_back(token);
+        }
+    }
+
+    const size_t count = tokens.size();
+    auto is = [&](size_t aToken, const char* aText) {
+        return aToken < count && tokens[aToken].mLength == strlen(aText) && memcmp(text + tokens[aToken].mOffset, aText, tokens[aToken].mLength) == 0;
+    };
+    auto isKeyword = [&](size_t aToken, const char* aText) { return is(aToken, aText) && tokens[aToken].mStyle.mKind == PaletteIndex::Keyword; };
+    auto isName = [&](size_t aToken) {
+        return aToken < count && tokens[aToken].mStyle.mKind != PaletteIndex::Keyword && IsIdentifierChar(text[tokens[aToken].mOffset]) &&
+               (text[tokens[aToken].mOffset] < '0' || text[tokens[aToken].mOffset] > '9');
+    };
+    // One past the last name of a.b.c or a.b:c starting at aToken
+    auto chainEnd = [&](size_t aToken, bool& aDotted) {
+        aDotted = false;
+        while ((is(aToken + 1, ".") || is(aToken + 1, ":")) && isName(aToken + 2)) {
+            aDotted = true;
+            aToken += 2;
+            if (is(aToken - 1, ":"))
+                break;
+        }
+        return aToken + 1;
+    };
+    auto add = [&](size_t aFirst, size_t aLast, SymbolKind aKind) {
+        OutlineSymbol symbol;
+        symbol.mOffset = tokens[aFirst].mOffset;
+        symbol.mLength = (uint16_t)min(tokens[aLast].mOffset + tokens[aLast].mLength - symbol.mOffset, (uint32_t)0xffff);
+        symbol.mKind = aKind;
+        symbols.push_back(symbol);
+    };
+
+    for (size_t i = 0; i < count;) {
+        bool dotted;
+        if (isKeyword(i, "local") && isKeyword(i + 1, "function") && isName(i + 2)) {
+            add(i + 2, i + 2, SymbolKind::LocalFunction);
+            i += 3;
+        } else if (isKeyword(i, "local") && isName(i + 1)) {
+            const size_t first = symbols.size();
+            ++i;
+            for (;;) {
+                add(i, i, SymbolKind::Local);
+                ++i;
+                if (is(i, "<") && isName(i + 1) && is(i + 2, ">"))
+                    i += 3;
+                if (!is(i, ",") || !isName(i + 1))
+                    break;
+                ++i;
+            }
+            if (symbols.size() == first + 1 && is(i, "=") && isKeyword(i + 1, "function"))
+                symbols.back().mKind = SymbolKind::LocalFunction;
+        } else if (isKeyword(i, "function") && isName(i + 1)) {
+            const auto end = chainEnd(i + 1, dotted);
+            add(i + 1, end - 1, dotted ? SymbolKind::Method : SymbolKind::Function);
+            i = end;
+        } else if (isName(i) && !is(i - 1, ".") && !is(i - 1, ":")) {
+            const auto end = chainEnd(i, dotted);
+            if (is(end, "=") && isKeyword(end + 1, "function")) {
+                const bool field = is(i - 1, "{") || is(i - 1, ",");
+                add(i, end - 1, dotted || field ? SymbolKind::Method : SymbolKind::Function);
+                i = end + 2;
+            } else {
+                i = end;
+            }
+        } else {
+            ++i;
+        }
+    }
+
+    if (symbols != aLine.mOutline) {
+        const bool counted = symbols.size() != aLine.mOutline.size();
+        aLine.mOutline.assign(symbols.begin(), symbols.end());
+        if (counted)
+            mLines.UpdateOutline((size_t)aIndex);
+    }
+}
+
+bool TextEditor::GetOutlineItem(int aIndex, OutlineItem& aItem) const {
+    int inLine;
+    const auto lineNo = aIndex >= 0 ? mLines.FindOutline((size_t)aIndex, inLine) : mLines.size();
+    if (lineNo >= mLines.size())
+        return false;
+
+    // Found when the line was last colorized, which edits since may have moved
+    const auto& line = mLines[lineNo];
+    const auto& symbol = line.mOutline[inLine];
+    const auto start = min((size_t)symbol.mOffset, line.size());
+    const auto end = min(start + symbol.mLength, line.size());
+    aItem.mStart = Coordinates((int)lineNo, GetCharacterColumn((int)lineNo, (int)start));
+    aItem.mEnd = Coordinates((int)lineNo, GetCharacterColumn((int)lineNo, (int)end));
+    aItem.mKind = symbol.mKind;
+    aItem.mDepth = (int)mLines.GetBlocksBefore(lineNo).mOpens;
+    aItem.mName = std::string_view(line.data() + start, end - start);
+    return true;
+}
+
+void TextEditor::RenderOutline(const char* aTitle, const ImVec2& aSize, bool aBorder) {
+    ImGui::PushStyleColor(ImGuiCol_ChildBg, ImGui::ColorConvertU32ToFloat4(mPalette[(int)PaletteIndex::Background]));
+    ImGui::BeginChild(aTitle, aSize, aBorder, ImGuiWindowFlags_HorizontalScrollbar);
+
+    // The item the cursor is in, or the last one above it. Only the rows in view are looked up.
+    const int current = (int)mLines.CountOutlineBefore((size_t)GetActualCursorCoordinates().mLine + 1) - 1;
+    const float indent = ImGui::GetFontSize();
+    ImGuiListClipper clipper;
+    clipper.Begin(GetOutlineSize());
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+            OutlineItem item;
+            if (!GetOutlineItem(i, item))
+                continue;
+
+            static const char* const kinds[] = {"function", "local function", "function", "local"};
+            char label[256];
+            snprintf(label, sizeof(label), "%s %.*s##%d", kinds[(int)item.mKind], (int)min(item.mName.size(), (size_t)200), item.mName.data(), i);
+            ImGui::SetCursorPosX(ImGui::GetCursorPosX() + indent * min(item.mDepth, 16));
+            const auto color = item.mKind == SymbolKind::Local ? PaletteIndex::Identifier : PaletteIndex::KnownIdentifier;
+            ImGui::PushStyleColor(ImGuiCol_Text, ImGui::ColorConvertU32ToFloat4(mPalette[(int)color]));
+            if (ImGui::Selectable(label, i == current)) {
+                mInteractiveStart = item.mStart;
+                mInteractiveEnd = item.mEnd;
+                SetSelection(item.mStart, item.mEnd);
+                SetCursorPosition(item.mEnd);
+                EnsureCursorVisible();
+            }
+            ImGui::PopStyleColor();
+        }
+    }
+
+    ImGui::EndChild();
+    ImGui::PopStyleColor();
+}
+
+void TextEditor::OpenCompletion() {
+    UpdateCompletion();
+}
+
+// Looks up the identifier before the cursor; the popup is open while that finds words
+void TextEditor::UpdateCompletion() {
+    auto& completion = mCompletion;
+    completion.mOpen = false;
+    if (mLines.empty() || HasSelection() || !mState.mCursors.empty())
+        return;
+
+    const auto at = GetActualCursorCoordinates();
+    const auto& line = mLines[at.mLine];
+    const int end = GetCharacterIndex(at);
+    int start = end;
+    while (start > 0 && IsIdentifierChar(line[start - 1]))
+        --start;
+    if (start == end || (line[start] >= '0' && line[start] <= '9'))
+        return;
+
+    mCompletions.Find(std::string_view(line.data() + start, end - start), CompletionItems, completion.mItems);
+    if (completion.mItems.empty())
+        return;
+    completion.mOpen = true;
+    completion.mStart = Coordinates(at.mLine, GetCharacterColumn(at.mLine, start));
+    completion.mAt = at;
+    completion.mVersion = mVersion;
+    completion.mSelected = 0;
+}
+
+void TextEditor::AcceptCompletion() {
+    auto& completion = mCompletion;
+    if (completion.mOpen && completion.mSelected >= 0 && completion.mSelected < (int)completion.mItems.size())
+        Complete(mCompletions.GetWord(completion.mItems[completion.mSelected]));
+}
+
+void TextEditor::Complete(const std::string& aWord) {
+    mCompletion.mOpen = false;
+    if (IsReadOnly() || aWord.empty() || HasSelection())
+        return;
+
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::Complete, {}, aWord.data(), aWord.size());
+
+    ClearCursors();
+
+    const auto end = GetActualCursorCoordinates();
+    const auto& line = mLines[end.mLine];
+    const int endIndex = GetCharacterIndex(end);
+    int startIndex = endIndex;
+    while (startIndex > 0 && IsIdentifierChar(line[startIndex - 1]))
+        --startIndex;
+
+    UndoRecord u;
+    u.mBefore = mState;
+    u.mRemovedStart = Coordinates(end.mLine, GetCharacterColumn(end.mLine, startIndex));
+    u.mRemovedEnd = end;
+    if (startIndex < endIndex) {
+        u.mRemoved.assign(line.data() + startIndex, endIndex - startIndex);
+        DeleteRange(u.mRemovedStart, u.mRemovedEnd);
+    }
+
+    // Not InsertText, AddUndo journals this change
+    u.mAdded = aWord;
+    u.mAddedStart = u.mRemovedStart;
+    auto pos = u.mAddedStart;
+    InsertTextAt(pos, aWord.c_str());
+    SetSelection(pos, pos);
+    SetCursorPosition(pos);
+    Colorize(pos.mLine, 1);
+
+    u.mAddedEnd = GetActualCursorCoordinates();
+    u.mAfter = mState;
+    AddUndo(u);
+}
+
+int TextEditor::CompletionItemAt(const ImVec2& aPosition) const {
+    auto& completion = mCompletion;
+    if (!completion.mOpen || aPosition.x < completion.mMin.x || aPosition.x >= completion.mMax.x || aPosition.y < completion.mMin.y ||
+        aPosition.y >= completion.mMax.y)
+        return -1;
+    const int item = (int)((aPosition.y - completion.mMin.y) / mCharAdvance.y);
+    return item < (int)completion.mItems.size() ? item : -1;
+}
+
+// A list under the identifier being typed, drawn last so it covers the text
+void TextEditor::RenderCompletion(ImDrawList* aDrawList, const ImVec2& aTextScreenPos) {
+    auto& completion = mCompletion;
+    int rowInLine;
+    const float x = TextDistanceToRowStart(completion.mStart, rowInLine);
+    const auto row = mLines.GetFirstRow((size_t)completion.mStart.mLine) + rowInLine + 1;
+    const float spaceSize = ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), FLT_MAX, -1.0f, " ").x;
+
+    float width = 0.0f;
+    for (auto id : completion.mItems) {
+        const auto& word = mCompletions.GetWord(id);
+        width = max(width, ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), FLT_MAX, -1.0f, word.data(), word.data() + word.size()).x);
+    }
+    completion.mMin = ImVec2(aTextScreenPos.x + x - spaceSize, aTextScreenPos.y + row * mCharAdvance.y);
+    completion.mMax = ImVec2(completion.mMin.x + width + spaceSize * 2.0f, completion.mMin.y + completion.mItems.size() * mCharAdvance.y);
+
+    aDrawList->AddRectFilled(completion.mMin, completion.mMax, mPalette[(int)PaletteIndex::Background]);
+    aDrawList->AddRect(completion.mMin, completion.mMax, mPalette[(int)PaletteIndex::LineNumber]);
+    for (int i = 0; i < (int)completion.mItems.size(); ++i) {
+        const ImVec2 start(completion.mMin.x, completion.mMin.y + i * mCharAdvance.y);
+        if (i == completion.mSelected)
+            aDrawList->AddRectFilled(start, ImVec2(completion.mMax.x, start.y + mCharAdvance.y), mPalette[(int)PaletteIndex::Selection]);
+
+        const auto id = completion.mItems[i];
+        const auto& word = mCompletions.GetWord(id);
+        PaletteIndex kind = PaletteIndex::Identifier;
+        if (mLanguage->mDefinition->mKeywords.count(word) != 0)
+            kind = PaletteIndex::Keyword;
+        else if (mCompletions.IsBuiltin(id))
+            kind = PaletteIndex::KnownIdentifier;
+        aDrawList->AddText(ImVec2(start.x + spaceSize, start.y), mPalette[(int)kind], word.data(), word.data() + word.size());
+    }
+}
+
+bool TextEditor::CanUndo() const {
+    return !mReadOnly && mUndoIndex > 0;
+}
+
+bool TextEditor::CanRedo() const {
+    return !mReadOnly && mUndoIndex < (int)mUndoBuffer.size();
+}
+
+void TextEditor::Undo(int aSteps) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::Undo, {aSteps});
+
+    mUndoGroupOpen = false;
+    while (CanUndo() && aSteps-- > 0)
+        mUndoBuffer[--mUndoIndex].Undo(this);
+}
+
+void TextEditor::Redo(int aSteps) {
+    TraceScope trace(this);
+    if (trace)
+        mTrace->Write(EditTrace::Op::Redo, {aSteps});
+
+    mUndoGroupOpen = false;
+    while (CanRedo() && aSteps-- > 0)
+        mUndoBuffer[mUndoIndex++].Redo(this);
+}
+
+const TextEditor::Palette& TextEditor::GetDarkPalette() {
+    const static Palette p = {{
+        ImColor{204, 204, 204, 255}, // Default
+        ImColor{249, 117, 131, 255}, // Keyword
+        ImColor{248, 248, 248, 255}, // Number
+        ImColor{255, 171, 112, 255}, // String
+        ImColor{255, 171, 112, 255}, // Char literal
+        ImColor{204, 204, 204, 255}, // Punctuation
+        0xff408080,                  // Preprocessor
+        ImColor{204, 204, 204, 255}, // Identifier
+        ImColor{179, 146, 240, 255}, // Known identifier
+        0xffc040a0,                  // Preproc identifier
+        ImColor{107, 115, 124, 255}, // Comment (single line)
+        ImColor{107, 115, 124, 255}, // Comment (multi line)
+        ImColor{31, 31, 31, 255},    // Background
+        0xffe0e0e0,                  // Cursor
+        0x80a06020,                  // Selection
+        0x800020ff,                  // ErrorMarker
+        0x40f08000,                  // Breakpoint
+        ImColor{114, 114, 114, 255}, // Line number
+        ImColor{48, 48, 48, 255},    // Current line fill
+        ImColor{48, 48, 48, 255},    // Current line fill (inactive)
+        0x40a0a0a0,                  // Current line edge
+        0x5000a0ff,                  // Find match
+        0x5080ff80,                  // Matching block
+    }};
+    return p;
+}
+
+const TextEditor::Palette& TextEditor::GetLightPalette() {
+    const static Palette p = {{
+        0xff7f7f7f, // None
+        0xffff0c06, // Keyword
+        0xff008000, // Number
+        0xff2020a0, // String
+        0xff304070, // Char literal
+        0xff000000, // Punctuation
+        0xff406060, // Preprocessor
+        0xff404040, // Identifier
+        0xff606010, // Known identifier
+        0xffc040a0, // Preproc identifier
+        0xff205020, // Comment (single line)
+        0xff405020, // Comment (multi line)
+        0xffffffff, // Background
+        0xff000000, // Cursor
+        0x80600000, // Selection
+        0xa00010ff, // ErrorMarker
+        0x80f08000, // Breakpoint
+        0xff505000, // Line number
+        0x40000000, // Current line fill
+        0x40808080, // Current line fill (inactive)
+        0x40000000, // Current line edge
+        0x6000c0ff, // Find match
+        0x6040c040, // Matching block
+    }};
+    return p;
+}
+
+const TextEditor::Palette& TextEditor::GetRetroBluePalette() {
+    const static Palette p = {{
+        0xff00ffff, // None
+        0xffffff00, // Keyword
+        0xff00ff00, // Number
+        0xff808000, // String
+        0xff808000, // Char literal
+        0xffffffff, // Punctuation
+        0xff008000, // Preprocessor
+        0xff00ffff, // Identifier
+        0xffffffff, // Known identifier
+        0xffff00ff, // Preproc identifier
+        0xff808080, // Comment (single line)
+        0xff404040, // Comment (multi line)
+        0xff800000, // Background
+        0xff0080ff, // Cursor
+        0x80ffff00, // Selection
+        0xa00000ff, // ErrorMarker
+        0x80ff8000, // Breakpoint
+        0xff808000, // Line number
+        0x40000000, // Current line fill
+        0x40808080, // Current line fill (inactive)
+        0x40000000, // Current line edge
+        0x6000ffff, // Find match
+        0x6080ff80, // Matching block
+    }};
+    return p;
+}
+
+std::string TextEditor::GetText() const {
+    return GetText(Coordinates(), Coordinates((int)mLines.size(), 0));
+}
+
+std::vector<std::string> TextEditor::GetTextLines() const {
+    std::vector<std::string> result;
+
+    result.reserve(mLines.size());
+
+    for (auto& line : mLines)
+        result.emplace_back(line);
+
+    return result;
+}
+
+std::string TextEditor::GetSelectedText() const {
+    return GetText(mState.mSelectionStart, mState.mSelectionEnd);
+}
+
+std::string TextEditor::GetCurrentLineText() const {
+    auto lineLength = GetLineMaxColumn(mState.mCursorPosition.mLine);
+    return GetText(Coordinates(mState.mCursorPosition.mLine, 0), Coordinates(mState.mCursorPosition.mLine, lineLength));
+}
+
+void TextEditor::ProcessInputs() {
+}
+
+void TextEditor::Colorize(int aFromLine, int aLines) {
+    int fromLine = max(0, aFromLine);
+    int toLine = aLines == -1 ? (int)mLines.size() : min((int)mLines.size(), aFromLine + aLines);
+    toLine = max(fromLine, toLine);
+
+    // Every edit ends up here, so this is where lines learn they changed since a background snapshot was taken
+    ++mVersion;
+    if (fromLine < toLine) {
+        auto lineIt = mLines.iterator_at(fromLine);
+        for (int i = fromLine; i < toLine; ++i, ++lineIt)
+            lineIt->mRevision = mVersion;
+    }
+
+    QueueColorize(fromLine, toLine);
+}
+
+void TextEditor::QueueColorize(int aFromLine, int aToLine) {
+    // Grow the pending range over the new lines, an empty range starts over from them
+    if (mColorRangeMin < mColorRangeMax) {
+        mColorRangeMin = min(mColorRangeMin, aFromLine);
+        mColorRangeMax = max(mColorRangeMax, aToLine);
+    } else {
+        mColorRangeMin = aFromLine;
+        mColorRangeMax = aToLine;
+    }
+}
+
+// Colorizes a line that starts in aState and returns the state it ends in. The comment pass and the token pass each
+// fill in their part of a style per byte, which is then collapsed into the line's runs.
+TextEditor::LineState TextEditor::ColorizeLine(Line& aLine, LineState aState, ColorizeBuffers& aBuffers) const {
+    aBuffers.mStyles.assign(aLine.size(), Style());
+    auto styles = aBuffers.mStyles.data();
+    auto state = ColorizeComments(aLine, aState, styles);
+
+    aLine.mRuns.clear();
+    aLine.mDrawId = 0;
+    aLine.mBlocks = Blocks();
+    if (aLine.empty())
+        return state;
+
+    std::cmatch results;
+    std::string id;
+
+    const char* bufferBegin = aLine.data();
+    const char* bufferEnd = bufferBegin + aLine.size();
+
+    auto last = bufferEnd;
+
+    for (auto first = bufferBegin; first != last;) {
+        const char* token_begin = nullptr;
+        const char* token_end = nullptr;
+        PaletteIndex token_color = PaletteIndex::Default;
+
+        bool hasTokenizeResult = false;
+
+        if (mLanguage->mDefinition->mTokenize != nullptr) {
+            if (mLanguage->mDefinition->mTokenize(first, last, token_begin, token_end, token_color))
+                hasTokenizeResult = true;
+        }
+
+        if (hasTokenizeResult == false && !mLanguage->mRegexDfa.IsEmpty()) {
+            int rule = mLanguage->mRegexDfa.Match(first, last, token_end);
+            if (rule >= 0) {
+                hasTokenizeResult = true;
+                token_begin = first;
+                token_color = mLanguage->mDefinition->mTokenRegexStrings[rule].second;
+            }
+        }
+
+        if (hasTokenizeResult == false) {
+            // todo : remove
+            // printf("using regex for %.*s\n", first + 10 < last ? 10 : int(last - first), first);
+
+            for (auto& p : mRegexList) {
+                if (std::regex_search(first, last, results, p.first, std::regex_constants::match_continuous)) {
+                    hasTokenizeResult = true;
+
+                    auto& v = *results.begin();
+                    token_begin = v.first;
+                    token_end = v.second;
+                    token_color = p.second;
+                    break;
+                }
+            }
+        }
+
+        if (hasTokenizeResult == false) {
+            first++;
+        } else {
+            const size_t token_length = token_end - token_begin;
+
+            if (token_color == PaletteIndex::Identifier) {
+                id.assign(token_begin, token_end);
+
+                // todo : allmost all language definitions use lower case to specify keywords, so shouldn't this use ::tolower ?
+                if (!mLanguage->mDefinition->mCaseSensitive)
+                    std::transform(id.begin(), id.end(), id.begin(), ::toupper);
+
+                if (!styles[first - bufferBegin].mPreprocessor) {
+                    if (mLanguage->mDefinition->mKeywords.count(id) != 0)
+                        token_color = PaletteIndex::Keyword;
+                    else if (mLanguage->mDefinition->mIdentifiers.count(id) != 0)
+                        token_color = PaletteIndex::KnownIdentifier;
+                    else if (mLanguage->mDefinition->mPreprocIdentifiers.count(id) != 0)
+                        token_color = PaletteIndex::PreprocIdentifier;
+                } else {
+                    if (mLanguage->mDefinition->mPreprocIdentifiers.count(id) != 0)
+                        token_color = PaletteIndex::PreprocIdentifier;
+                }
+            }
+
+            for (size_t j = 0; j < token_length; ++j)
+                styles[(token_begin - bufferBegin) + j].mKind = token_color;
+
+            first = token_end;
+        }
+    }
+
+    // Collapse the styles into runs. A UTF-8 sequence takes its lead byte's style, so that no run splits a character.
+    auto& runs = aBuffers.mRuns;
+    runs.clear();
+    const size_t size = aLine.size();
+    size_t start = 0;
+    for (size_t i = 1; i <= size; ++i) {
+        const bool sequence = i < size && ((Char)aLine[i] & 0xC0) == 0x80;
+        if (sequence)
+            styles[i] = styles[i - 1];
+
+        const size_t length = i - start;
+        if (i == size || styles[i] != styles[start] || length == TokenRun::MaxLength || (length + 4 > TokenRun::MaxLength && !sequence)) {
+            runs.push_back(TokenRun{(uint32_t)start, (uint16_t)length, styles[start]});
+            start = i;
+        }
+    }
+
+    // Lines hold on to their runs, so they get an exactly sized copy rather than the scratch buffer's spare capacity
+    aLine.mRuns.assign(runs.begin(), runs.end());
+    aLine.mBlocks = ScanBlocks(aLine, state);
+
+    return state;
+}
+
+TextEditor::LineState TextEditor::ColorizeComments(const Line& aLine, LineState aState, Style* aStyles) const {
+    auto withinString = aState.mString;
+    auto inComment = aState.mMultiLineComment;
+    auto withinSingleLineComment = aState.mSingleLineComment;
+    auto withinPreproc = aState.mPreprocessor;
+    auto firstChar = aState.mFirstChar; // there is no other non-whitespace characters in the line before
+
+    auto& startStr = mLanguage->mDefinition->mCommentStart;
+    auto& singleStartStr = mLanguage->mDefinition->mSingleLineComment;
+    auto& endStr = mLanguage->mDefinition->mCommentEnd;
+
+    // When the single-line marker is a prefix of the multi-line one (Lua's "--" and "--[["), the longer one must win.
+    const bool startFirst = startStr.size() > singleStartStr.size() && startStr.compare(0, singleStartStr.size(), singleStartStr) == 0;
+
+    const char* text = aLine.data();
+    const int size = (int)aLine.size();
+
+    auto matches = [&](const std::string& aStr, int aIndex) {
+        return aStr.size() > 0 && aIndex + aStr.size() <= (size_t)size && text[aIndex] == aStr[0] &&
+               std::equal(aStr.begin(), aStr.end(), text + aIndex);
+    };
+
+    for (int currentIndex = 0; currentIndex < size;) {
+        auto c = (Char)text[currentIndex];
+
+        if (c != mLanguage->mDefinition->mPreprocChar && !isspace(c))
+            firstChar = false;
+
+        if (withinString) {
+            aStyles[currentIndex].mMultiLineComment = inComment;
+            aStyles[currentIndex].mComment = false;
+
+            if (c == '\"') {
+                if (currentIndex + 1 < size && text[currentIndex + 1] == '\"') {
+                    currentIndex += 1;
+                    aStyles[currentIndex].mMultiLineComment = inComment;
+                    aStyles[currentIndex].mComment = false;
+                } else
+                    withinString = false;
+            } else if (c == '\\') {
+                if (currentIndex + 1 < size) {
+                    currentIndex += 1;
+                    aStyles[currentIndex].mMultiLineComment = inComment;
+                    aStyles[currentIndex].mComment = false;
+                }
+            }
+        } else {
+            if (firstChar && c == mLanguage->mDefinition->mPreprocChar)
+                withinPreproc = true;
+
+            if (c == '\"' && !inComment && !withinSingleLineComment) {
+                withinString = true;
+                aStyles[currentIndex].mMultiLineComment = false;
+                aStyles[currentIndex].mComment = false;
+            } else {
+                if (!withinSingleLineComment && startFirst && matches(startStr, currentIndex)) {
+                    inComment = true;
+                } else if (matches(singleStartStr, currentIndex)) {
+                    withinSingleLineComment = true;
+                } else if (!withinSingleLineComment && matches(startStr, currentIndex)) {
+                    inComment = true;
+                }
+
+                aStyles[currentIndex].mMultiLineComment = inComment;
+                aStyles[currentIndex].mComment = withinSingleLineComment;
+
+                if (currentIndex + 1 >= (int)endStr.size() && matches(endStr, currentIndex + 1 - (int)endStr.size()))
+                    inComment = false;
+            }
+        }
+        aStyles[currentIndex].mPreprocessor = withinPreproc;
+        currentIndex += UTF8CharLength(text + currentIndex, text + size);
+    }
+
+    // '\' on the very end of the line carries its string, single-line comment or preprocessor directive onto the next one.
+    LineState next;
+    next.mMultiLineComment = inComment;
+    next.mConcatenate = !aLine.empty() && aLine.back() == '\\';
+    if (next.mConcatenate) {
+        next.mString = withinString;
+        next.mSingleLineComment = withinSingleLineComment;
+        next.mPreprocessor = withinPreproc;
+        next.mFirstChar = firstChar;
+    }
+    return next;
+}
+
+// The blocks a colorized line opens and closes, from its runs: brackets and the language's block keywords outside of
+// comments, strings and the like, and the start and end of a multi-line comment that spans lines.
+TextEditor::Blocks TextEditor::ScanBlocks(const Line& aLine, const LineState& aExitState, std::vector<BlockToken>* aTokens) const {
+    Blocks blocks;
+    auto add = [&](size_t aOffset, size_t aLength, bool aCloses, bool aOpens, char aBracket) {
+        if (aCloses) {
+            if (blocks.mOpens > 0)
+                --blocks.mOpens;
+            else
+                ++blocks.mCloses;
+        }
+        if (aOpens)
+            ++blocks.mOpens;
+        if (aTokens != nullptr)
+            aTokens->push_back(BlockToken{(uint32_t)aOffset, (uint32_t)aLength, aCloses, aOpens, aBracket});
+    };
+
+    const bool keywords = !mLanguage->mDefinition->mBlockStarts.empty() || !mLanguage->mDefinition->mBlockEnds.empty();
+    bool inComment = aLine.mEntryState.mMultiLineComment;
+    std::string word;
+    for (auto& run : aLine.mRuns) {
+        auto& style = run.mStyle;
+        if (style.mMultiLineComment != inComment) {
+            inComment = style.mMultiLineComment;
+            add(run.mOffset, 0, !inComment, inComment, '-');
+        }
+        if (style.mComment || style.mMultiLineComment)
+            continue;
+
+        const char* text = aLine.data() + run.mOffset;
+        if (style.mKind == PaletteIndex::Punctuation) {
+            for (size_t i = 0; i < run.mLength; ++i) {
+                if (text[i] == '(' || text[i] == '[' || text[i] == '{')
+                    add(run.mOffset + i, 1, false, true, text[i]);
+                else if (text[i] == ')' || text[i] == ']' || text[i] == '}')
+                    add(run.mOffset + i, 1, true, false, text[i]);
+            }
+        } else if (style.mKind == PaletteIndex::Keyword && keywords) {
+            word.assign(text, run.mLength);
+            if (!mLanguage->mDefinition->mCaseSensitive)
+                std::transform(word.begin(), word.end(), word.begin(), ::toupper);
+            const bool closes = mLanguage->mDefinition->mBlockEnds.count(word) != 0;
+            const bool opens = mLanguage->mDefinition->mBlockStarts.count(word) != 0;
+            if (closes || opens)
+                add(run.mOffset, run.mLength, closes, opens, 0);
+        }
+    }
+
+    // A comment that runs up to the end of the line ends there, or goes on to the next one
+    if (inComment != aExitState.mMultiLineComment)
+        add(aLine.size(), 0, inComment, !inComment, '-');
+    return blocks;
+}
+
+// The block tokens of a line as the colorizer left it
+void TextEditor::ScanBlockTokens(int aLine, std::vector<BlockToken>& aTokens) const {
+    aTokens.clear();
+    auto& line = mLines[aLine];
+    LineState exitState = line.mEntryState;
+    if (aLine + 1 < (int)mLines.size())
+        exitState = mLines[aLine + 1].mEntryState;
+    else if (!line.mRuns.empty())
+        exitState.mMultiLineComment = line.mRuns.back().mStyle.mMultiLineComment;
+    ScanBlocks(line, exitState, &aTokens);
+}
+
+void TextEditor::ColorizeInternal() {
+    if (mLines.empty() || !mColorizerEnabled)
+        return;
+
+    if (mBackgroundColorizer) {
+        ColorizeInBackground();
+        return;
+    }
+
+    if (mColorRangeMin >= mColorRangeMax)
+        return;
+
+    // Lines before mColorRangeMin are untouched, so the entry state of the line just above the range is still valid.
+    // Recolor from there through the range, then keep going only while the state flowing out of a line differs from
+    // what the next line had cached: a typical edit touches a line or two, while opening or closing a multi-line
+    // comment runs until the comment's extent stops changing. A long stretch is spread over several frames.
+    const int increment = (mLanguage->mDefinition->mTokenize == nullptr && mLanguage->mRegexDfa.IsEmpty()) ? 10 : 10000;
+    int currentLine = max(0, mColorRangeMin - 1);
+    auto lineIt = mLines.iterator_at(currentLine);
+    auto state = currentLine == 0 ? LineState() : lineIt->mEntryState;
+    mBlockMatch.mValid = false;
+    for (int count = 0; lineIt != mLines.end(); ++lineIt, ++currentLine, ++count) {
+        if (currentLine >= mColorRangeMax && lineIt->mEntryState == state)
+            break;
+
+        if (count == increment) {
+            mColorRangeMin = currentLine;
+            mColorRangeMax = max(mColorRangeMax, currentLine + 1);
+            return;
+        }
+
+        const auto blocks = lineIt->mBlocks;
+        lineIt->mEntryState = state;
+        state = ColorizeLine(*lineIt, state, mColorizeBuffers);
+        if (lineIt->mBlocks != blocks)
+            mLines.UpdateBlocks(currentLine);
+        HarvestSymbols(*lineIt);
+        IndexOutline(currentLine, *lineIt);
+    }
+
+    mColorRangeMin = 0;
+    mColorRangeMax = 0;
+}
+
+void TextEditor::ColorizeInBackground() {
+    if (mColorizeJobBusy) {
+        {
+            std::scoped_lock _{mColorizeMutex};
+            if (!mColorizeJob.mDone)
+                return;
+            mColorizeJobBusy = false;
+        }
+        MergeColorizeJob();
+    }
+
+    if (mColorRangeMin >= mColorRangeMax)
+        return;
+
+    // Like the synchronous pass, the chunk starts one line early for a valid entry state
+    const int increment = (mLanguage->mDefinition->mTokenize == nullptr && mLanguage->mRegexDfa.IsEmpty()) ? 256 : 4096;
+    const int first = max(0, mColorRangeMin - 1);
+    const int last = min(min(mColorRangeMax, first + increment), (int)mLines.size());
+
+    mColorRangeMin = last;
+    if (mColorRangeMin >= mColorRangeMax) {
+        mColorRangeMin = 0;
+        mColorRangeMax = 0;
+    }
+
+    if (first >= last)
+        return;
+
+    // Copy the chunk's text, reusing the job's line buffers from last time; the worker only touches it while it's busy
+    auto& job = mColorizeJob;
+    job.mVersion = mVersion;
+    job.mLines.resize(last - first);
+    auto lineIt = mLines.iterator_at(first);
+    for (auto& line : job.mLines) {
+        line.assign(*lineIt);
+        line.mEntryState = lineIt->mEntryState;
+        ++lineIt;
+    }
+    if (first == 0)
+        job.mLines.front().mEntryState = LineState();
+
+    mColorizeJobMin = first;
+    mColorizeJobMax = last;
+    mColorizeJobTorn = false;
+    {
+        std::scoped_lock _{mColorizeMutex};
+        job.mDone = false;
+        mColorizeJobBusy = true;
+    }
+
+    if (!mColorizeThread.joinable())
+        mColorizeThread = std::thread(&TextEditor::ColorizeThread, this);
+    mColorizeCondition.notify_all();
+}
+
+void TextEditor::MergeColorizeJob() {
+    auto& job = mColorizeJob;
+
+    // Lines came or went in the middle of the chunk, so its results can't be matched back: queue it again
+    if (mColorizeJobTorn) {
+        QueueColorize(mColorizeJobMin, min(mColorizeJobMax, (int)mLines.size()));
+        return;
+    }
+
+    const int count = min((int)job.mLines.size(), (int)mLines.size() - mColorizeJobMin);
+    if (count <= 0)
+        return;
+
+    mBlockMatch.mValid = false;
+    auto lineIt = mLines.iterator_at(mColorizeJobMin);
+    for (int i = 0; i < count; ++i, ++lineIt) {
+        auto& line = *lineIt;
+        auto& result = job.mLines[i];
+
+        // Edited since the snapshot: the edit has already queued the line again
+        if (line.mRevision > job.mVersion)
+            continue;
+
+        // Same text as the copy, so take its runs as they are; the old ones are reused by the next job
+        line.mRuns.swap(result.mRuns);
+        line.mEntryState = result.mEntryState;
+        line.mDrawId = 0;
+        if (line.mBlocks != result.mBlocks) {
+            line.mBlocks = result.mBlocks;
+            mLines.UpdateBlocks(mColorizeJobMin + i);
+        }
+        HarvestSymbols(line);
+        IndexOutline(mColorizeJobMin + i, line);
+    }
+
+    // What flows out of the chunk changed, so the lines after it need another pass. Like the synchronous pass this
+    // runs until the state converges, in chunks that double each time.
+    const int next = mColorizeJobMin + count;
+    if (count == (int)job.mLines.size() && next < (int)mLines.size() && lineIt->mEntryState != job.mExitState)
+        QueueColorize(next, min(next + 2 * count, (int)mLines.size()));
+}
+
+// Waits for the chunk out with the background colorizer, if any, and queues its lines again.
+void TextEditor::CancelColorizeJob() {
+    if (!mColorizeJobBusy)
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(mColorizeMutex);
+        mColorizeCondition.wait(lock, [this] { return mColorizeJob.mDone; });
+        mColorizeJobBusy = false;
+    }
+    QueueColorize(mColorizeJobMin, min(mColorizeJobMax, (int)mLines.size()));
+}
+
+void TextEditor::ColorizeThread() {
+    ColorizeBuffers buffers;
+    std::unique_lock<std::mutex> lock(mColorizeMutex);
+    for (;;) {
+        mColorizeCondition.wait(lock, [this] { return mColorizeQuit || (mColorizeJobBusy && !mColorizeJob.mDone); });
+        if (mColorizeQuit)
+            return;
+
+        lock.unlock();
+        auto& job = mColorizeJob;
+        auto state = job.mLines.front().mEntryState;
+        for (auto& line : job.mLines) {
+            line.mEntryState = state;
+            state = ColorizeLine(line, state, buffers);
+        }
+        job.mExitState = state;
+        lock.lock();
+
+        job.mDone = true;
+        mColorizeCondition.notify_all();
+    }
+}
+
+float TextEditor::TextDistanceToLineStart(const Coordinates& aFrom) const {
+    auto& line = mLines[aFrom.mLine];
+    float distance = 0.0f;
+    float spaceSize = ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), FLT_MAX, -1.0f, " ", nullptr, nullptr).x;
+    int colIndex = GetCharacterIndex(aFrom);
+    size_t it = 0u;
+    if (auto index = GetColumnIndexX(line)) {
+        if ((size_t)colIndex >= line.size())
+            return index->mWidth;
+        auto stop = std::upper_bound(index->mStops.begin(), index->mStops.end(), colIndex,
+            [](int aOffset, const Line::ColumnStop& aStop) { return aOffset < (int)aStop.mIndex; });
+        if (stop != index->mStops.begin()) {
+            --stop;
+            distance = stop->mX;
+            it = stop->mIndex;
+        }
+    }
+    for (; it < line.size() && it < colIndex;) {
+        distance = AdvanceX(line, it, distance, spaceSize);
+        it += UTF8CharLength(line, it);
+    }
+
+    return distance;
+}
+
+// Like TextDistanceToLineStart, from the start of the row of the line aFrom is on, which goes to aRow
+float TextEditor::TextDistanceToRowStart(const Coordinates& aFrom, int& aRow) const {
+    aRow = 0;
+    auto wrap = GetWrap(aFrom.mLine);
+    if (wrap == nullptr)
+        return TextDistanceToLineStart(aFrom);
+
+    auto& line = mLines[aFrom.mLine];
+    const size_t index = min((size_t)GetCharacterIndex(aFrom), line.size());
+    aRow = (int)(std::upper_bound(wrap->mRowStarts.begin(), wrap->mRowStarts.end(), (uint32_t)index) - wrap->mRowStarts.begin());
+    float spaceSize = ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), FLT_MAX, -1.0f, " ", nullptr, nullptr).x;
+    float distance = 0.0f;
+    for (size_t it = aRow > 0 ? wrap->mRowStarts[aRow - 1] : 0; it < index;) {
+        distance = AdvanceX(line, it, distance, spaceSize);
+        it += UTF8CharLength(line, it);
+    }
+    return distance;
+}
+
+// Pixel x after the character at aIndex if it starts at aX; a tab extends to the next tab stop.
+float TextEditor::AdvanceX(const Line& aLine, size_t aIndex, float aX, float aSpaceSize) const {
+    if (aLine[aIndex] == '\t')
+        return (1.0f + std::floor((1.0f + aX) / (float(mTabSize) * aSpaceSize))) * (float(mTabSize) * aSpaceSize);
+    return aX + GetCharacterWidth(aLine, aIndex);
+}
+
+float TextEditor::GetCharacterWidth(const Line& aLine, size_t aIndex) const {
+    auto d = UTF8CharLength(aLine, aIndex);
+    char tempCString[7];
+    int i = 0;
+    for (; i < 6 && d-- > 0 && aIndex < aLine.size(); i++, aIndex++)
+        tempCString[i] = aLine[aIndex];
+
+    tempCString[i] = '\0';
+    return ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), FLT_MAX, -1.0f, tempCString, nullptr, nullptr).x;
+}
+
+void TextEditor::EnsureCursorVisible() {
+    RevealLine(GetActualCursorCoordinates().mLine);
+
+    if (!mWithinRender) {
+        mScrollToCursor = true;
+        return;
+    }
+
+    float scrollX = ImGui::GetScrollX();
+    float scrollY = ImGui::GetScrollY();
+
+    auto height = ImGui::GetWindowHeight();
+    auto width = ImGui::GetWindowWidth();
+
+    auto top = 1 + (int)ceil(scrollY / mCharAdvance.y);
+    auto bottom = (int)ceil((scrollY + height) / mCharAdvance.y);
+
+    auto left = (int)ceil(scrollX / mCharAdvance.x);
+    auto right = (int)ceil((scrollX + width) / mCharAdvance.x);
+
+    auto pos = GetActualCursorCoordinates();
+    int rowInLine;
+    auto len = TextDistanceToRowStart(pos, rowInLine);
+    auto row = (int)mLines.GetFirstRow(pos.mLine) + rowInLine;
+
+    if (row < top)
+        ImGui::SetScrollY(max(0.0f, (row - 1) * mCharAdvance.y));
+    if (row > bottom - 4)
+        ImGui::SetScrollY(max(0.0f, (row + 4) * mCharAdvance.y - height));
+    if (len + mTextStart < left + 4)
+        ImGui::SetScrollX(max(0.0f, len + mTextStart - 4));
+    if (len + mTextStart > right - 4)
+        ImGui::SetScrollX(max(0.0f, len + mTextStart + 4 - width));
+}
+
+int TextEditor::GetPageSize() const {
+    auto height = ImGui::GetWindowHeight() - 20.0f;
+    return (int)floor(height / mCharAdvance.y);
+}
+
+TextEditor::UndoRecord::UndoRecord(const std::string& aAdded, const TextEditor::Coordinates aAddedStart,
+    const TextEditor::Coordinates aAddedEnd, const std::string& aRemoved, const TextEditor::Coordinates aRemovedStart,
+    const TextEditor::Coordinates aRemovedEnd, TextEditor::EditorState& aBefore, TextEditor::EditorState& aAfter)
+    : mAdded(aAdded)
+    , mAddedStart(aAddedStart)
+    , mAddedEnd(aAddedEnd)
+    , mRemoved(aRemoved)
+    , mRemovedStart(aRemovedStart)
+    , mRemovedEnd(aRemovedEnd)
+    , mBefore(aBefore)
+    , mAfter(aAfter) {
+    assert(mAddedStart <= mAddedEnd);
+    assert(mRemovedStart <= mRemovedEnd);
+}
+
+void TextEditor::UndoRecord::UndoText(TextEditor* aEditor, bool aColorize) const {
+    if (!mAdded.empty()) {
+        aEditor->RecordTextChange(mAddedStart, aEditor->GetText(mAddedStart, mAddedEnd), std::string());
+        aEditor->DeleteRange(mAddedStart, mAddedEnd);
+        if (aColorize)
+            aEditor->Colorize(mAddedStart.mLine - 1, mAddedEnd.mLine - mAddedStart.mLine + 2);
+    }
+
+    if (!mRemoved.empty()) {
+        auto start = mRemovedStart;
+        aEditor->RecordTextChange(start, std::string(), mRemoved);
+        aEditor->InsertTextAt(start, mRemoved.c_str());
+        if (aColorize)
+            aEditor->Colorize(mRemovedStart.mLine - 1, mRemovedEnd.mLine - mRemovedStart.mLine + 2);
+    }
+}
+
+void TextEditor::UndoRecord::RedoText(TextEditor* aEditor, bool aColorize) const {
+    if (!mRemoved.empty()) {
+        aEditor->RecordTextChange(mRemovedStart, aEditor->GetText(mRemovedStart, mRemovedEnd), std::string());
+        aEditor->DeleteRange(mRemovedStart, mRemovedEnd);
+        if (aColorize)
+            aEditor->Colorize(mRemovedStart.mLine - 1, mRemovedEnd.mLine - mRemovedStart.mLine + 2);
+    }
+
+    if (!mAdded.empty()) {
+        auto start = mAddedStart;
+        aEditor->RecordTextChange(start, std::string(), mAdded);
+        aEditor->InsertTextAt(start, mAdded.c_str());
+        if (aColorize)
+            aEditor->Colorize(mAddedStart.mLine - 1, mAddedEnd.mLine - mAddedStart.mLine + 2);
+    }
+}
+
+void TextEditor::UndoRecord::Undo(TextEditor* aEditor) {
+    if (!mPrefixes.empty()) {
+        aEditor->EditLinePrefixes(*this, true);
+    } else if (mBatch.empty()) {
+        UndoText(aEditor, true);
+    } else {
+        // Back from the last cursor's edit, then the lines from the first edit to the last colorized at once. Taking
+        // back an edit moves the lines after it by the lines it had added or removed.
+        int last = mBatch.back().mRemovedEnd.mLine;
+        for (auto it = mBatch.rbegin(); it != mBatch.rend(); ++it) {
+            it->UndoText(aEditor, false);
+            if (it != mBatch.rbegin())
+                last += (it->mRemovedEnd.mLine - it->mRemovedStart.mLine) - (it->mAddedEnd.mLine - it->mAddedStart.mLine);
+        }
+        const int first = mBatch.front().mRemovedStart.mLine;
+        aEditor->Colorize(first - 1, last - first + 3);
+    }
+
+    aEditor->mState = mBefore;
+    aEditor->EnsureCursorVisible();
+}
+
+void TextEditor::UndoRecord::Redo(TextEditor* aEditor) {
+    if (!mPrefixes.empty()) {
+        aEditor->EditLinePrefixes(*this, false);
+    } else if (mBatch.empty()) {
+        RedoText(aEditor, true);
+    } else {
+        for (auto& edit : mBatch)
+            edit.RedoText(aEditor, false);
+        const int first = mBatch.front().mAddedStart.mLine;
+        aEditor->Colorize(first - 1, mBatch.back().mAddedEnd.mLine - first + 3);
+    }
+
+    aEditor->mState = mAfter;
+    aEditor->EnsureCursorVisible();
+}
+
+static bool TokenizeCStyleString(const char* in_begin, const char* in_end, const char*& out_begin, const char*& out_end) {
+    const char* p = in_begin;
+
+    if (*p == '"') {
+        p++;
+
+        while (p < in_end) {
+            // handle end of string
+            if (*p == '"') {
+                out_begin = in_begin;
+                out_end = p + 1;
+                return true;
+            }
+
+            // handle escape character for "
+            if (*p == '\\' && p + 1 < in_end && p[1] == '"')
+                p++;
+
+            p++;
+        }
+    }
+
+    return false;
+}
+
+static bool TokenizeCStyleCharacterLiteral(const char* in_begin, const char* in_end, const char*& out_begin, const char*& out_end) {
+    const char* p = in_begin;
+
+    if (*p == '\'') {
+        p++;
+
+        // handle escape characters
+        if (p < in_end && *p == '\\')
+            p++;
+
+        if (p < in_end)
+            p++;
+
+        // handle end of character literal
+        if (p < in_end && *p == '\'') {
+            out_begin = in_begin;
+            out_end = p + 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool TokenizeCStyleIdentifier(const char* in_begin, const char* in_end, const char*& out_begin, const char*& out_end) {
+    const char* p = in_begin;
+
+    if ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || *p == '_') {
+        p++;
+
+        while ((p < in_end) && ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9') || *p == '_'))
+            p++;
+
+        out_begin = in_begin;
+        out_end = p;
+        return true;
+    }
+
+    return false;
+}
+
+static bool TokenizeCStyleNumber(const char* in_begin, const char* in_end, const char*& out_begin, const char*& out_end) {
+    const char* p = in_begin;
+
+    const bool startsWithNumber = *p >= '0' && *p <= '9';
+
+    if (*p != '+' && *p != '-' && !startsWithNumber)
+        return false;
+
+    p++;
+
+    bool hasNumber = startsWithNumber;
+
+    while (p < in_end && (*p >= '0' && *p <= '9')) {
+        hasNumber = true;
+
+        p++;
+    }
+
+    if (hasNumber == false)
+        return false;
+
+    bool isFloat = false;
+    bool isHex = false;
+    bool isBinary = false;
+
+    if (p < in_end) {
+        if (*p == '.') {
+            isFloat = true;
+
+            p++;
+
+            while (p < in_end && (*p >= '0' && *p <= '9'))
+                p++;
+        } else if (*p == 'x' || *p == 'X') {
+            // hex formatted integer of the type 0xef80
+
+            isHex = true;
+
+            p++;
+
+            while (p < in_end && ((*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'f') || (*p >= 'A' && *p <= 'F')))
+                p++;
+        } else if (*p == 'b' || *p == 'B') {
+            // binary formatted integer of the type 0b01011101
+
+            isBinary = true;
+
+            p++;
+
+            while (p < in_end && (*p >= '0' && *p <= '1'))
+                p++;
+        }
+    }
+
+    if (isHex == false && isBinary == false) {
+        // floating point exponent
+        if (p < in_end && (*p == 'e' || *p == 'E')) {
+            isFloat = true;
+
+            p++;
+
+            if (p < in_end && (*p == '+' || *p == '-'))
+                p++;
+
+            bool hasDigits = false;
+
+            while (p < in_end && (*p >= '0' && *p <= '9')) {
+                hasDigits = true;
+
+                p++;
+            }
+
+            if (hasDigits == false)
+                return false;
+        }
+
+        // single precision floating point type
+        if (p < in_end && *p == 'f')
+            p++;
+    }
+
+    if (isFloat == false) {
+        // integer size type
+        while (p < in_end && (*p == 'u' || *p == 'U' || *p == 'l' || *p == 'L'))
+            p++;
+    }
+
+    out_begin = in_begin;
+    out_end = p;
+    return true;
+}
+
+static bool TokenizeCStylePunctuation(const char* in_begin, const char* in_end, const char*& out_begin, const char*& out_end) {
+    (void)in_end;
+
+    switch (*in_begin) {
+    case '[':
+    case ']':
+    case '{':
+    case '}':
+    case '!':
+    case '%':
+    case '^':
+    case '&':
+    case '*':
+    case '(':
+    case ')':
+    case '-':
+    case '+':
+    case '=':
+    case '~':
+    case '|':
+    case '<':
+    case '>':
+    case '?':
+    case ':':
+    case '/':
+    case ';':
+    case ',':
+    case '.':
+        out_begin = in_begin;
+        out_end = in_begin + 1;
+        return true;
+    }
+
+    return false;
+}
+
+// Returns the level of a Lua long bracket opening at in_begin ("[[" is level 0, "[==[" is level 2), or -1.
+static int LuaLongBracketLevel(const char* in_begin, const char* in_end) {
+    const char* p = in_begin;
+
+    if (p >= in_end || *p != '[')
+        return -1;
+
+    p++;
+
+    int level = 0;
+    while (p < in_end && *p == '=') {
+        level++;
+        p++;
+    }
+
+    return p < in_end && *p == '[' ? level : -1;
+}
+
+// Finds the "]" "="*level "]" closing a long bracket; returns a pointer past it, or nullptr if the line doesn't close it.
+static const char* FindLuaLongBracketClose(const char* in_begin, const char* in_end, int level) {
+    for (const char* p = in_begin; p < in_end; p++) {
+        if (*p != ']')
+            continue;
+
+        const char* q = p + 1;
+        int n = 0;
+        while (q < in_end && *q == '=' && n < level) {
+            n++;
+            q++;
+        }
+
+        if (n == level && q < in_end && *q == ']')
+            return q + 1;
+    }
+
+    return nullptr;
+}
+
+static bool TokenizeLuaStyleLongComment(const char* in_begin, const char* in_end, const char*& out_begin, const char*& out_end) {
+    const char* p = in_begin;
+
+    if (p + 1 >= in_end || p[0] != '-' || p[1] != '-')
+        return false;
+
+    const int level = LuaLongBracketLevel(p + 2, in_end);
+    if (level < 0)
+        return false;
+
+    // --[[ long comment ]], or its unterminated start
+    const char* close = FindLuaLongBracketClose(p + level + 4, in_end, level);
+
+    out_begin = in_begin;
+    out_end = close != nullptr ? close : in_end;
+    return true;
+}
+
+static bool TokenizeLuaStyleComment(const char* in_begin, const char* in_end, const char*& out_begin, const char*& out_end) {
+    const char* p = in_begin;
+
+    if (p + 1 >= in_end || p[0] != '-' || p[1] != '-')
+        return false;
+
+    out_begin = in_begin;
+    out_end = in_end;
+    return true;
+}
+
+static bool TokenizeLuaStyleString(const char* in_begin, const char* in_end, const char*& out_begin, const char*& out_end) {
+    const char* p = in_begin;
+
+    if (*p == '"' || *p == '\'') {
+        const char quote = *p;
+
+        p++;
+
+        while (p < in_end) {
+            // handle end of string
+            if (*p == quote) {
+                out_begin = in_begin;
+                out_end = p + 1;
+                return true;
+            }
+
+            // handle escape sequences, including an escaped quote
+            if (*p == '\\' && p + 1 < in_end)
+                p++;
+
+            p++;
+        }
+
+        // unterminated, highlight the rest of the line as a string
+        out_begin = in_begin;
+        out_end = in_end;
+        return true;
+    }
+
+    return false;
+}
+
+static bool TokenizeLuaStyleLongString(const char* in_begin, const char* in_end, const char*& out_begin, const char*& out_end) {
+    const int level = LuaLongBracketLevel(in_begin, in_end);
+
+    if (level < 0)
+        return false;
+
+    const char* close = FindLuaLongBracketClose(in_begin + level + 2, in_end, level);
+
+    out_begin = in_begin;
+    out_end = close != nullptr ? close : in_end;
+    return true;
+}
+
+static bool TokenizeLuaStyleNumber(const char* in_begin, const char* in_end, const char*& out_begin, const char*& out_end) {
+    const char* p = in_begin;
+
+    const auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+    const auto isHexDigit = [](char c) { return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); };
+
+    if (!isDigit(*p) && !(*p == '.' && p + 1 < in_end && isDigit(p[1])))
+        return false;
+
+    if (*p == '0' && p + 1 < in_end && (p[1] == 'x' || p[1] == 'X')) {
+        // hexadecimal, with optional fraction and binary exponent: 0xA, 0x1.8p3
+        p += 2;
+
+        while (p < in_end && isHexDigit(*p))
+            p++;
+
+        if (p < in_end && *p == '.') {
+            p++;
+
+            while (p < in_end && isHexDigit(*p))
+                p++;
+        }
+
+        if (p < in_end && (*p == 'p' || *p == 'P')) {
+            const char* exponent = p + 1;
+
+            if (exponent < in_end && (*exponent == '+' || *exponent == '-'))
+                exponent++;
+
+            if (exponent < in_end && isDigit(*exponent)) {
+                p = exponent;
+
+                while (p < in_end && isDigit(*p))
+                    p++;
+            }
+        }
+    } else {
+        // decimal: 3, 3.0, .5, 3e-2
+        while (p < in_end && isDigit(*p))
+            p++;
+
+        if (p < in_end && *p == '.' && !(p + 1 < in_end && p[1] == '.')) {
+            p++;
+
+            while (p < in_end && isDigit(*p))
+                p++;
+        }
+
+        if (p < in_end && (*p == 'e' || *p == 'E')) {
+            const char* exponent = p + 1;
+
+            if (exponent < in_end && (*exponent == '+' || *exponent == '-'))
+                exponent++;
+
+            if (exponent < in_end && isDigit(*exponent)) {
+                p = exponent;
+
+                while (p < in_end && isDigit(*p))
+                    p++;
+            }
+        }
+    }
+
+    out_begin = in_begin;
+    out_end = p;
+    return true;
+}
+
+static bool TokenizeLuaStylePunctuation(const char* in_begin, const char* in_end, const char*& out_begin, const char*& out_end) {
+    const char* p = in_begin;
+    const char next = p + 1 < in_end ? p[1] : '\0';
+
+    out_begin = in_begin;
+
+    switch (*p) {
+    case '.':
+        // concatenation and varargs
+        if (next == '.') {
+            out_end = p + 2 < in_end && p[2] == '.' ? p + 3 : p + 2;
+            return true;
+        }
+        out_end = p + 1;
+        return true;
+    case '=':
+    case '~':
+    case '<':
+    case '>':
+        if (next == '=' || (*p == '<' && next == '<') || (*p == '>' && next == '>')) {
+            out_end = p + 2;
+            return true;
+        }
+        out_end = p + 1;
+        return true;
+    case '/':
+    case ':':
+        out_end = next == *p ? p + 2 : p + 1;
+        return true;
+    case '+':
+    case '-':
+    case '*':
+    case '%':
+    case '^':
+    case '#':
+    case '&':
+    case '|':
+    case '(':
+    case ')':
+    case '{':
+    case '}':
+    case '[':
+    case ']':
+    case ';':
+    case ',':
+        out_end = p + 1;
+        return true;
+    }
+
+    return false;
+}
+
+const TextEditor::LanguageDefinition& TextEditor::LanguageDefinition::CPlusPlus() {
+    static bool inited = false;
+    static LanguageDefinition langDef;
+    if (!inited) {
+        static const char* const cppKeywords[] = {"alignas", "alignof", "and", "and_eq", "asm", "atomic_cancel", "atomic_commit",
+            "atomic_noexcept", "auto", "bitand", "bitor", "bool", "break", "case", "catch", "char", "char16_t", "char32_t", "class",
+            "compl", "concept", "const", "constexpr", "const_cast", "continue", "decltype", "default", "delete", "do", "double",
+            "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "float", "for", "friend", "goto", "if", "import",
+            "inline", "int", "long", "module", "mutable", "namespace", "new", "noexcept", "not", "not_eq", "nullptr", "operator", "or",
+            "or_eq", "private", "protected", "public", "register", "reinterpret_cast", "requires", "return", "short", "signed", "sizeof",
+            "static", "static_assert", "static_cast", "struct", "switch", "synchronized", "template", "this", "thread_local", "throw",
+            "true", "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while",
+            "xor", "xor_eq"};
+        for (auto& k : cppKeywords)
+            langDef.mKeywords.insert(k);
+
+        static const char* const identifiers[] = {"abort", "abs", "acos", "asin", "atan", "atexit", "atof", "atoi", "atol", "ceil", "clock",
+            "cosh", "ctime", "div", "exit", "fabs", "floor", "fmod", "getchar", "getenv", "isalnum", "isalpha", "isdigit", "isgraph",
+            "ispunct", "isspace", "isupper", "kbhit", "log10", "log2", "log", "memcmp", "modf", "pow", "printf", "sprintf", "snprintf",
+            "putchar", "putenv", "puts", "rand", "remove", "rename", "sinh", "sqrt", "srand", "strcat", "strcmp", "strerror", "time",
+            "tolower", "toupper", "std", "string", "vector", "map", "unordered_map", "set", "unordered_set", "min", "max"};
+        for (auto& k : identifiers) {
+            Identifier id;
+            id.mDeclaration = "Built-in function";
+            langDef.mIdentifiers.insert(std::make_pair(std::string(k), id));
+        }
+
+        langDef.mTokenize = [](const char* in_begin, const char* in_end, const char*& out_begin, const char*& out_end,
+                                PaletteIndex& paletteIndex) -> bool {
+            paletteIndex = PaletteIndex::Max;
+
+            while (in_begin < in_end && isascii(*in_begin) && isblank(*in_begin))
+                in_begin++;
+
+            if (in_begin == in_end) {
+                out_begin = in_end;
+                out_end = in_end;
+                paletteIndex = PaletteIndex::Default;
+            } else if (TokenizeCStyleString(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::String;
+            else if (TokenizeCStyleCharacterLiteral(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::CharLiteral;
+            else if (TokenizeCStyleIdentifier(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::Identifier;
+            else if (TokenizeCStyleNumber(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::Number;
+            else if (TokenizeCStylePunctuation(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::Punctuation;
+
+            return paletteIndex != PaletteIndex::Max;
+        };
+
+        langDef.mCommentStart = "/*";
+        langDef.mCommentEnd = "*/";
+        langDef.mSingleLineComment = "//";
+
+        langDef.mCaseSensitive = true;
+        langDef.mAutoIndentation = true;
+
+        langDef.mName = "C++";
+
+        GetBuiltinDefinitions().insert(&langDef);
+        inited = true;
+    }
+    return langDef;
+}
+
+const TextEditor::LanguageDefinition& TextEditor::LanguageDefinition::HLSL() {
+    static bool inited = false;
+    static LanguageDefinition langDef;
+    if (!inited) {
+        static const char* const keywords[] = {
+            "AppendStructuredBuffer",
+            "asm",
+            "asm_fragment",
+            "BlendState",
+            "bool",
+            "break",
+            "Buffer",
+            "ByteAddressBuffer",
+            "case",
+            "cbuffer",
+            "centroid",
+            "class",
+            "column_major",
+            "compile",
+            "compile_fragment",
+            "CompileShader",
+            "const",
+            "continue",
+            "ComputeShader",
+            "ConsumeStructuredBuffer",
+            "default",
+            "DepthStencilState",
+            "DepthStencilView",
+            "discard",
+            "do",
+            "double",
+            "DomainShader",
+            "dword",
+            "else",
+            "export",
+            "extern",
+            "false",
+            "float",
+            "for",
+            "fxgroup",
+            "GeometryShader",
+            "groupshared",
+            "half",
+            "Hullshader",
+            "if",
+            "in",
+            "inline",
+            "inout",
+            "InputPatch",
+            "int",
+            "interface",
+            "line",
+            "lineadj",
+            "linear",
+            "LineStream",
+            "matrix",
+            "min16float",
+            "min10float",
+            "min16int",
+            "min12int",
+            "min16uint",
+            "namespace",
+            "nointerpolation",
+            "noperspective",
+            "NULL",
+            "out",
+            "OutputPatch",
+            "packoffset",
+            "pass",
+            "pixelfragment",
+            "PixelShader",
+            "point",
+            "PointStream",
+            "precise",
+            "RasterizerState",
+            "RenderTargetView",
+            "return",
+            "register",
+            "row_major",
+            "RWBuffer",
+            "RWByteAddressBuffer",
+            "RWStructuredBuffer",
+            "RWTexture1D",
+            "RWTexture1DArray",
+            "RWTexture2D",
+            "RWTexture2DArray",
+            "RWTexture3D",
+            "sample",
+            "sampler",
+            "SamplerState",
+            "SamplerComparisonState",
+            "shared",
+            "snorm",
+            "stateblock",
+            "stateblock_state",
+            "static",
+            "string",
+            "struct",
+            "switch",
+            "StructuredBuffer",
+            "tbuffer",
+            "technique",
+            "technique10",
+            "technique11",
+            "texture",
+            "Texture1D",
+            "Texture1DArray",
+            "Texture2D",
+            "Texture2DArray",
+            "Texture2DMS",
+            "Texture2DMSArray",
+            "Texture3D",
+            "TextureCube",
+            "TextureCubeArray",
+            "true",
+            "typedef",
+            "triangle",
+            "triangleadj",
+            "TriangleStream",
+            "uint",
+            "uniform",
+            "unorm",
+            "unsigned",
+            "vector",
+            "vertexfragment",
+            "VertexShader",
+            "void",
+            "volatile",
+            "while",
+            "bool1",
+            "bool2",
+            "bool3",
+            "bool4",
+            "double1",
+            "double2",
+            "double3",
+            "double4",
+            "float1",
+            "float2",
+            "float3",
+            "float4",
+            "int1",
+            "int2",
+            "int3",
+            "int4",
+            "in",
+            "out",
+            "inout",
+            "uint1",
+            "uint2",
+            "uint3",
+            "uint4",
+            "dword1",
+            "dword2",
+            "dword3",
+            "dword4",
+            "half1",
+            "half2",
+            "half3",
+            "half4",
+            "float1x1",
+            "float2x1",
+            "float3x1",
+            "float4x1",
+            "float1x2",
+            "float2x2",
+            "float3x2",
+            "float4x2",
+            "float1x3",
+            "float2x3",
+            "float3x3",
+            "float4x3",
+            "float1x4",
+            "float2x4",
+            "float3x4",
+            "float4x4",
+            "half1x1",
+            "half2x1",
+            "half3x1",
+            "half4x1",
+            "half1x2",
+            "half2x2",
+            "half3x2",
+            "half4x2",
+            "half1x3",
+            "half2x3",
+            "half3x3",
+            "half4x3",
+            "half1x4",
+            "half2x4",
+            "half3x4",
+            "half4x4",
+        };
+        for (auto& k : keywords)
+            langDef.mKeywords.insert(k);
+
+        static const char* const identifiers[] = {"abort", "abs", "acos", "all", "AllMemoryBarrier", "AllMemoryBarrierWithGroupSync", "any",
+            "asdouble", "asfloat", "asin", "asint", "asint", "asuint", "asuint", "atan", "atan2", "ceil", "CheckAccessFullyMapped", "clamp",
+            "clip", "cos", "cosh", "countbits", "cross", "D3DCOLORtoUBYTE4", "ddx", "ddx_coarse", "ddx_fine", "ddy", "ddy_coarse",
+            "ddy_fine", "degrees", "determinant", "DeviceMemoryBarrier", "DeviceMemoryBarrierWithGroupSync", "distance", "dot", "dst",
+            "errorf", "EvaluateAttributeAtCentroid", "EvaluateAttributeAtSample", "EvaluateAttributeSnapped", "exp", "exp2", "f16tof32",
+            "f32tof16", "faceforward", "firstbithigh", "firstbitlow", "floor", "fma", "fmod", "frac", "frexp", "fwidth",
+            "GetRenderTargetSampleCount", "GetRenderTargetSamplePosition", "GroupMemoryBarrier", "GroupMemoryBarrierWithGroupSync",
+            "InterlockedAdd", "InterlockedAnd", "InterlockedCompareExchange", "InterlockedCompareStore", "InterlockedExchange",
+            "InterlockedMax", "InterlockedMin", "InterlockedOr", "InterlockedXor", "isfinite", "isinf", "isnan", "ldexp", "length", "lerp",
+            "lit", "log", "log10", "log2", "mad", "max", "min", "modf", "msad4", "mul", "noise", "normalize", "pow", "printf",
+            "Process2DQuadTessFactorsAvg", "Process2DQuadTessFactorsMax", "Process2DQuadTessFactorsMin", "ProcessIsolineTessFactors",
+            "ProcessQuadTessFactorsAvg", "ProcessQuadTessFactorsMax", "ProcessQuadTessFactorsMin", "ProcessTriTessFactorsAvg",
+            "ProcessTriTessFactorsMax", "ProcessTriTessFactorsMin", "radians", "rcp", "reflect", "refract", "reversebits", "round", "rsqrt",
+            "saturate", "sign", "sin", "sincos", "sinh", "smoothstep", "sqrt", "step", "tan", "tanh", "tex1D", "tex1D", "tex1Dbias",
+            "tex1Dgrad", "tex1Dlod", "tex1Dproj", "tex2D", "tex2D", "tex2Dbias", "tex2Dgrad", "tex2Dlod", "tex2Dproj", "tex3D", "tex3D",
+            "tex3Dbias", "tex3Dgrad", "tex3Dlod", "tex3Dproj", "texCUBE", "texCUBE", "texCUBEbias", "texCUBEgrad", "texCUBElod",
+            "texCUBEproj", "transpose", "trunc"};
+        for (auto& k : identifiers) {
+            Identifier id;
+            id.mDeclaration = "Built-in function";
+            langDef.mIdentifiers.insert(std::make_pair(std::string(k), id));
+        }
+
+        langDef.mTokenRegexStrings.push_back(
+            std::make_pair<std::string, PaletteIndex>("[ \\t]*#[ \\t]*[a-zA-Z_]+", PaletteIndex::Preprocessor));
+        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("L?\\\"(\\\\.|[^\\\"])*\\\"", PaletteIndex::String));
+        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("\\'\\\\?[^\\']\\'", PaletteIndex::CharLiteral));
+        langDef.mTokenRegexStrings.push_back(
+            std::make_pair<std::string, PaletteIndex>("[+-]?([0-9]+([.][0-9]*)?|[.][0-9]+)([eE][+-]?[0-9]+)?[fF]?", PaletteIndex::Number));
+        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[+-]?[0-9]+[Uu]?[lL]?[lL]?", PaletteIndex::Number));
+        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("0[0-7]+[Uu]?[lL]?[lL]?", PaletteIndex::Number));
+        langDef.mTokenRegexStrings.push_back(
+            std::make_pair<std::string, PaletteIndex>("0[xX][0-9a-fA-F]+[uU]?[lL]?[lL]?", PaletteIndex::Number));
+        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[a-zA-Z_][a-zA-Z0-9_]*", PaletteIndex::Identifier));
+        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>(
+            "[\\[\\]\\{\\}\\!\\%\\^\\&\\*\\(\\)\\-\\+\\=\\~\\|\\<\\>\\?\\/\\;\\,\\.]", PaletteIndex::Punctuation));
+
+        langDef.mCommentStart = "/*";
+        langDef.mCommentEnd = "*/";
+        langDef.mSingleLineComment = "//";
+
+        langDef.mCaseSensitive = true;
+        langDef.mAutoIndentation = true;
+
+        langDef.mName = "HLSL";
+
+        GetBuiltinDefinitions().insert(&langDef);
+        inited = true;
+    }
+    return langDef;
+}
+
+const TextEditor::LanguageDefinition& TextEditor::LanguageDefinition::GLSL() {
+    static bool inited = false;
+    static LanguageDefinition langDef;
+    if (!inited) {
+        static const char* const keywords[] = {"auto", "break", "case", "char", "const", "continue", "default", "do", "double", "else",
+            "enum", "extern", "float", "for", "goto", "if", "inline", "int", "long", "register", "restrict", "return", "short", "signed",
+            "sizeof", "static", "struct", "switch", "typedef", "union", "unsigned", "void", "volatile", "while", "_Alignas", "_Alignof",
+            "_Atomic", "_Bool", "_Complex", "_Generic", "_Imaginary", "_Noreturn", "_Static_assert", "_Thread_local"};
+        for (auto& k : keywords)
+            langDef.mKeywords.insert(k);
+
+        static const char* const identifiers[] = {"abort", "abs", "acos", "asin", "atan", "atexit", "atof", "atoi", "atol", "ceil", "clock",
+            "cosh", "ctime", "div", "exit", "fabs", "floor", "fmod", "getchar", "getenv", "isalnum", "isalpha", "isdigit", "isgraph",
+            "ispunct", "isspace", "isupper", "kbhit", "log10", "log2", "log", "memcmp", "modf", "pow", "putchar", "putenv", "puts", "rand",
+            "remove", "rename", "sinh", "sqrt", "srand", "strcat", "strcmp", "strerror", "time", "tolower", "toupper"};
+        for (auto& k : identifiers) {
+            Identifier id;
+            id.mDeclaration = "Built-in function";
+            langDef.mIdentifiers.insert(std::make_pair(std::string(k), id));
+        }
+
+        langDef.mTokenRegexStrings.push_back(
+            std::make_pair<std::string, PaletteIndex>("[ \\t]*#[ \\t]*[a-zA-Z_]+", PaletteIndex::Preprocessor));
+        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("L?\\\"(\\\\.|[^\\\"])*\\\"", PaletteIndex::String));
+        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("\\'\\\\?[^\\']\\'", PaletteIndex::CharLiteral));
+        langDef.mTokenRegexStrings.push_back(
+            std::make_pair<std::string, PaletteIndex>("[+-]?([0-9]+([.][0-9]*)?|[.][0-9]+)([eE][+-]?[0-9]+)?[fF]?", PaletteIndex::Number));
+        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[+-]?[0-9]+[Uu]?[lL]?[lL]?", PaletteIndex::Number));
+        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("0[0-7]+[Uu]?[lL]?[lL]?", PaletteIndex::Number));
+        langDef.mTokenRegexStrings.push_back(
+            std::make_pair<std::string, PaletteIndex>("0[xX][0-9a-fA-F]+[uU]?[lL]?[lL]?", PaletteIndex::Number));
+        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[a-zA-Z_][a-zA-Z0-9_]*", PaletteIndex::Identifier));
+        langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>(
+            "[\\[\\]\\{\\}\\!\\%\\^\\&\\*\\(\\)\\-\\+\\=\\~\\|\\<\\>\\?\\/\\;\\,\\.]", PaletteIndex::Punctuation));
+
+        langDef.mCommentStart = "/*";
+        langDef.mCommentEnd = "*/";
+        langDef.mSingleLineComment = "//";
+
+        langDef.mCaseSensitive = true;
+        langDef.mAutoIndentation = true;
+
+        langDef.mName = "GLSL";
+
+        GetBuiltinDefinitions().insert(&langDef);
+        inited = true;
+    }
+    return langDef;
+}
+
+const TextEditor::LanguageDefinition& TextEditor::LanguageDefinition::C() {
+    static bool inited = false;
+    static LanguageDefinition langDef;
+    if (!inited) {
+        static const char* const keywords[] = {"auto", "break", "case", "char", "const", "continue", "default", "do", "double", "else",
+            "enum", "extern", "float", "for", "goto", "if", "inline", "int", "long", "register", "restrict", "return", "short", "signed",
+            "sizeof", "static", "struct", "switch", "typedef", "union", "unsigned", "void", "volatile", "while", "_Alignas", "_Alignof",
+            "_Atomic", "_Bool", "_Complex", "_Generic", "_Imaginary", "_Noreturn", "_Static_assert", "_Thread_local"};
+        for (auto& k : keywords)
+            langDef.mKeywords.insert(k);
+
+        static const char* const identifiers[] = {"abort", "abs", "acos", "asin", "atan", "atexit", "atof", "atoi", "atol", "ceil", "clock",
+            "cosh", "ctime", "div", "exit", "fabs", "floor", "fmod", "getchar", "getenv", "isalnum", "isalpha", "isdigit", "isgraph",
+            "ispunct", "isspace", "isupper", "kbhit", "log10", "log2", "log", "memcmp", "modf", "pow", "putchar", "putenv", "puts", "rand",
+            "remove", "rename", "sinh", "sqrt", "srand", "strcat", "strcmp", "strerror", "time", "tolower", "toupper"};
+        for (auto& k : identifiers) {
+            Identifier id;
+            id.mDeclaration = "Built-in function";
+            langDef.mIdentifiers.insert(std::make_pair(std::string(k), id));
+        }
+
+        langDef.mTokenize = [](const char* in_begin, const char* in_end, const char*& out_begin, const char*& out_end,
+                                PaletteIndex& paletteIndex) -> bool {
+            paletteIndex = PaletteIndex::Max;
+
+            while (in_begin < in_end && isascii(*in_begin) && isblank(*in_begin))
+                in_begin++;
+
+            if (in_begin == in_end) {
+                out_begin = in_end;
+                out_end = in_end;
+                paletteIndex = PaletteIndex::Default;
+            } else if (TokenizeCStyleString(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::String;
+            else if (TokenizeCStyleCharacterLiteral(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::CharLiteral;
+            else if (TokenizeCStyleIdentifier(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::Identifier;
+            else if (TokenizeCStyleNumber(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::Number;
+            else if (TokenizeCStylePunctuation(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::Punctuation;
+
+            return paletteIndex != PaletteIndex::Max;
+        };
+
+        langDef.mCommentStart = "/*";
+        langDef.mCommentEnd = "*/";
+        langDef.mSingleLineComment = "//";
+
+        langDef.mCaseSensitive = true;
+        langDef.mAutoIndentation = true;
+
+        langDef.mName = "C";
+
+        GetBuiltinDefinitions().insert(&langDef);
+        inited = true;
+    }
+    return langDef;
+}
+
+
+const TextEditor::LanguageDefinition& TextEditor::LanguageDefinition::Lua() {
+    static bool inited = false;
+    static LanguageDefinition langDef;
+    if (!inited) {
+        static const char* const keywords[] = {"and", "break", "do", "", "else", "elseif", "end", "false", "for", "function", "if", "in",
+            "", "local", "nil", "not", "or", "repeat", "return", "then", "true", "until", "while"};
+
+        for (auto& k : keywords)
+            langDef.mKeywords.insert(k);
+
+        static const char* const identifiers[] = {"assert", "collectgarbage", "dofile", "error", "getmetatable", "ipairs",
+            "load", "next", "pairs", "pcall", "print", "rawequal", "rawlen", "rawget", "rawset", "select", "setmetatable",
+            "tonumber", "tostring", "type", "xpcall", "_G", "_VERSION", "_ENV", "and", "not", "or",  
+            "create", "resume", "running", "status", "wrap", "yield", "isyieldable",
+            "lines", "open", "output", "read", "tmpfile", "type", "write", "close", "flush", "lines", "read", "seek", "setvbuf",
+            "write", "__gc", "__tostring", "abs", "acos", "asin", "atan", "ceil", "cos", "deg", "exp", "tointeger", "floor", "fmod", "ult",
+            "log", "max", "min", "modf", "rad", "random", "randomseed", "sin", "sqrt", "string", "tan", "type", "cosh", "sinh",
+            "tanh", "pow", "frexp", "ldexp", "log10", "pi", "huge", "maxinteger", "mininteger", "loadlib", "searchpath", "seeall",
+            "preload", "cpath", "path", "searchers", "loaded", "module", "require", "clock", "date", "difftime", "execute", "exit",
+            "getenv", "remove", "rename", "setlocale", "time", "tmpname", "byte", "char", "dump", "find", "format", "gmatch", "gsub", "len",
+            "lower", "match", "rep", "reverse", "sub", "upper", "pack", "packsize", "unpack", "concat", "maxn", "insert", "pack", "unpack",
+            "remove", "move", "sort", "offset", "codepoint", "char", "len", "codes", "charpattern", "coroutine", "table", "io", "os", "uevr", "api",
+            " UEVR_UObjectHook", "UEVR_UObject", "UEVR_UClass", "UEVR_UFunction", "as_struct", "as_class", "as_function", "get_class",
+            "super", "to_string", "get_fname", "find_uobject", "to_uobject", "get_player_controller", "add_component_by_class",
+            "spawn_object", "get_local_pawn", "get_address", "uevr.sdk.callbacks", "is_runtime_ready", "is_hmd_active", "get_uengine",
+            "Vector3f", "Vector4f", "Vector2f", "Quaternionf", "Quaterniond",
+            "get_objects_matching",
+            "string", "utf8", "bit32", "math", "package"};
+        for (auto& k : identifiers) {
+            Identifier id;
+            id.mDeclaration = "Built-in function";
+            langDef.mIdentifiers.insert(std::make_pair(std::string(k), id));
+        }
+
+        langDef.mTokenize = [](const char* in_begin, const char* in_end, const char*& out_begin, const char*& out_end,
+                                PaletteIndex& paletteIndex) -> bool {
+            paletteIndex = PaletteIndex::Max;
+
+            while (in_begin < in_end && isascii(*in_begin) && isblank(*in_begin))
+                in_begin++;
+
+            if (in_begin == in_end) {
+                out_begin = in_end;
+                out_end = in_end;
+                paletteIndex = PaletteIndex::Default;
+            } else if (TokenizeLuaStyleLongComment(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::MultiLineComment;
+            else if (TokenizeLuaStyleComment(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::Comment;
+            else if (TokenizeLuaStyleString(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::String;
+            else if (TokenizeLuaStyleLongString(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::String;
+            else if (TokenizeCStyleIdentifier(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::Identifier;
+            else if (TokenizeLuaStyleNumber(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::Number;
+            else if (TokenizeLuaStylePunctuation(in_begin, in_end, out_begin, out_end))
+                paletteIndex = PaletteIndex::Punctuation;
+
+            return paletteIndex != PaletteIndex::Max;
+        };
+
+        langDef.mCommentStart = "--[[";
+        langDef.mCommentEnd = "]]";
+        langDef.mSingleLineComment = "--";
+
+        // "then" and "do" start the blocks of if and elseif, while and for
+        langDef.mBlockStarts = {"function", "do", "then", "repeat", "else"};
+        langDef.mBlockEnds = {"end", "until", "elseif", "else"};
+
+        langDef.mCaseSensitive = true;
+        langDef.mAutoIndentation = false;
+
+        langDef.mName = "Lua";
+
+        GetBuiltinDefinitions().insert(&langDef);
+        inited = true;
+    }
+    return langDef;
+}
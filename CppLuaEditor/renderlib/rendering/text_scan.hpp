@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TEXT_SCAN_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Bulk scans over a whole document for loading it: finding line breaks, counting lines and checking UTF-8. They look
+// at 16 bytes at a time with SSE2 where it is available (always, on x64) and fall back to a byte loop elsewhere.
+namespace TextScan {
+
+inline int LowestBit(unsigned aMask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, aMask);
+    return (int)index;
+#else
+    return __builtin_ctz(aMask);
+#endif
+}
+
+// The first '\n' or '\r' in [aBegin, aEnd), or aEnd if there is none.
+inline const char* FindLineBreak(const char* aBegin, const char* aEnd) {
+    const char* p = aBegin;
+#ifdef TEXT_SCAN_SSE2
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriageReturn = _mm_set1_epi8('\r');
+    for (; aEnd - p >= 16; p += 16) {
+        const __m128i bytes = _mm_loadu_si128((const __m128i*)p);
+        const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(bytes, newline), _mm_cmpeq_epi8(bytes, carriageReturn)));
+        if (mask != 0)
+            return p + LowestBit((unsigned)mask);
+    }
+#endif
+    for (; p < aEnd; ++p)
+        if (*p == '\n' || *p == '\r')
+            return p;
+    return aEnd;
+}
+
+// How many '\n' there are in [aBegin, aEnd).
+inline size_t CountNewlines(const char* aBegin, const char* aEnd) {
+    size_t count = 0;
+    const char* p = aBegin;
+#ifdef TEXT_SCAN_SSE2
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (aEnd - p >= 16) {
+        // Count in the 16 byte lanes for up to 255 blocks before they could overflow, then add the lanes up
+        __m128i lanes = _mm_setzero_si128();
+        for (int i = 0; i < 255 && aEnd - p >= 16; ++i, p += 16)
+            lanes = _mm_sub_epi8(lanes, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), newline));
+        const __m128i sums = _mm_sad_epu8(lanes, _mm_setzero_si128());
+        count += (size_t)_mm_cvtsi128_si32(sums) + (size_t)_mm_extract_epi16(sums, 4);
+    }
+#endif
+    for (; p < aEnd; ++p)
+        count += *p == '\n';
+    return count;
+}
+
+// Length of the longest prefix of [aBegin, aEnd) that is well-formed UTF-8: no stray continuation bytes, overlong
+// forms, surrogates, code points past U+10FFFF or sequences cut short. The whole range is valid when that is
+// aEnd - aBegin.
+inline size_t ValidUtf8Length(const char* aBegin, const char* aEnd) {
+    auto p = (const uint8_t*)aBegin;
+    auto end = (const uint8_t*)aEnd;
+    while (p < end) {
+#ifdef TEXT_SCAN_SSE2
+        // Most source text is ASCII, skip it a block at a time
+        while (end - p >= 16 && _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)p)) == 0)
+            p += 16;
+        if (p == end)
+            break;
+#endif
+        const uint8_t c = *p;
+        if (c < 0x80) {
+            ++p;
+            continue;
+        }
+
+        // Continuation bytes to follow, and the range the first of them must be in
+        size_t count;
+        uint8_t low = 0x80, high = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF) {
+            count = 1;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            count = 2;
+            if (c == 0xE0)
+                low = 0xA0;
+            else if (c == 0xED)
+                high = 0x9F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            count = 3;
+            if (c == 0xF0)
+                low = 0x90;
+            else if (c == 0xF4)
+                high = 0x8F;
+        } else {
+            break;
+        }
+
+        if ((size_t)(end - p) <= count || p[1] < low || p[1] > high)
+            break;
+        size_t i = 2;
+        while (i <= count && (p[i] & 0xC0) == 0x80)
+            ++i;
+        if (i <= count)
+            break;
+        p += count + 1;
+    }
+    return (size_t)((const char*)p - aBegin);
+}
+
+} // namespace TextScan
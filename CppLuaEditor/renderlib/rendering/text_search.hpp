@@ -0,0 +1,169 @@
+#pragma once
+
+#include "text_scan.hpp"
+
+#include <cstring>
+#include <regex>
+#include <string>
+
+// Finds a pattern in a line of text, for TextEditor's find and replace.
+//
+// A literal pattern is found with a filter on its first and last byte: 16 positions at a time with SSE2, and only
+// where both bytes agree are the bytes between compared. Without SSE2, and in the last few bytes of a line, a
+// Horspool scan takes over, which skips ahead by up to the pattern's length on a mismatch. A one byte pattern is
+// left to memchr. Ignoring case folds ASCII letters only.
+//
+// A regex pattern is an ECMAScript std::regex. A whole word match must not have a letter, digit, '_' or non-ASCII
+// byte right before or after it. Empty matches are never reported.
+class TextSearch {
+public:
+    struct Options {
+        bool mCaseSensitive = true;
+        bool mWholeWord = false;
+        bool mRegex = false;
+    };
+
+    // False for an empty pattern or a regex that doesn't compile, which leaves nothing to find
+    bool Compile(const std::string& aPattern, const Options& aOptions) {
+        Clear();
+        if (aPattern.empty())
+            return false;
+
+        if (aOptions.mRegex) {
+            auto flags = std::regex_constants::ECMAScript | std::regex_constants::optimize;
+            if (!aOptions.mCaseSensitive)
+                flags |= std::regex_constants::icase;
+            try {
+                mRegex.assign(aPattern, flags);
+            } catch (const std::regex_error&) {
+                return false;
+            }
+        } else {
+            for (int i = 0; i < 256; ++i)
+                mSkip[i] = aPattern.size();
+            for (size_t i = 0; i + 1 < aPattern.size(); ++i) {
+                const auto c = (unsigned char)aPattern[i];
+                mSkip[c] = aPattern.size() - 1 - i;
+                if (!aOptions.mCaseSensitive && IsLetter(c))
+                    mSkip[c ^ 0x20] = mSkip[c];
+            }
+        }
+
+        mPattern = aPattern;
+        if (!aOptions.mCaseSensitive && !aOptions.mRegex) {
+            for (auto& c : mPattern)
+                c = (char)Fold((unsigned char)c);
+        }
+        mOptions = aOptions;
+        return true;
+    }
+
+    void Clear() {
+        mPattern.clear();
+        mRegex = std::regex();
+    }
+
+    bool IsEmpty() const { return mPattern.empty(); }
+    const Options& GetOptions() const { return mOptions; }
+
+    // The first match that starts in [aFrom, aEnd) of the line [aBegin, aEnd): what is before aFrom only counts for
+    // whole words and for the regex's anchors and lookbehind.
+    bool Find(const char* aBegin, const char* aEnd, const char* aFrom, const char*& aMatchStart, const char*& aMatchEnd) const {
+        while (!IsEmpty() && aFrom < aEnd) {
+            const char* start;
+            const char* end;
+            if (mOptions.mRegex) {
+                auto flags = aFrom > aBegin ? std::regex_constants::match_prev_avail : std::regex_constants::match_default;
+                if (!std::regex_search(aFrom, aEnd, mMatch, mRegex, flags))
+                    return false;
+                start = mMatch[0].first;
+                end = mMatch[0].second;
+            } else {
+                start = FindLiteral(aFrom, aEnd);
+                if (start == aEnd)
+                    return false;
+                end = start + mPattern.size();
+            }
+
+            if (start < end && (!mOptions.mWholeWord || ((start == aBegin || !IsWordByte(start[-1])) && (end == aEnd || !IsWordByte(*end))))) {
+                aMatchStart = start;
+                aMatchEnd = end;
+                return true;
+            }
+            aFrom = start + 1;
+        }
+        return false;
+    }
+
+    // What the last match Find returned is replaced with: aWith itself, or for a regex with $&, $1 and so on
+    // substituted.
+    std::string GetReplacement(const std::string& aWith) const {
+        if (!mOptions.mRegex)
+            return aWith;
+        return mMatch.format(aWith);
+    }
+
+private:
+    static bool IsLetter(unsigned char aChar) { return (aChar | 0x20) >= 'a' && (aChar | 0x20) <= 'z'; }
+    static unsigned char Fold(unsigned char aChar) { return IsLetter(aChar) ? (unsigned char)(aChar | 0x20) : aChar; }
+    static bool IsWordByte(char aChar) {
+        const auto c = (unsigned char)aChar;
+        return c >= 0x80 || c == '_' || (c >= '0' && c <= '9') || IsLetter(c);
+    }
+
+    bool Matches(const char* aAt) const {
+        if (mOptions.mCaseSensitive)
+            return memcmp(aAt, mPattern.data(), mPattern.size()) == 0;
+        for (size_t i = 0; i < mPattern.size(); ++i) {
+            if (Fold((unsigned char)aAt[i]) != (unsigned char)mPattern[i])
+                return false;
+        }
+        return true;
+    }
+
+    const char* FindLiteral(const char* aFrom, const char* aEnd) const {
+        const size_t length = mPattern.size();
+        if ((size_t)(aEnd - aFrom) < length)
+            return aEnd;
+        if (length == 1 && mOptions.mCaseSensitive) {
+            auto at = (const char*)memchr(aFrom, mPattern[0], (size_t)(aEnd - aFrom));
+            return at != nullptr ? at : aEnd;
+        }
+
+        const char* p = aFrom;
+        const char* last = aEnd - length; // the last place a match can start
+#ifdef TEXT_SCAN_SSE2
+        // Setting bit 0x20 folds a letter when the pattern's byte is one: only letters land on a lowercase letter then
+        const auto firstByte = (unsigned char)mPattern[0];
+        const auto lastByte = (unsigned char)mPattern[length - 1];
+        const __m128i firstBytes = _mm_set1_epi8((char)firstByte);
+        const __m128i lastBytes = _mm_set1_epi8((char)lastByte);
+        const __m128i firstFold = _mm_set1_epi8(!mOptions.mCaseSensitive && IsLetter(firstByte) ? 0x20 : 0);
+        const __m128i lastFold = _mm_set1_epi8(!mOptions.mCaseSensitive && IsLetter(lastByte) ? 0x20 : 0);
+        for (; last - p >= 15; p += 16) {
+            const __m128i atFirst = _mm_or_si128(_mm_loadu_si128((const __m128i*)p), firstFold);
+            const __m128i atLast = _mm_or_si128(_mm_loadu_si128((const __m128i*)(p + length - 1)), lastFold);
+            unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(atFirst, firstBytes), _mm_cmpeq_epi8(atLast, lastBytes)));
+            while (mask != 0) {
+                const int bit = TextScan::LowestBit(mask);
+                if (Matches(p + bit))
+                    return p + bit;
+                mask &= mask - 1;
+            }
+        }
+#endif
+        // Horspool: line the pattern up, compare, then shift by how far the byte under its end is from its own end
+        while (p <= last) {
+            if (Matches(p))
+                return p;
+            p += mSkip[(unsigned char)p[length - 1]];
+        }
+        return aEnd;
+    }
+
+    std::string mPattern; // a literal one folded when ignoring case
+    Options mOptions;
+    size_t mSkip[256] = {};
+    std::regex mRegex;
+    mutable std::cmatch mMatch; // of the latest regex Find, for GetReplacement
+};